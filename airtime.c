@@ -0,0 +1,173 @@
+/*
+ * airtime.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "airtime.h"
+#include "timers.h"
+
+#define BUCKET_SECONDS (AIRTIME_WINDOW_SECONDS/AIRTIME_WINDOW_BUCKETS)
+#define WINDOW_LIMIT_MS ((uint32_t)AIRTIME_WINDOW_SECONDS*AIRTIME_DUTY_CYCLE_PERMILLE)
+
+static const uint16_t class_permille[TXQUEUE_NUM_CLASSES] = AIRTIME_CLASS_PERMILLE;
+static uint32_t tokens[TXQUEUE_NUM_CLASSES];
+//what refills earned below a whole millisecond, in ticks times permille
+static uint16_t credit[TXQUEUE_NUM_CLASSES];
+static uint32_t window[AIRTIME_WINDOW_BUCKETS];
+static uint32_t window_used = 0;
+static unsigned long window_epoch;
+static uint8_t window_head = 0;
+static unsigned long refill_seconds;
+static clock_time_t refill_ticks;
+static uint16_t line_baud;
+static timers_timer_t defer_timer;
+static void (*wakeupCallback)(void);
+static airtime_stats_t stats;
+
+static void airtime_defer_expired(void* context)
+{
+	if(wakeupCallback != NULL)
+		wakeupCallback();
+}
+
+/* drops the buckets that slid out of the window */
+static void airtime_advance_window(void)
+{
+	unsigned long now = clock_seconds();
+
+	while(now - window_epoch >= BUCKET_SECONDS)
+	{
+		window_epoch += BUCKET_SECONDS;
+		window_head = (window_head + 1) % AIRTIME_WINDOW_BUCKETS;
+		window_used -= window[window_head];
+		window[window_head] = 0;
+		if(window_used == 0 && now - window_epoch >= AIRTIME_WINDOW_SECONDS)
+		{
+			//idle for longer than the whole window, skip ahead
+			window_epoch = now - ((now - window_epoch) % BUCKET_SECONDS);
+		}
+	}
+}
+
+static void airtime_refill(void)
+{
+	unsigned long now_seconds = clock_seconds();
+	clock_time_t now_ticks = clock_time();
+	uint32_t elapsed_ticks, earned;
+	uint8_t class;
+
+	//clock_time() wraps quickly on 16 bit platforms, long gaps fill the buckets anyway
+	if(now_seconds - refill_seconds > 255)
+		elapsed_ticks = (uint32_t) AIRTIME_BURST_MS * CLOCK_SECOND;
+	else
+		elapsed_ticks = (clock_time_t) (now_ticks - refill_ticks);
+	if(elapsed_ticks == 0)
+		return;
+	refill_seconds = now_seconds;
+	refill_ticks = now_ticks;
+
+	for(class = 0; class < TXQUEUE_NUM_CLASSES; class++)
+	{
+		//frequent refills must not round the rate down to nothing
+		earned = elapsed_ticks * class_permille[class] + credit[class];
+		tokens[class] += earned / CLOCK_SECOND;
+		credit[class] = earned % CLOCK_SECOND;
+		if(tokens[class] > AIRTIME_BURST_MS)
+			tokens[class] = AIRTIME_BURST_MS;
+	}
+}
+
+void airtime_initialize(uint16_t baud, void (*wakeup)(void))
+{
+	uint8_t class;
+
+	line_baud = baud;
+	wakeupCallback = wakeup;
+	memset(window, 0, sizeof(window));
+	memset(credit, 0, sizeof(credit));
+	memset(&stats, 0, sizeof(stats));
+	window_used = 0;
+	window_head = 0;
+	window_epoch = clock_seconds();
+	refill_seconds = window_epoch;
+	refill_ticks = clock_time();
+	for(class = 0; class < TXQUEUE_NUM_CLASSES; class++)
+		tokens[class] = AIRTIME_BURST_MS;
+}
+
+uint16_t airtime_frame_ms(uint16_t length)
+{
+	//8N1 framing, ten bits per byte on the air
+	return (((uint32_t) length * 10 * 1000) + line_baud - 1) / line_baud + AIRTIME_TX_OVERHEAD_MS;
+}
+
+uint32_t airtime_window_used_ms(void)
+{
+	airtime_advance_window();
+	return window_used;
+}
+
+uint32_t airtime_remaining_budget_ms(uint8_t class)
+{
+	uint32_t window_left;
+
+	airtime_advance_window();
+	airtime_refill();
+	window_left = (window_used < WINDOW_LIMIT_MS) ? (WINDOW_LIMIT_MS - window_used) : 0;
+	return (tokens[class] < window_left) ? tokens[class] : window_left;
+}
+
+uint8_t airtime_admit(uint8_t class, uint16_t airtime_ms)
+{
+	uint32_t wait_ms;
+
+	//a switched off class never earns budget, holding its frames would block every other class
+	if(class_permille[class] == 0)
+	{
+		stats.dropped[class]++;
+		return AIRTIME_DROP;
+	}
+	if(airtime_remaining_budget_ms(class) >= airtime_ms)
+		return AIRTIME_ADMIT;
+
+	stats.deferred[class]++;
+	if(window_used + airtime_ms > WINDOW_LIMIT_MS)
+	{
+		//the window is full, the oldest bucket is the first to free budget
+		wait_ms = (uint32_t) (BUCKET_SECONDS - (clock_seconds() - window_epoch)) * 1000;
+	}
+	else
+	{
+		wait_ms = (airtime_ms - tokens[class]) * 1000 / class_permille[class];
+	}
+	if(!timers_is_running(&defer_timer))
+		timers_start(&defer_timer, wait_ms / 1000, wait_ms % 1000, airtime_defer_expired, NULL);
+	return AIRTIME_DEFER;
+}
+
+void airtime_commit(uint8_t class, uint16_t airtime_ms)
+{
+	airtime_advance_window();
+	airtime_refill();
+	if(tokens[class] > airtime_ms)
+		tokens[class] -= airtime_ms;
+	else
+		tokens[class] = 0;
+	window[window_head] += airtime_ms;
+	window_used += airtime_ms;
+	stats.total_ms += airtime_ms;
+	stats.class_ms[class] += airtime_ms;
+}
+
+airtime_stats_t* airtime_get_stats(void)
+{
+	return &stats;
+}
@@ -0,0 +1,100 @@
+/*
+ * File:   airtime.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef AIRTIME_H
+#define	AIRTIME_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+#include "txqueue.h"
+
+/*! regulatory duty cycle over the sliding window, in permille of the window */
+#ifndef AIRTIME_DUTY_CYCLE_PERMILLE
+#define AIRTIME_DUTY_CYCLE_PERMILLE 100
+#endif
+/*! sliding window length and the number of buckets it is kept in */
+#ifndef AIRTIME_WINDOW_SECONDS
+#define AIRTIME_WINDOW_SECONDS 3600
+#endif
+#define AIRTIME_WINDOW_BUCKETS 12
+/*! per class token bucket rates in permille, one entry per txqueue class */
+#ifndef AIRTIME_CLASS_PERMILLE
+#define AIRTIME_CLASS_PERMILLE { 100, 100, 100, 10 }
+#endif
+/*! token bucket depth, the longest burst a class may key the transmitter for */
+#ifndef AIRTIME_BURST_MS
+#define AIRTIME_BURST_MS 15000
+#endif
+/*! transmitter on time around every frame, rts lead and tail */
+#ifndef AIRTIME_TX_OVERHEAD_MS
+#define AIRTIME_TX_OVERHEAD_MS 40
+#endif
+
+#define AIRTIME_DEFER	0
+#define AIRTIME_ADMIT	1
+#define AIRTIME_DROP	2
+
+    typedef struct
+    {
+        uint32_t total_ms;
+        uint32_t class_ms[TXQUEUE_NUM_CLASSES];
+        uint16_t deferred[TXQUEUE_NUM_CLASSES];
+        //frames of classes switched off with a zero rate
+        uint16_t dropped[TXQUEUE_NUM_CLASSES];
+    } airtime_stats_t;
+
+    /*!
+     * airtime_initialize()
+     * baud is the radio line rate, wakeup is called from timer context when a
+     * deferred frame may have become admissible
+     */
+    void airtime_initialize(uint16_t baud, void (*wakeup)(void));
+
+    /*!
+     * airtime_frame_ms()
+     * transmitter on time for a frame of length bytes including the rts turnaround
+     */
+    uint16_t airtime_frame_ms(uint16_t length);
+
+    /*!
+     * airtime_admit()
+     * AIRTIME_ADMIT if a frame of airtime_ms may be sent in this class now,
+     * AIRTIME_DROP if the class is switched off and the frame will never be,
+     * otherwise AIRTIME_DEFER and arms the wakeup for when enough budget will have accumulated
+     */
+    uint8_t airtime_admit(uint8_t traffic_class, uint16_t airtime_ms);
+
+    /*!
+     * airtime_commit()
+     * charges a transmitted frame to the class and the sliding window
+     */
+    void airtime_commit(uint8_t traffic_class, uint16_t airtime_ms);
+
+    /*!
+     * airtime_remaining_budget_ms()
+     * airtime the class may use right now without being deferred
+     */
+    uint32_t airtime_remaining_budget_ms(uint8_t traffic_class);
+
+    /*!
+     * airtime_window_used_ms()
+     * airtime used during the last AIRTIME_WINDOW_SECONDS
+     */
+    uint32_t airtime_window_used_ms(void);
+
+    airtime_stats_t* airtime_get_stats(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* AIRTIME_H */
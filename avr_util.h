@@ -4,6 +4,25 @@
 
 #include <stdio.h>
 
+//lookup tables stay in flash on the avr and are read through these, host builds keep plain arrays
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#define TABLE_PROGMEM PROGMEM
+#define TABLE_READ_BYTE(addr) pgm_read_byte(addr)
+#define TABLE_READ_WORD(addr) pgm_read_word(addr)
+#else
+#define TABLE_PROGMEM
+#define TABLE_READ_BYTE(addr) (*(addr))
+#define TABLE_READ_WORD(addr) (*(addr))
+#endif
+
+//protocol state belongs to one radio, the host runs each radio on a thread of its own with its own copy
+#if defined(__AVR__)
+#define RADIO_LOCAL
+#else
+#define RADIO_LOCAL __thread
+#endif
+
 #define SET_BIT(port, bit)    ((port) |= _BV(bit))
 #define CLR_BIT(port, bit)    ((port) &= ~_BV(bit))
 #define READ_BIT(port, bit)   (((port) & _BV(bit)) != 0)
@@ -23,8 +42,14 @@
 #define HIGH(x) ((x&0xF0)>>4)
 #define LOW(x) (x&0x0F)
 
+//only the avr shares state with an isr, host threads use __atomic where they share anything
+#if defined(__AVR__)
 #define ATOMIC_BEGIN() cli()
 #define ATOMIC_END() sei()
+#else
+#define ATOMIC_BEGIN()
+#define ATOMIC_END()
+#endif
 #define ATOMIC_SET(dst, src) {ATOMIC_BEGIN(); dst=src; ATOMIC_END();}
 
 #if 1
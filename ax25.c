@@ -8,15 +8,26 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "ax25.h"
+#include "avr_util.h"
 
-static uint8_t ax25_local_callsign[7]="SA0BXI\x0f";
+static RADIO_LOCAL uint8_t ax25_local_callsign[7]="SA0BXI\x0f";
 static const uint8_t ax25_broadcast_address[7] = "\0\0\0WIDE";
 
 #define INITFCS      0xffff  /* Initial FCS value */
 
-static uint16_t ax25_fcstab[256] = {
+#if AX25_NIBBLE_FCS_TABLE==1
+
+const uint16_t ax25_fcstab_nibble[16] TABLE_PROGMEM = {
+   0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387,
+   0x8408, 0x9489, 0xa50a, 0xb58b, 0xc60c, 0xd68d, 0xe70e, 0xf78f
+};
+
+#else
+
+const uint16_t ax25_fcstab[256] TABLE_PROGMEM = {
    0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
    0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
    0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
@@ -51,11 +62,14 @@ static uint16_t ax25_fcstab[256] = {
    0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78
 };
 
+#endif
+
 static uint16_t ax25_fcs(uint16_t fcs, uint8_t* cp, uint16_t len)
 {
 	while (len--)
 	{
-    	fcs = (fcs >> 8) ^ ax25_fcstab[(fcs ^ *cp++) & 0xff];
+    	fcs = AX25_FCS_UPDATE(fcs, *cp);
+    	cp++;
 	}
 	return fcs;
 }
@@ -138,6 +152,47 @@ uint32_t ax25_create_ui_packet(uint8_t* src_in, uint8_t* dst_in, uint8_t* payloa
     return len;
 }
 
+void ax25_create_template(uint8_t* src_in, uint8_t* dst_in, ax25_template_t* template_out)
+{
+	memcpy(template_out->header+AX25_DESTINATION_OFFSET, dst_in, AX25_DESTINATION_LENGTH);
+	memcpy(template_out->header+AX25_SOURCE_OFFSET, src_in, AX25_SOURCE_LENGTH);
+	template_out->header[AX25_CONTROL_OFFSET]=AX25_CONTROL_UI_FINAL;
+	template_out->header[AX25_PID_OFFSET]=AX25_PID_NO_PROTOCOL;
+	template_out->fcs=ax25_fcs(INITFCS, template_out->header, AX25_PAYLOAD_OFFSET);
+}
+
+uint8_t ax25_template_matches(ax25_template_t* template_in, uint8_t* src_in, uint8_t* dst_in)
+{
+	//a template that was never built has no control field
+	return template_in->header[AX25_CONTROL_OFFSET]==AX25_CONTROL_UI_FINAL
+			&& !memcmp(template_in->header+AX25_DESTINATION_OFFSET, dst_in, AX25_DESTINATION_LENGTH)
+			&& !memcmp(template_in->header+AX25_SOURCE_OFFSET, src_in, AX25_SOURCE_LENGTH);
+}
+
+uint32_t ax25_create_ui_packet_from_template(ax25_template_t* template_in, uint8_t* payload_in, uint16_t payload_length, uint8_t* packet_out)
+{
+	uint16_t crc;
+	uint16_t len;
+
+	//check for input errors
+	if(payload_length > AX25_MAX_PAYLOAD_LENGTH || packet_out==NULL)
+		return 0;
+
+	memcpy(packet_out, template_in->header, AX25_PAYLOAD_OFFSET);
+	//the payload may have been built in place already
+	if(payload_in!=packet_out+AX25_PAYLOAD_OFFSET)
+		memcpy(packet_out+AX25_PAYLOAD_OFFSET, payload_in, payload_length);
+	len=AX25_PAYLOAD_OFFSET+payload_length;
+
+	//the header is already in the fcs, carry on over the payload only
+	crc=ax25_fcs(template_in->fcs, packet_out+AX25_PAYLOAD_OFFSET, payload_length) ^ 0xffff;
+	packet_out[len]=crc>>8 & 0xFF;
+	packet_out[len+1]=crc & 0xFF;
+	len+=AX25_FCS_LENGTH;
+
+	return len;
+}
+
 uint8_t ax25_check_destination(uint8_t* my_dst, uint8_t* packet_dst_out, uint8_t* packet_in)
 {
     uint8_t result;
@@ -197,3 +252,34 @@ uint16_t ax25_open_ui_packet(uint8_t* src_out, uint8_t* dst_out, uint8_t* payloa
 
     return len;
 }
+
+uint8_t* ax25_open_ui_packet_view(uint8_t* src_out, uint8_t* dst_out, uint8_t* packet_in, uint16_t packet_length, uint16_t* payload_length_out)
+{
+	uint16_t len;
+
+	if(packet_length < AX25_PAYLOAD_OFFSET+AX25_FCS_LENGTH)
+		return NULL;
+	len=ax25_open_ui_packet(src_out, dst_out, NULL, packet_in, packet_length);
+	if(len==0)
+		return NULL;
+	if(payload_length_out!=NULL)
+		*payload_length_out=len;
+	return packet_in+AX25_PAYLOAD_OFFSET;
+}
+
+uint16_t ax25_readdress_ui_packet(uint8_t* src_in, uint8_t* dst_in, uint8_t* packet, uint16_t packet_length)
+{
+	uint16_t crc=0;
+
+	if(packet_length < AX25_PAYLOAD_OFFSET+AX25_FCS_LENGTH)
+		return 0;
+
+	memcpy(packet+AX25_DESTINATION_OFFSET, dst_in, AX25_DESTINATION_LENGTH);
+	memcpy(packet+AX25_SOURCE_OFFSET, src_in, AX25_SOURCE_LENGTH);
+
+	crc=ax25_compute_crc(packet, packet_length-AX25_FCS_LENGTH);
+	packet[packet_length-AX25_FCS_LENGTH]=crc>>8 & 0xFF;
+	packet[packet_length-AX25_FCS_LENGTH+1]=crc & 0xFF;
+
+	return packet_length;
+}
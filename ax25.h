@@ -11,6 +11,7 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include "udp_ip.h"
+#include "avr_util.h"
 
 /*
  * according to the standards below definition should be 256, but we ignored a lot of rules
@@ -38,6 +39,35 @@
 #define AX25_PAYLOAD_OFFSET (AX25_PID_OFFSET+AX25_PID_LENGTH)
 #define AX25_FCS_OFFSET(payload_len) (AX25_PAYLOAD_OFFSET+payload_len)
 
+/*
+ * 1 runs the fcs a nibble at a time from a 32 byte table instead of the 512 byte one,
+ * two lookups per byte in exchange for the flash
+ */
+#ifndef AX25_NIBBLE_FCS_TABLE
+#define AX25_NIBBLE_FCS_TABLE 0
+#endif
+
+#define AX25_FCS_INIT 0xffff
+/*! one byte step of the reflected fcs, the table is shared with the fused receive kernel */
+#if AX25_NIBBLE_FCS_TABLE==1
+extern const uint16_t ax25_fcstab_nibble[16] TABLE_PROGMEM;
+#define AX25_FCS_NIBBLE(fcs, nibble) (((fcs) >> 4) ^ TABLE_READ_WORD(&ax25_fcstab_nibble[((fcs) ^ (nibble)) & 0x0f]))
+#define AX25_FCS_UPDATE(fcs, byte) AX25_FCS_NIBBLE(AX25_FCS_NIBBLE(fcs, byte), (byte) >> 4)
+#else
+extern const uint16_t ax25_fcstab[256] TABLE_PROGMEM;
+#define AX25_FCS_UPDATE(fcs, byte) (((fcs) >> 8) ^ TABLE_READ_WORD(&ax25_fcstab[((fcs) ^ (byte)) & 0xff]))
+#endif
+
+	/*!
+	 * ui frame header for a fixed source and destination and the fcs state after it,
+	 * frames built from it only run the fcs over their payload
+	 */
+	typedef struct
+	{
+		uint8_t header[AX25_PAYLOAD_OFFSET];
+		uint16_t fcs;
+	} ax25_template_t;
+
 	/*!
 	 * 	ax25_initialize_network()
 	 * 	copies the ax25 callsign to static local eth address
@@ -66,6 +96,22 @@
      * else returns zero
      */
     uint32_t ax25_create_ui_packet(uint8_t* src_in, uint8_t* dst_in, uint8_t* payload_in, uint16_t payload_length, uint8_t* packet_out);
+    /*!
+     * ax25_create_template()
+     * prebuilds the ui header for src_in and dst_in and runs the fcs over it
+     */
+    void ax25_create_template(uint8_t* src_in, uint8_t* dst_in, ax25_template_t* template_out);
+    /*!
+     * ax25_template_matches()
+     * returns non-zero if template_in was built for src_in and dst_in
+     */
+    uint8_t ax25_template_matches(ax25_template_t* template_in, uint8_t* src_in, uint8_t* dst_in);
+    /*!
+     * ax25_create_ui_packet_from_template()
+     * same packet as ax25_create_ui_packet with the header and its fcs taken from the template
+     * payload_in may already sit at packet_out+AX25_PAYLOAD_OFFSET, it is not copied then
+     */
+    uint32_t ax25_create_ui_packet_from_template(ax25_template_t* template_in, uint8_t* payload_in, uint16_t payload_length, uint8_t* packet_out);
     /*!
      * ax25_check_destination()
      * checks the destination of the packet_in with my_dst
@@ -82,6 +128,19 @@
      * on a successful opening function returns the length of the packet
      */
     uint16_t ax25_open_ui_packet(uint8_t* src_out, uint8_t* dst_out, uint8_t* payload_out, uint8_t* packet_in, uint16_t packet_length);
+    /*!
+     * ax25_open_ui_packet_view()
+     * same checks as ax25_open_ui_packet but nothing is copied, returns a pointer to the
+     * payload inside packet_in and its length in payload_length_out, NULL if the fcs doesn't match
+     */
+    uint8_t* ax25_open_ui_packet_view(uint8_t* src_out, uint8_t* dst_out, uint8_t* packet_in, uint16_t packet_length, uint16_t* payload_length_out);
+    /*!
+     * ax25_readdress_ui_packet()
+     * rewrites the source and destination of an already built packet in place
+     * and recomputes the fcs, the payload is left untouched
+     * returns the length of the packet
+     */
+    uint16_t ax25_readdress_ui_packet(uint8_t* src_in, uint8_t* dst_in, uint8_t* packet, uint16_t packet_length);
 
 
 
@@ -0,0 +1,96 @@
+/*
+ * bufpool.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bufpool.h"
+#include "avr_util.h"
+
+#define BUFPOOL_STR(x) #x
+#define BUFPOOL_XSTR(x) BUFPOOL_STR(x)
+
+//the whole arena is allocated here, this is all the frame ram the stack will ever use
+#pragma message("bufpool: " BUFPOOL_XSTR(BUFPOOL_NUM_BLOCKS) " blocks of " BUFPOOL_XSTR(BUFPOOL_BLOCK_SIZE) " bytes, at most " BUFPOOL_XSTR(BUFPOOL_RAM_BUDGET))
+
+static RADIO_LOCAL uint8_t arena[BUFPOOL_NUM_BLOCKS][BUFPOOL_BLOCK_SIZE];
+static RADIO_LOCAL uint8_t owners[BUFPOOL_NUM_BLOCKS];
+static RADIO_LOCAL bufpool_stats_t stats;
+
+void bufpool_initialize(void)
+{
+	memset(owners, BUFPOOL_OWNER_FREE, sizeof(owners));
+	memset(&stats, 0, sizeof(stats));
+	stats.owned[BUFPOOL_OWNER_FREE] = BUFPOOL_NUM_BLOCKS;
+}
+
+int8_t bufpool_alloc(uint8_t owner)
+{
+	int8_t i;
+
+	for(i = 0; i < BUFPOOL_NUM_BLOCKS; i++)
+	{
+		if(owners[i] == BUFPOOL_OWNER_FREE)
+			break;
+	}
+	if(i == BUFPOOL_NUM_BLOCKS)
+	{
+		stats.exhausted++;
+		return BUFPOOL_NO_BLOCK;
+	}
+
+	owners[i] = owner;
+	stats.owned[BUFPOOL_OWNER_FREE]--;
+	stats.owned[owner]++;
+	stats.allocated++;
+	stats.in_use++;
+	if(stats.in_use > stats.peak)
+		stats.peak = stats.in_use;
+	return i;
+}
+
+void bufpool_handoff(int8_t block, uint8_t owner)
+{
+	if(owners[block] == owner)
+		return;
+	stats.owned[owners[block]]--;
+	stats.owned[owner]++;
+	owners[block] = owner;
+	stats.handoffs++;
+}
+
+void bufpool_free(int8_t block)
+{
+	if(block == BUFPOOL_NO_BLOCK || owners[block] == BUFPOOL_OWNER_FREE)
+		return;
+	stats.owned[owners[block]]--;
+	stats.owned[BUFPOOL_OWNER_FREE]++;
+	owners[block] = BUFPOOL_OWNER_FREE;
+	stats.in_use--;
+}
+
+uint8_t* bufpool_data(int8_t block)
+{
+	return arena[block];
+}
+
+uint8_t bufpool_owner(int8_t block)
+{
+	return owners[block];
+}
+
+uint8_t bufpool_available(void)
+{
+	return stats.owned[BUFPOOL_OWNER_FREE];
+}
+
+bufpool_stats_t* bufpool_get_stats(void)
+{
+	return &stats;
+}
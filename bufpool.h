@@ -0,0 +1,119 @@
+/*
+ * File:   bufpool.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef BUFPOOL_H
+#define	BUFPOOL_H
+
+#include <inttypes.h>
+#include <stdint.h>
+
+#include "radiotftp.h"
+#include "txqueue.h"
+#include "frag.h"
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * every frame sized buffer of the stack comes out of one arena of fixed blocks
+ * a block always has exactly one owner, stages pass blocks to each other
+ * instead of copying frames between private buffers
+ * only the main loop allocates, hands off and frees, the uart isr just fills
+ * the block it was given while io_flag is clear
+ */
+
+/*! one block holds a whole encoded frame, preamble to eof */
+#ifndef BUFPOOL_BLOCK_SIZE
+#define BUFPOOL_BLOCK_SIZE RADIOTFTP_FRAME_BUFFER_LENGTH
+#endif
+/*
+ * a block per transmit slot, one the isr fills, one the main loop parses and one per
+ * datagram being reassembled, slots keep their blocks while frames are kept for
+ * retransmission so reassembly must not depend on them giving any back
+ */
+#define BUFPOOL_BLOCKS_NEEDED (TXQUEUE_NUM_SLOTS+2+FRAG_NUM_BUFFERS)
+#ifndef BUFPOOL_NUM_BLOCKS
+#define BUFPOOL_NUM_BLOCKS BUFPOOL_BLOCKS_NEEDED
+#endif
+/*! the build fails if the arena would take more ram than this */
+#ifndef BUFPOOL_RAM_BUDGET
+#define BUFPOOL_RAM_BUDGET 4608
+#endif
+
+#if BUFPOOL_NUM_BLOCKS < BUFPOOL_BLOCKS_NEEDED
+#error the transmit slots, the receiver and reassembly can starve each other of blocks
+#endif
+#if BUFPOOL_NUM_BLOCKS > 127
+#error block indices have to fit in an int8_t
+#endif
+#if BUFPOOL_NUM_BLOCKS*BUFPOOL_BLOCK_SIZE > BUFPOOL_RAM_BUDGET
+#error the buffer arena does not fit in BUFPOOL_RAM_BUDGET
+#endif
+#if FRAG_MAX_PACKET_LENGTH > BUFPOOL_BLOCK_SIZE
+#error a reassembled datagram does not fit in one block
+#endif
+
+#define BUFPOOL_NO_BLOCK (-1)
+
+/*! owners, a block moves between them as the frame in it goes through the stack */
+#define BUFPOOL_OWNER_FREE	0
+#define BUFPOOL_OWNER_RX	1
+#define BUFPOOL_OWNER_TX	2
+#define BUFPOOL_OWNER_FRAG	3
+#define BUFPOOL_NUM_OWNERS	4
+
+    typedef struct
+    {
+        uint16_t allocated;
+        uint16_t handoffs;
+        uint16_t exhausted;
+        uint8_t in_use;
+        uint8_t peak;
+        uint8_t owned[BUFPOOL_NUM_OWNERS];
+    } bufpool_stats_t;
+
+    /*!
+     * bufpool_initialize()
+     * gives every block back to the pool and clears the statistics
+     */
+    void bufpool_initialize(void);
+
+    /*!
+     * bufpool_alloc()
+     * takes a free block for owner
+     * returns the block or BUFPOOL_NO_BLOCK if they are all taken
+     */
+    int8_t bufpool_alloc(uint8_t owner);
+
+    /*!
+     * bufpool_handoff()
+     * passes block on to the next stage, the old owner must not touch it afterwards
+     */
+    void bufpool_handoff(int8_t block, uint8_t owner);
+
+    /*!
+     * bufpool_free()
+     * gives block back to the pool
+     */
+    void bufpool_free(int8_t block);
+
+    /*!
+     * bufpool_data()
+     * the BUFPOOL_BLOCK_SIZE bytes of block
+     */
+    uint8_t* bufpool_data(int8_t block);
+
+    uint8_t bufpool_owner(int8_t block);
+    uint8_t bufpool_available(void);
+    bufpool_stats_t* bufpool_get_stats(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* BUFPOOL_H */
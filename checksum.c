@@ -0,0 +1,138 @@
+/*
+ * checksum.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "checksum.h"
+
+#define CHECKSUM_INLINE static inline __attribute__((always_inline))
+
+#if defined(__AVR__)
+
+/*
+ * the avr adds bytes, so the high and low bytes of the words go into two
+ * 16 bit sums that are only widened once every 255 words
+ */
+CHECKSUM_INLINE uint16_t checksum_core(uint8_t* dst, const uint8_t* src, uint16_t len, uint16_t sum, uint8_t copy)
+{
+	uint32_t acc = sum;
+	uint16_t words = len >> 1;
+	uint16_t hi, lo;
+	uint8_t n, b;
+
+	while(words)
+	{
+		//255*255 still fits in 16 bits
+		n = (words > 255) ? 255 : words;
+		words -= n;
+		hi = 0;
+		lo = 0;
+		do
+		{
+			b = *src++;
+			if(copy)
+				*dst++ = b;
+			hi += b;
+			b = *src++;
+			if(copy)
+				*dst++ = b;
+			lo += b;
+		} while(--n);
+		acc += ((uint32_t) hi << 8) + lo;
+	}
+	if(len & 1)
+	{
+		b = *src;
+		if(copy)
+			*dst = b;
+		acc += (uint16_t) b << 8;
+	}
+
+	while(acc >> 16)
+		acc = (acc & 0xFFFF) + (acc >> 16);
+	return acc;
+}
+
+#else
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define CHECKSUM_SWAP(x) ((uint16_t) ((((x) >> 8) & 0xFF) | (((x) & 0xFF) << 8)))
+#else
+#define CHECKSUM_SWAP(x) ((uint16_t) (x))
+#endif
+
+/*
+ * ones' complement sums do not depend on byte order, so whole native words are
+ * added and the result is swapped to big endian once, 2^32 words of 32 bits fit
+ * in the 64 bit accumulator so the carries are folded at the very end
+ */
+CHECKSUM_INLINE uint16_t checksum_core(uint8_t* dst, const uint8_t* src, uint16_t len, uint16_t sum, uint8_t copy)
+{
+	uint64_t acc = CHECKSUM_SWAP(sum);
+	uint32_t word;
+	uint16_t half;
+
+	while(len >= 4)
+	{
+		memcpy(&word, src, 4);
+		if(copy)
+		{
+			memcpy(dst, &word, 4);
+			dst += 4;
+		}
+		acc += word;
+		src += 4;
+		len -= 4;
+	}
+	if(len >= 2)
+	{
+		memcpy(&half, src, 2);
+		if(copy)
+		{
+			memcpy(dst, &half, 2);
+			dst += 2;
+		}
+		acc += half;
+		src += 2;
+		len -= 2;
+	}
+	if(len)
+	{
+		//the odd byte is the first byte of a zero padded word
+		half = 0;
+		memcpy(&half, src, 1);
+		if(copy)
+			*dst = *src;
+		acc += half;
+	}
+
+	while(acc >> 16)
+		acc = (acc & 0xFFFF) + (acc >> 16);
+	return CHECKSUM_SWAP(acc);
+}
+
+#endif
+
+uint16_t checksum_add(const uint8_t* data, uint16_t len, uint16_t sum)
+{
+	return checksum_core(NULL, data, len, sum, 0);
+}
+
+uint16_t checksum_copy_add(uint8_t* dst, const uint8_t* src, uint16_t len, uint16_t sum)
+{
+	return checksum_core(dst, src, len, sum, 1);
+}
+
+uint16_t checksum_add_word(uint16_t word, uint16_t sum)
+{
+	uint32_t acc = (uint32_t) sum + word;
+
+	return (acc & 0xFFFF) + (acc >> 16);
+}
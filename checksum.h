@@ -0,0 +1,49 @@
+/*
+ * File:   checksum.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef CHECKSUM_H
+#define	CHECKSUM_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+    /*
+     * internet ones' complement sums over big endian 16 bit words
+     * sums are returned folded but not complemented so they can be chained,
+     * a trailing odd byte is padded with zero, so only chain after even lengths
+     * avr builds add bytes into split 16 bit accumulators, host builds add
+     * 32 bit words into a 64 bit accumulator, both fold the carries once at the end
+     */
+
+    /*!
+     * checksum_add()
+     * adds len bytes of data to sum
+     */
+    uint16_t checksum_add(const uint8_t* data, uint16_t len, uint16_t sum);
+
+    /*!
+     * checksum_copy_add()
+     * copies len bytes from src to dst and adds them to sum in the same pass
+     * dst may be src
+     */
+    uint16_t checksum_copy_add(uint8_t* dst, const uint8_t* src, uint16_t len, uint16_t sum);
+
+    /*!
+     * checksum_add_word()
+     * adds one 16 bit value to sum
+     */
+    uint16_t checksum_add_word(uint16_t word, uint16_t sum);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CHECKSUM_H */
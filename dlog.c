@@ -0,0 +1,127 @@
+/*
+ * dlog.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "dlog.h"
+
+#if DLOG_ENABLED
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+//called from the uart isr as well, so interrupts are only restored to what they were
+#define DLOG_LOCK() uint8_t sreg = SREG; cli()
+#define DLOG_UNLOCK() SREG = sreg
+#else
+#define DLOG_LOCK()
+#define DLOG_UNLOCK()
+#endif
+
+#define MASK (DLOG_BUFFER_SIZE-1)
+
+PROCESS(dlog_process, "Deferred log");
+
+static uint8_t ring[DLOG_BUFFER_SIZE];
+//head only moves under the lock, tail only in the drain process
+static volatile uint8_t head = 0;
+static uint8_t tail = 0;
+static volatile uint16_t dropped = 0;
+
+void dlog_initialize(void)
+{
+	head = 0;
+	tail = 0;
+	dropped = 0;
+	process_start(&dlog_process, NULL);
+}
+
+void dlog_record(uint8_t id, uint8_t argc, uint16_t a, uint16_t b)
+{
+	uint8_t used;
+	DLOG_LOCK();
+
+	used = (head - tail) & MASK;
+	if(DLOG_BUFFER_SIZE - 1 - used < 1 + 2 * argc)
+	{
+		dropped++;
+	}
+	else
+	{
+		ring[head] = (argc << 6) | (id & DLOG_MAX_ID);
+		head = (head + 1) & MASK;
+		if(argc > 0)
+		{
+			ring[head] = a >> 8;
+			ring[(head + 1) & MASK] = a & 0xFF;
+			head = (head + 2) & MASK;
+		}
+		if(argc > 1)
+		{
+			ring[head] = b >> 8;
+			ring[(head + 1) & MASK] = b & 0xFF;
+			head = (head + 2) & MASK;
+		}
+	}
+
+	DLOG_UNLOCK();
+	process_poll(&dlog_process);
+}
+
+/* writes whole records until at least budget bytes are out, returns non-zero if any are left */
+static uint8_t dlog_drain(uint8_t budget)
+{
+	uint8_t length;
+	uint16_t count;
+
+	while(tail != head && budget)
+	{
+		length = 1 + 2 * (ring[tail] >> 6);
+		DLOG_PUTCHAR(DLOG_SYNC);
+		while(length--)
+		{
+			DLOG_PUTCHAR(ring[tail]);
+			tail = (tail + 1) & MASK;
+			if(budget)
+				budget--;
+		}
+	}
+	if(dropped && tail == head)
+	{
+		DLOG_LOCK();
+		count = dropped;
+		dropped = 0;
+		DLOG_UNLOCK();
+		DLOG_PUTCHAR(DLOG_SYNC);
+		DLOG_PUTCHAR((1 << 6) | DLOG_OVERFLOW);
+		DLOG_PUTCHAR(count >> 8);
+		DLOG_PUTCHAR(count & 0xFF);
+	}
+	return tail != head;
+}
+
+PROCESS_THREAD(dlog_process, ev, data)
+{
+	PROCESS_BEGIN()
+		;
+		while(1)
+		{
+			PROCESS_WAIT_EVENT_UNTIL(ev==PROCESS_EVENT_POLL);
+			//a log line is never urgent, only trickle out while anything else is waiting
+			if(dlog_drain((process_nevents()>0) ? DLOG_BUSY_BURST : DLOG_BUFFER_SIZE - 1))
+			{
+				process_poll(&dlog_process);
+			}
+		}
+
+	PROCESS_END();
+}
+
+#endif
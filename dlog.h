@@ -0,0 +1,114 @@
+/*
+ * File:   dlog.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef DLOG_H
+#define	DLOG_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*! set to 0 to compile every DLOG() out */
+#ifndef DLOG_ENABLED
+#define DLOG_ENABLED 1
+#endif
+/*! bytes of pending records, must be a power of two */
+#ifndef DLOG_BUFFER_SIZE
+#define DLOG_BUFFER_SIZE 128
+#endif
+/*! bytes written per poll while other processes have events waiting */
+#ifndef DLOG_BUSY_BURST
+#define DLOG_BUSY_BURST 8
+#endif
+#ifndef DLOG_PUTCHAR
+#define DLOG_PUTCHAR(c) putchar(c)
+#endif
+
+#if (DLOG_BUFFER_SIZE & (DLOG_BUFFER_SIZE-1)) != 0 || DLOG_BUFFER_SIZE > 256
+#error DLOG_BUFFER_SIZE must be a power of two no larger than 256
+#endif
+
+/*
+ * records go to the console as sync(1) argc<<6|id(1) then argc big endian 16 bit arguments
+ * the sync byte never shows up in console text, dlog_decode turns records back into
+ * lines and passes everything else through, the format strings only live there
+ */
+#define DLOG_SYNC 0xFE
+#define DLOG_MAX_ID 63
+#define DLOG_MAX_ARGS 2
+
+/*! message ids, keep dlog_decode.c in step */
+#define DLOG_OVERFLOW			0	//records lost
+#define DLOG_WAKEUP				1	//event
+#define DLOG_RX_END				2	//encoded length
+#define DLOG_EVENT_QUEUE_FULL	3
+#define DLOG_TIMER				4
+#define DLOG_SEND_REQUEST		5	//bytes
+#define DLOG_CHANNEL_BUSY		6	//class
+#define DLOG_DUPLICATE			7	//src port, dst port
+#define DLOG_UDP_DISCARDED		8	//rx errors
+#define DLOG_LINK_DISCARDED		9	//rx errors
+#define DLOG_NOT_FOR_US			10	//destination ip, high and low half
+#define DLOG_UNASSIGNED_PORT	11	//port
+#define DLOG_NO_ROOM			12	//fragments
+#define DLOG_FRAGMENT_FAILED	13	//fragment
+#define DLOG_UDP_BUILD_FAILED	14
+#define DLOG_LINK_BUILD_FAILED	15
+#define DLOG_TFTP_DATA_SENT		16	//payload length
+#define DLOG_TFTP_ACK_SENT		17	//payload length
+#define DLOG_TFTP_ACK			18	//block
+#define DLOG_TFTP_DATA_FAILED	19	//block
+#define DLOG_TFTP_TIMER			20
+#define DLOG_TFTP_TIMEOUT		21	//ack, timeouts
+#define DLOG_TFTP_DUPLICATE		22	//block
+#define DLOG_CLASS_DISABLED		23	//class
+#define DLOG_TFTP_DATA_RECEIVED	24	//block
+
+#if DLOG_ENABLED && defined(__AVR__)
+#define DLOG0(id) dlog_record((id), 0, 0, 0)
+#define DLOG1(id, a) dlog_record((id), 1, (a), 0)
+#define DLOG2(id, a, b) dlog_record((id), 2, (a), (b))
+#elif DLOG_ENABLED
+//the host has a console to spare and no dlog process, records are printed as they happen
+#define DLOG0(id) dlog_print(stdout, (id), 0, 0)
+#define DLOG1(id, a) dlog_print(stdout, (id), (a), 0)
+#define DLOG2(id, a, b) dlog_print(stdout, (id), (a), (b))
+#else
+#define DLOG0(id) do{ }while(0)
+#define DLOG1(id, a) do{ }while(0)
+#define DLOG2(id, a, b) do{ }while(0)
+#endif
+
+    /*!
+     * dlog_initialize()
+     * empties the ring and starts the process that drains it
+     */
+    void dlog_initialize(void);
+
+    /*!
+     * dlog_record()
+     * queues one record, safe to call from interrupt context
+     * records that do not fit are counted and reported with DLOG_OVERFLOW
+     */
+    void dlog_record(uint8_t id, uint8_t argc, uint16_t a, uint16_t b);
+
+    /*!
+     * dlog_print()
+     * writes one record to out as a line, the way dlog_decode shows it
+     * only linked into host builds, the formats never go on the node
+     */
+    void dlog_print(FILE* out, uint8_t id, uint16_t a, uint16_t b);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DLOG_H */
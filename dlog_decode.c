@@ -0,0 +1,69 @@
+/*
+ *
+ *	Decoder for the deferred binary log of a radiotftp node
+ *	reads the node's console from a file or stdin, passes plain text through
+ *	and prints every binary record as a line using the formats in dlog_print.c
+ *	Alp Sayin
+ *	19.10.2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include "dlog.h"
+
+static int readArgument(FILE* in, unsigned* value)
+{
+	int hi, lo;
+
+	hi = fgetc(in);
+	lo = fgetc(in);
+	if(hi == EOF || lo == EOF)
+		return 0;
+	*value = (hi << 8) | lo;
+	return 1;
+}
+
+int main(int ac, char *av[])
+{
+	FILE* in = stdin;
+	unsigned args[DLOG_MAX_ARGS];
+	int c, header, argc, id, i;
+
+	if(ac > 1)
+	{
+		in = fopen(av[1], "rb");
+		if(in == NULL)
+		{
+			perror("couldn't open log");
+			exit(-1);
+		}
+	}
+
+	while((c = fgetc(in)) != EOF)
+	{
+		if(c != DLOG_SYNC)
+		{
+			putchar(c);
+			continue;
+		}
+		if((header = fgetc(in)) == EOF)
+			break;
+		argc = header >> 6;
+		id = header & DLOG_MAX_ID;
+		args[0] = 0;
+		args[1] = 0;
+		for(i = 0; i < argc && i < DLOG_MAX_ARGS; i++)
+		{
+			if(!readArgument(in, &args[i]))
+				break;
+		}
+		dlog_print(stdout, id, args[0], args[1]);
+		fflush(stdout);
+	}
+
+	if(in != stdin)
+		fclose(in);
+	return 0;
+}
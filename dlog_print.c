@@ -0,0 +1,51 @@
+/*
+ * dlog_print.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "dlog.h"
+
+//one format per message id, they are only ever stored here, never on the node
+static const char* formats[DLOG_MAX_ID + 1] =
+{
+	[DLOG_OVERFLOW] = "!!! %u log records lost",
+	[DLOG_WAKEUP] = "woke up, event %u",
+	[DLOG_RX_END] = "frame ended after %u bytes",
+	[DLOG_EVENT_QUEUE_FULL] = "event queue full, transmission discarded",
+	[DLOG_TIMER] = "timer_flag=1",
+	[DLOG_SEND_REQUEST] = "starting to send request, numBytes=%u",
+	[DLOG_CHANNEL_BUSY] = "channel busy, class %u frame dropped",
+	[DLOG_DUPLICATE] = "duplicate discarded, ports %u -> %u",
+	[DLOG_UDP_DISCARDED] = "!udp discarded! errors=0x%02x",
+	[DLOG_LINK_DISCARDED] = "!link discarded! errors=0x%02x",
+	[DLOG_NOT_FOR_US] = "packet for someone else: %04x%04x",
+	[DLOG_UNASSIGNED_PORT] = "packet received for unassigned port: %u",
+	[DLOG_NO_ROOM] = "no room for %u fragments",
+	[DLOG_FRAGMENT_FAILED] = "couldn't queue fragment %u",
+	[DLOG_UDP_BUILD_FAILED] = "couldn't prepare udp packet",
+	[DLOG_LINK_BUILD_FAILED] = "couldn't prepare link packet",
+	[DLOG_TFTP_DATA_SENT] = "sent data size = %u",
+	[DLOG_TFTP_ACK_SENT] = "sent ack size = %u",
+	[DLOG_TFTP_ACK] = "tftp wrq ack #%u received",
+	[DLOG_TFTP_DATA_FAILED] = "!!! couldn't send data #%u",
+	[DLOG_TFTP_TIMER] = "tftp_timer_handler",
+	[DLOG_TFTP_TIMEOUT] = "tftp ack timer timeout %u, timeouts=%u",
+	[DLOG_TFTP_DUPLICATE] = "duplicate data #%u, acking again",
+	[DLOG_CLASS_DISABLED] = "class %u has no airtime, frame dropped",
+	[DLOG_TFTP_DATA_RECEIVED] = "tftp data #%u received",
+};
+
+void dlog_print(FILE* out, uint8_t id, uint16_t a, uint16_t b)
+{
+	if(id <= DLOG_MAX_ID && formats[id] != NULL)
+		fprintf(out, formats[id], a, b);
+	else
+		fprintf(out, "unknown log id %d (%u, %u)", id, a, b);
+	fputc('\n', out);
+}
@@ -0,0 +1,77 @@
+/*
+ * dupcache.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "dupcache.h"
+#include "udp_ip.h"
+#include "avr_util.h"
+
+/*
+ * only a 32 bit signature of the tuple is kept, a false match needs two
+ * different datagrams with the same signature inside the lifetime
+ */
+typedef struct
+{
+	uint32_t signature;
+	uint16_t seen;
+} dupcache_entry_t;
+
+static RADIO_LOCAL dupcache_entry_t entries[DUPCACHE_SIZE];
+static RADIO_LOCAL dupcache_stats_t stats;
+
+/* fnv-1a over the fields that tell datagrams apart */
+static uint32_t dupcache_hash(uint8_t* data, uint8_t len, uint32_t hash)
+{
+	while(len--)
+	{
+		hash ^= *data++;
+		hash *= 16777619UL;
+	}
+	return hash;
+}
+
+void dupcache_initialize(void)
+{
+	memset(entries, 0, sizeof(entries));
+	memset(&stats, 0, sizeof(stats));
+}
+
+uint8_t dupcache_check(uint8_t* packet_in)
+{
+	dupcache_entry_t* entry;
+	uint32_t signature = 2166136261UL;
+	uint16_t now = (uint16_t) clock_seconds();
+
+	signature = dupcache_hash(packet_in+IPV4_SOURCE_OFFSET, IPV4_SOURCE_LENGTH, signature);
+	//ports, length and checksum are adjacent in the udp header
+	signature = dupcache_hash(packet_in+UDP_SOURCE_PORT_OFFSET,
+			UDP_SOURCE_PORT_LENGTH+UDP_DESTINATION_PORT_LENGTH+UDP_LENGTH_LENGTH+UDP_CHECKSUM_LENGTH, signature);
+	//zero marks an empty entry
+	if(signature == 0)
+		signature = 1;
+
+	entry = &entries[(signature ^ (signature >> 16)) & (DUPCACHE_SIZE - 1)];
+	if(entry->signature == signature && (uint16_t) (now - entry->seen) <= DUPCACHE_LIFETIME_SECONDS)
+	{
+		stats.hits++;
+		return 1;
+	}
+	entry->signature = signature;
+	entry->seen = now;
+	stats.misses++;
+	return 0;
+}
+
+dupcache_stats_t* dupcache_get_stats(void)
+{
+	return &stats;
+}
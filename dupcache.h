@@ -0,0 +1,52 @@
+/*
+ * File:   dupcache.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef DUPCACHE_H
+#define	DUPCACHE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+/*! number of remembered datagrams, must be a power of two */
+#ifndef DUPCACHE_SIZE
+#define DUPCACHE_SIZE 16
+#endif
+/*! a datagram seen again within this time is a duplicate */
+#ifndef DUPCACHE_LIFETIME_SECONDS
+#define DUPCACHE_LIFETIME_SECONDS 30
+#endif
+
+#if (DUPCACHE_SIZE & (DUPCACHE_SIZE-1)) != 0
+#error DUPCACHE_SIZE must be a power of two
+#endif
+
+    typedef struct
+    {
+        uint16_t hits;
+        uint16_t misses;
+    } dupcache_stats_t;
+
+    void dupcache_initialize(void);
+
+    /*!
+     * dupcache_check()
+     * looks up the (source address, ports, length, udp checksum) of an udp/ip packet
+     * returns non-zero if the same datagram was seen recently, otherwise remembers it
+     */
+    uint8_t dupcache_check(uint8_t* packet_in);
+
+    dupcache_stats_t* dupcache_get_stats(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* DUPCACHE_H */
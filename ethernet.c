@@ -5,9 +5,10 @@
 #include <inttypes.h>
 
 #include "ethernet.h"
+#include "avr_util.h"
 
 //TODO stop copying, just copy the pointers, you can build this stack just with 600 bytes
-	static uint8_t local_eth_address[6]={0xFF, 0x00, 0x00, 0x00, 0x00, 0x01};
+	static RADIO_LOCAL uint8_t local_eth_address[6]={0xFF, 0x00, 0x00, 0x00, 0x00, 0x01};
     static const uint8_t eth_broadcast_address[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
     static const uint32_t eth_crc_table[] =
     {
@@ -94,8 +95,9 @@
         packet_out[len+1]=eth_len & 0xFF;
         len+=ETH_LENGTH_LENGTH;
 
-        //payload
-        memcpy(packet_out+ETH_PAYLOAD_OFFSET, payload_in, payload_length);
+        //payload, unless it was built in place already
+        if(payload_in!=packet_out+ETH_PAYLOAD_OFFSET)
+            memcpy(packet_out+ETH_PAYLOAD_OFFSET, payload_in, payload_length);
         len+=payload_length;
 
         //fcs (crc32)
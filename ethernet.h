@@ -65,6 +65,7 @@ extern "C" {
      * eth_create_packet()
      * prepares an ethernet packet with source address, target destination address and payload and puts it in packet_out
      * also computes the checksum and also puts it into the packet
+     * payload_in may already sit at packet_out+ETH_PAYLOAD_OFFSET, it is not copied then
      * on successful encapsulation function returns the length of the packet
      * else returns zero
      */
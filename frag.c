@@ -0,0 +1,245 @@
+/*
+ * frag.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "frag.h"
+#include "bufpool.h"
+#include "timers.h"
+#include "avr_util.h"
+
+typedef struct
+{
+	//borrowed from bufpool while the datagram is put together
+	uint8_t* packet;
+	int8_t block;
+	uint16_t identification;
+	//udp datagram length, zero until the last fragment shows up
+	uint16_t datagram_length;
+	uint8_t received;
+	uint8_t nacked;
+	uint8_t used;
+	unsigned long started;
+	unsigned long last_heard;
+} frag_buffer_t;
+
+static RADIO_LOCAL frag_buffer_t buffers[FRAG_NUM_BUFFERS];
+static RADIO_LOCAL frag_stats_t stats;
+static RADIO_LOCAL timers_timer_t nack_timer;
+static RADIO_LOCAL void (*nackCallback)(void) = NULL;
+
+static void frag_timer_expired(void* context)
+{
+	nackCallback();
+}
+
+static void frag_start_timer(uint8_t seconds)
+{
+	if(nackCallback != NULL)
+		timers_start(&nack_timer, seconds, 0, frag_timer_expired, NULL);
+}
+
+static void frag_nack(frag_buffer_t* buffer, uint8_t missing, uint8_t* nack_out, uint16_t* nack_length_out)
+{
+	nack_out[FRAG_NACK_IDENTIFICATION_OFFSET] = (buffer->identification >> 8) & 0xFF;
+	nack_out[FRAG_NACK_IDENTIFICATION_OFFSET + 1] = buffer->identification & 0xFF;
+	nack_out[FRAG_NACK_MISSING_OFFSET] = missing;
+	*nack_length_out = FRAG_NACK_LENGTH;
+	stats.nacks++;
+}
+
+static frag_buffer_t* frag_find(uint8_t* src, uint16_t identification)
+{
+	frag_buffer_t* victim = NULL;
+	unsigned long now = clock_seconds();
+	uint8_t i;
+
+	for(i = 0; i < FRAG_NUM_BUFFERS; i++)
+	{
+		if(buffers[i].used && now - buffers[i].started > FRAG_REASSEMBLY_TIMEOUT_SECONDS)
+		{
+			buffers[i].used = 0;
+			stats.timeouts++;
+		}
+		if(buffers[i].used && buffers[i].identification == identification
+				&& !memcmp(buffers[i].packet + IPV4_SOURCE_OFFSET, src, IPV4_SOURCE_LENGTH))
+			return &buffers[i];
+	}
+
+	//a free buffer, otherwise the oldest datagram gives way
+	for(i = 0; i < FRAG_NUM_BUFFERS; i++)
+	{
+		if(!buffers[i].used)
+		{
+			victim = &buffers[i];
+			break;
+		}
+		if(victim == NULL || buffers[i].started < victim->started)
+			victim = &buffers[i];
+	}
+	if(victim->used)
+		stats.timeouts++;
+	if(victim->block == BUFPOOL_NO_BLOCK)
+	{
+		victim->block = bufpool_alloc(BUFPOOL_OWNER_FRAG);
+		if(victim->block == BUFPOOL_NO_BLOCK)
+		{
+			stats.no_buffer++;
+			return NULL;
+		}
+		victim->packet = bufpool_data(victim->block);
+	}
+	victim->used = 1;
+	victim->identification = identification;
+	victim->datagram_length = 0;
+	victim->received = 0;
+	victim->nacked = 0;
+	victim->started = now;
+	victim->last_heard = now;
+	memcpy(victim->packet + IPV4_SOURCE_OFFSET, src, IPV4_SOURCE_LENGTH);
+	return victim;
+}
+
+void frag_initialize(void (*nack_timer)(void))
+{
+	uint8_t i;
+
+	nackCallback = nack_timer;
+	memset(buffers, 0, sizeof(buffers));
+	for(i = 0; i < FRAG_NUM_BUFFERS; i++)
+		buffers[i].block = BUFPOOL_NO_BLOCK;
+	memset(&stats, 0, sizeof(stats));
+}
+
+void frag_release(void)
+{
+	uint8_t i;
+
+	for(i = 0; i < FRAG_NUM_BUFFERS; i++)
+	{
+		if(!buffers[i].used && buffers[i].block != BUFPOOL_NO_BLOCK)
+		{
+			bufpool_free(buffers[i].block);
+			buffers[i].block = BUFPOOL_NO_BLOCK;
+			buffers[i].packet = NULL;
+		}
+	}
+}
+
+uint8_t* frag_reassemble(uint8_t* packet_in, uint16_t* length_out, uint8_t* nack_out, uint16_t* nack_length_out)
+{
+	frag_buffer_t* buffer;
+	uint16_t identification, offset, length;
+	uint8_t more, index, expected, missing;
+
+	*nack_length_out = 0;
+	stats.fragments++;
+
+	identification = packet_in[IPV4_IDENTIFICATION_OFFSET];
+	identification <<= 8;
+	identification |= packet_in[IPV4_IDENTIFICATION_OFFSET + 1];
+	offset = packet_in[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET] & 0x1F;
+	offset <<= 8;
+	offset |= packet_in[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET + 1];
+	offset <<= 3;
+	more = (packet_in[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET] >> 5) & IPV4_FLAG_MORE_FRAGMENTS;
+	length = packet_in[IPV4_TOTAL_LENGTH_OFFSET];
+	length <<= 8;
+	length |= packet_in[IPV4_TOTAL_LENGTH_OFFSET + 1];
+
+	//we only take fragments cut the way udp_create_fragment cuts them
+	if(length <= IPV4_PAYLOAD_OFFSET || (offset % UDP_FRAGMENT_LENGTH) != 0)
+		return NULL;
+	length -= IPV4_PAYLOAD_OFFSET;
+	if(offset + length > FRAG_MAX_PACKET_LENGTH - IPV4_PAYLOAD_OFFSET || (more && length != UDP_FRAGMENT_LENGTH))
+		return NULL;
+
+	buffer = frag_find(packet_in + IPV4_SOURCE_OFFSET, identification);
+	if(buffer == NULL)
+		return NULL;
+	index = offset / UDP_FRAGMENT_LENGTH;
+	if(offset == 0)
+		memcpy(buffer->packet, packet_in, IPV4_PAYLOAD_OFFSET);
+	memcpy(buffer->packet + IPV4_PAYLOAD_OFFSET + offset, packet_in + IPV4_PAYLOAD_OFFSET, length);
+	buffer->received |= 1 << index;
+	buffer->last_heard = clock_seconds();
+	if(!more)
+		buffer->datagram_length = offset + length;
+	//the timer nacks whatever is still missing if the rest does not follow
+	frag_start_timer(FRAG_NACK_DELAY_SECONDS);
+
+	if(buffer->datagram_length == 0)
+		return NULL;
+	expected = (1 << ((buffer->datagram_length + UDP_FRAGMENT_LENGTH - 1) / UDP_FRAGMENT_LENGTH)) - 1;
+	missing = expected & ~buffer->received;
+	if(missing)
+	{
+		//ask once for what the last fragment showed to be missing, the sender resends only those
+		if(!buffer->nacked)
+		{
+			frag_nack(buffer, missing, nack_out, nack_length_out);
+			buffer->nacked = 1;
+		}
+		return NULL;
+	}
+
+	//make it look like one unfragmented packet
+	length = buffer->datagram_length + IPV4_PAYLOAD_OFFSET;
+	buffer->packet[IPV4_TOTAL_LENGTH_OFFSET] = (length >> 8) & 0xFF;
+	buffer->packet[IPV4_TOTAL_LENGTH_OFFSET + 1] = length & 0xFF;
+	buffer->packet[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET] = 0;
+	buffer->packet[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET + 1] = 0;
+	buffer->used = 0;
+	stats.reassembled++;
+	*length_out = length;
+	return buffer->packet;
+}
+
+uint8_t frag_poll(uint8_t* dst_out, uint8_t* nack_out, uint16_t* nack_length_out)
+{
+	unsigned long now = clock_seconds();
+	uint8_t i, expected, waiting = 0;
+
+	*nack_length_out = 0;
+	for(i = 0; i < FRAG_NUM_BUFFERS; i++)
+	{
+		if(!buffers[i].used)
+			continue;
+		if(now - buffers[i].started > FRAG_REASSEMBLY_TIMEOUT_SECONDS)
+		{
+			buffers[i].used = 0;
+			bufpool_free(buffers[i].block);
+			buffers[i].block = BUFPOOL_NO_BLOCK;
+			buffers[i].packet = NULL;
+			stats.timeouts++;
+			continue;
+		}
+		waiting = 1;
+		if(*nack_length_out || now - buffers[i].last_heard < FRAG_NACK_DELAY_SECONDS)
+			continue;
+		//without the last fragment the tail is missing too
+		if(buffers[i].datagram_length)
+			expected = (1 << ((buffers[i].datagram_length + UDP_FRAGMENT_LENGTH - 1) / UDP_FRAGMENT_LENGTH)) - 1;
+		else
+			expected = (1 << FRAG_MAX_FRAGMENTS) - 1;
+		frag_nack(&buffers[i], expected & ~buffers[i].received, nack_out, nack_length_out);
+		memcpy(dst_out, buffers[i].packet + IPV4_SOURCE_OFFSET, IPV4_SOURCE_LENGTH);
+		buffers[i].last_heard = now;
+	}
+	if(waiting)
+		frag_start_timer(1);
+	return *nack_length_out != 0;
+}
+
+frag_stats_t* frag_get_stats(void)
+{
+	return &stats;
+}
@@ -0,0 +1,99 @@
+/*
+ * File:   frag.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef FRAG_H
+#define	FRAG_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+#include "udp_ip.h"
+
+/*! datagrams reassembled at the same time, each one borrows a bufpool block while it is incomplete */
+#ifndef FRAG_NUM_BUFFERS
+#define FRAG_NUM_BUFFERS 1
+#endif
+/*! a datagram still missing fragments after this long is thrown away */
+#ifndef FRAG_REASSEMBLY_TIMEOUT_SECONDS
+#define FRAG_REASSEMBLY_TIMEOUT_SECONDS 10
+#endif
+/*! an incomplete datagram nothing was heard of for this long is nacked for whatever it lacks */
+#ifndef FRAG_NACK_DELAY_SECONDS
+#define FRAG_NACK_DELAY_SECONDS 2
+#endif
+
+#define FRAG_MAX_PACKET_LENGTH (IPV4_PAYLOAD_OFFSET+8+UDP_MAX_DATAGRAM_LENGTH)
+#define FRAG_MAX_FRAGMENTS ((8+UDP_MAX_DATAGRAM_LENGTH+UDP_FRAGMENT_LENGTH-1)/UDP_FRAGMENT_LENGTH)
+
+/*
+ * fragment nack payload, sent back to the source when the last fragment
+ * arrived but earlier ones are missing, or when the reassembly timer finds
+ * the datagram went quiet, all fields big endian
+ * identification(2) missing_fragments(1), bit i is the fragment at i*UDP_FRAGMENT_LENGTH
+ * while the last fragment is unknown every fragment not received yet is named,
+ * the sender ignores bits beyond the fragments it sent
+ */
+#define FRAG_NACK_IDENTIFICATION_OFFSET 0
+#define FRAG_NACK_MISSING_OFFSET 2
+#define FRAG_NACK_LENGTH 3
+
+#if FRAG_MAX_FRAGMENTS > 8
+#error a fragment nack can only name eight fragments
+#endif
+
+    typedef struct
+    {
+        uint16_t fragments;
+        uint16_t reassembled;
+        uint16_t timeouts;
+        uint16_t nacks;
+        uint16_t no_buffer;
+    } frag_stats_t;
+
+    /*!
+     * frag_initialize()
+     * nack_timer is called whenever frag_poll() may have a nack to send, on the node
+     * it runs from the timer wheel, NULL leaves calling frag_poll() regularly to the caller
+     */
+    void frag_initialize(void (*nack_timer)(void));
+
+    /*!
+     * frag_reassemble()
+     * stores one fragment, once every fragment is in returns the whole ip packet,
+     * header fixed up so udp_open_packet can read it, and writes its length to length_out
+     * returns NULL while the datagram is incomplete
+     * if the last fragment showed holes, nack_out gets a nack payload and *nack_length_out its length
+     */
+    uint8_t* frag_reassemble(uint8_t* packet_in, uint16_t* length_out, uint8_t* nack_out, uint16_t* nack_length_out);
+
+    /*!
+     * frag_release()
+     * gives the blocks of finished and timed out datagrams back to bufpool
+     * a packet returned by frag_reassemble is only valid until this is called
+     */
+    void frag_release(void);
+
+    /*!
+     * frag_poll()
+     * the reassembly timer, throws away timed out datagrams and for one that has gone
+     * quiet writes a nack payload to nack_out, its length to *nack_length_out and the
+     * address to send it to to dst_out
+     * returns non-zero while it has a nack, call it again until it returns zero
+     */
+    uint8_t frag_poll(uint8_t* dst_out, uint8_t* nack_out, uint16_t* nack_length_out);
+
+    frag_stats_t* frag_get_stats(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* FRAG_H */
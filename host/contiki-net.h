@@ -0,0 +1,2 @@
+/* the host has nothing beyond contiki.h */
+#include "contiki.h"
@@ -0,0 +1,121 @@
+/*
+ * contiki.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "avr_util.h"
+
+static RADIO_LOCAL struct ctimer* armed = NULL;
+
+clock_time_t clock_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (clock_time_t) now.tv_sec * CLOCK_SECOND + now.tv_nsec / (1000000000 / CLOCK_SECOND);
+}
+
+unsigned long clock_seconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec;
+}
+
+static void ctimer_unlink(struct ctimer* c)
+{
+	struct ctimer** link;
+
+	for(link = &armed; *link != NULL; link = &(*link)->next)
+	{
+		if(*link == c)
+		{
+			*link = c->next;
+			break;
+		}
+	}
+	c->next = NULL;
+}
+
+static void ctimer_link(struct ctimer* c)
+{
+	ctimer_unlink(c);
+	c->next = armed;
+	armed = c;
+}
+
+void ctimer_set(struct ctimer* c, clock_time_t t, void (*f)(void*), void* ptr)
+{
+	c->start = clock_time();
+	c->interval = t;
+	c->f = f;
+	c->ptr = ptr;
+	ctimer_link(c);
+}
+
+void ctimer_reset(struct ctimer* c)
+{
+	//like contiki, the next period counts from when the last one should have ended
+	c->start += c->interval;
+	ctimer_link(c);
+}
+
+void ctimer_stop(struct ctimer* c)
+{
+	ctimer_unlink(c);
+	c->f = NULL;
+}
+
+int ctimer_expired(struct ctimer* c)
+{
+	struct ctimer* i;
+
+	for(i = armed; i != NULL; i = i->next)
+	{
+		if(i == c)
+			return 0;
+	}
+	return 1;
+}
+
+uint16_t ctimer_run(uint16_t timeout_ms)
+{
+	struct ctimer* c;
+	clock_time_t now, left;
+	uint8_t fired;
+
+	do
+	{
+		fired = 0;
+		now = clock_time();
+		for(c = armed; c != NULL; c = c->next)
+		{
+			if(now - c->start >= c->interval)
+			{
+				//the callback may arm, reset or stop any timer, start over after it
+				ctimer_unlink(c);
+				c->f(c->ptr);
+				fired = 1;
+				break;
+			}
+		}
+	}
+	while(fired);
+
+	for(c = armed; c != NULL; c = c->next)
+	{
+		left = c->interval - (now - c->start);
+		if(left < timeout_ms)
+			timeout_ms = left;
+	}
+	return timeout_ms;
+}
@@ -0,0 +1,58 @@
+/*
+ * File:   contiki.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef CONTIKI_H
+#define	CONTIKI_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+/*
+ * host stand-ins for the few contiki services the shared modules use
+ * the clock runs in milliseconds off CLOCK_MONOTONIC, ctimers fire from
+ * ctimer_run() in the main loop of the thread that armed them
+ */
+
+typedef uint64_t clock_time_t;
+#define CLOCK_SECOND 1000
+
+    clock_time_t clock_time(void);
+    unsigned long clock_seconds(void);
+
+    struct ctimer
+    {
+        struct ctimer* next;
+        clock_time_t start;
+        clock_time_t interval;
+        void (*f)(void*);
+        void* ptr;
+    };
+
+    void ctimer_set(struct ctimer* c, clock_time_t t, void (*f)(void*), void* ptr);
+    void ctimer_reset(struct ctimer* c);
+    void ctimer_stop(struct ctimer* c);
+    int ctimer_expired(struct ctimer* c);
+
+    /*!
+     * ctimer_run()
+     * calls back every expired ctimer, returns the milliseconds until the next one
+     * or timeout_ms if that is sooner
+     */
+    uint16_t ctimer_run(uint16_t timeout_ms);
+
+/*! radiotftp.h names the node's process, the host has none */
+#define PROCESS_NAME(name) extern int name
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* CONTIKI_H */
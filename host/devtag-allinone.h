@@ -0,0 +1,29 @@
+/*
+ * File:   devtag-allinone.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef DEVTAG_ALLINONE_H
+#define	DEVTAG_ALLINONE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * radios are named on the command line by path or by the tag of their node in /dev,
+ * e.g. ttyUSB0 or serial/by-id/usb-FTDI_..., so a usb radio keeps its name across plugs
+ */
+static inline char* devtag_get(char* tag)
+{
+	static char path[128];
+
+	if(tag[0] == '/' || access(tag, F_OK) == 0)
+		return tag;
+	snprintf(path, sizeof(path), "/dev/%s", tag);
+	return path;
+}
+
+#endif	/* DEVTAG_ALLINONE_H */
@@ -0,0 +1,80 @@
+/*
+ * lock.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+
+#include "lock.h"
+#include "avr_util.h"
+
+static RADIO_LOCAL char lockfile[128] = "";
+static RADIO_LOCAL int retries = LOCK_RETRIES;
+
+int get_lock(const char* tty)
+{
+	const char* name;
+	char text[16];
+	int fd, length;
+	long pid;
+
+	name = strrchr(tty, '/');
+	name = (name != NULL) ? name + 1 : tty;
+	snprintf(lockfile, sizeof(lockfile), "%s/LCK..%s", P_LOCK, name);
+
+	if((fd = open(lockfile, O_RDONLY)) >= 0)
+	{
+		length = read(fd, text, sizeof(text) - 1);
+		close(fd);
+		text[length > 0 ? length : 0] = 0;
+		pid = strtol(text, NULL, 10);
+		if(pid > 0 && pid != getpid() && (kill(pid, 0) == 0 || errno == EPERM))
+		{
+			fprintf(stderr, "%s is locked by process %ld\n", tty, pid);
+			lockfile[0] = 0;
+			return 0;
+		}
+		//whoever left it is gone
+		unlink(lockfile);
+	}
+
+	if((fd = open(lockfile, O_WRONLY | O_CREAT | O_EXCL, 0644)) < 0)
+	{
+		if(errno == ENOENT || errno == EACCES)
+		{
+			//nowhere to put a lock, nobody else can see one either
+			lockfile[0] = 0;
+			return 1;
+		}
+		lockfile[0] = 0;
+		return 0;
+	}
+	length = snprintf(text, sizeof(text), "%10ld\n", (long) getpid());
+	if(write(fd, text, length) != length)
+		perror("couldn't write lock file");
+	close(fd);
+	return 1;
+}
+
+int decrementLockRetries(void)
+{
+	if(retries > 0)
+		retries--;
+	return retries;
+}
+
+void lockfile_remove(void)
+{
+	if(lockfile[0])
+		unlink(lockfile);
+	lockfile[0] = 0;
+}
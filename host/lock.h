@@ -0,0 +1,51 @@
+/*
+ * File:   lock.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef LOCK_H
+#define	LOCK_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * uucp style lock files in P_LOCK, one per tty, holding the pid of the owner
+ * so minicom, pppd and other radiotftp instances keep off a radio in use
+ */
+
+#ifndef P_LOCK
+#define P_LOCK "/var/lock"
+#endif
+/*! times get_lock() may fail before the caller gives up */
+#ifndef LOCK_RETRIES
+#define LOCK_RETRIES 5
+#endif
+
+    /*!
+     * get_lock()
+     * locks tty for this process, a lock left by a process that is gone is taken over
+     * returns non-zero once the lock is held, also when there is no lock directory at all
+     */
+    int get_lock(const char* tty);
+
+    /*!
+     * decrementLockRetries()
+     * returns the retries left after this one
+     */
+    int decrementLockRetries(void);
+
+    /*!
+     * lockfile_remove()
+     * removes the lock get_lock() took, if any
+     */
+    void lockfile_remove(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* LOCK_H */
@@ -0,0 +1,385 @@
+/*
+ * jobqueue.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "jobqueue.h"
+#include "avr_util.h"
+
+typedef struct
+{
+	int fd;
+	char line[JOBQUEUE_MAX_LINE];
+	uint16_t length;
+	uint8_t attached;
+} client_t;
+
+static RADIO_LOCAL job_t jobs[JOBQUEUE_MAX_JOBS];
+static RADIO_LOCAL client_t clients[JOBQUEUE_MAX_CLIENTS];
+static RADIO_LOCAL jobqueue_stats_t jobqueue_stats;
+static RADIO_LOCAL int listenFd = -1;
+static RADIO_LOCAL uint32_t nextId = 1;
+static RADIO_LOCAL uint8_t ready = 0;
+static RADIO_LOCAL uint8_t attachedLost = 0;
+static RADIO_LOCAL char socketPath[sizeof(((struct sockaddr_un*) 0)->sun_path)] = "";
+
+static void jobqueue_reset(void)
+{
+	uint8_t i;
+
+	if(ready)
+		return;
+	memset(jobs, 0, sizeof(jobs));
+	memset(&jobqueue_stats, 0, sizeof(jobqueue_stats));
+	for(i = 0; i < JOBQUEUE_MAX_CLIENTS; i++)
+	{
+		clients[i].fd = -1;
+		clients[i].length = 0;
+		clients[i].attached = 0;
+	}
+	ready = 1;
+}
+
+static void jobqueue_reply(int fd, const char* reply)
+{
+	//a client that went away must not take the daemon with it through SIGPIPE
+	if(send(fd, reply, strlen(reply), MSG_NOSIGNAL) < 0)
+		perror("job client write");
+}
+
+static void jobqueue_drop_client(client_t* client)
+{
+	if(client->attached)
+		attachedLost = 1;
+	close(client->fd);
+	client->fd = -1;
+	client->length = 0;
+}
+
+/* parses one request line into a free job, replies and returns non-zero if the connection stays with the job */
+static uint8_t jobqueue_parse(int fd, char* line, uint8_t attached)
+{
+	unsigned priority, wait;
+	int consumed = 0;
+	char reply[64];
+	job_t* job = NULL;
+	uint8_t i;
+
+	for(i = 0; i < JOBQUEUE_MAX_JOBS; i++)
+	{
+		if(jobs[i].state == JOBQUEUE_JOB_FREE)
+		{
+			job = &jobs[i];
+			break;
+		}
+	}
+	if(job == NULL)
+	{
+		jobqueue_stats.rejected++;
+		jobqueue_reply(fd, "rejected queue full\n");
+		return 0;
+	}
+	if(sscanf(line, "%u %u %31s %31s %n", &priority, &wait, job->destination, job->local_filename, &consumed) < 4 || consumed == 0
+			|| priority >= JOBQUEUE_PRIORITIES || line[consumed] == 0 || strlen(line + consumed) >= JOBQUEUE_MAX_COMMAND)
+	{
+		jobqueue_stats.rejected++;
+		jobqueue_reply(fd, "rejected bad request\n");
+		return 0;
+	}
+	//'-' leaves the daemon's defaults in place
+	if(!strcmp(job->destination, "-"))
+		job->destination[0] = 0;
+	if(!strcmp(job->local_filename, "-"))
+		job->local_filename[0] = 0;
+	job->command_length = strlen(line + consumed);
+	memcpy(job->command, line + consumed, job->command_length + 1);
+	job->priority = priority;
+	job->id = nextId++;
+	if(attached)
+		wait = 1;
+	job->client = wait ? fd : -1;
+	job->keep_client = attached;
+	job->state = JOBQUEUE_JOB_WAITING;
+	jobqueue_stats.submitted++;
+	jobqueue_stats.waiting++;
+
+	sprintf(reply, "queued %" PRIu32 "\n", job->id);
+	jobqueue_reply(fd, reply);
+	return wait != 0;
+}
+
+static void jobqueue_read(client_t* client)
+{
+	char* end;
+	int res;
+
+	res = read(client->fd, client->line + client->length, sizeof(client->line) - 1 - client->length);
+	if(res < 0 && (errno == EAGAIN || errno == EINTR))
+		return;
+	if(res <= 0)
+	{
+		jobqueue_drop_client(client);
+		return;
+	}
+	client->length += res;
+	client->line[client->length] = 0;
+	//an attached connection carries any number of requests
+	while(client->attached && (end = strchr(client->line, '\n')) != NULL)
+	{
+		*end = 0;
+		jobqueue_parse(client->fd, client->line, 1);
+		client->length -= end + 1 - client->line;
+		memmove(client->line, end + 1, client->length + 1);
+	}
+	end = strchr(client->line, '\n');
+	if(end == NULL)
+	{
+		if(client->length >= sizeof(client->line) - 1)
+		{
+			jobqueue_stats.rejected++;
+			jobqueue_reply(client->fd, "rejected line too long\n");
+			jobqueue_drop_client(client);
+		}
+		return;
+	}
+	*end = 0;
+	if(jobqueue_parse(client->fd, client->line, 0))
+	{
+		//the job owns the connection now
+		client->fd = -1;
+		client->length = 0;
+		return;
+	}
+	jobqueue_drop_client(client);
+}
+
+int jobqueue_initialize(const char* path)
+{
+	struct sockaddr_un address;
+
+	jobqueue_reset();
+	if(strlen(path) >= sizeof(address.sun_path))
+	{
+		fprintf(stderr, "job socket path too long\n");
+		return -1;
+	}
+
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(listenFd < 0)
+	{
+		perror("couldn't create job socket");
+		return -1;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	strcpy(socketPath, path);
+	//only one daemon holds the tty lock, so whatever is at path was left behind
+	unlink(path);
+	if(bind(listenFd, (struct sockaddr*) &address, sizeof(address)) < 0 || listen(listenFd, JOBQUEUE_MAX_CLIENTS) < 0)
+	{
+		perror("couldn't listen on job socket");
+		close(listenFd);
+		listenFd = -1;
+		return -1;
+	}
+	fcntl(listenFd, F_SETFL, O_NONBLOCK);
+	return 0;
+}
+
+int jobqueue_attach(int fd)
+{
+	uint8_t i;
+
+	jobqueue_reset();
+	for(i = 0; i < JOBQUEUE_MAX_CLIENTS; i++)
+	{
+		if(clients[i].fd < 0)
+		{
+			fcntl(fd, F_SETFL, O_NONBLOCK);
+			clients[i].fd = fd;
+			clients[i].length = 0;
+			clients[i].attached = 1;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+int jobqueue_poll(void)
+{
+	int fd;
+	uint8_t i;
+
+	if(!ready)
+		return 0;
+
+	//connections beyond the free slots wait in the listen backlog
+	for(i = 0; listenFd >= 0 && i < JOBQUEUE_MAX_CLIENTS; i++)
+	{
+		if(clients[i].fd >= 0)
+			continue;
+		if((fd = accept(listenFd, NULL, NULL)) < 0)
+			break;
+		fcntl(fd, F_SETFL, O_NONBLOCK);
+		clients[i].fd = fd;
+		clients[i].length = 0;
+		clients[i].attached = 0;
+	}
+
+	for(i = 0; i < JOBQUEUE_MAX_CLIENTS; i++)
+	{
+		if(clients[i].fd >= 0)
+			jobqueue_read(&clients[i]);
+	}
+	return attachedLost ? -1 : 0;
+}
+
+job_t* jobqueue_next(void)
+{
+	job_t* next = NULL;
+	uint8_t i;
+
+	for(i = 0; i < JOBQUEUE_MAX_JOBS; i++)
+	{
+		if(jobs[i].state != JOBQUEUE_JOB_WAITING)
+			continue;
+		if(next == NULL || jobs[i].priority < next->priority || (jobs[i].priority == next->priority && jobs[i].id < next->id))
+			next = &jobs[i];
+	}
+	if(next != NULL)
+	{
+		next->state = JOBQUEUE_JOB_RUNNING;
+		jobqueue_stats.waiting--;
+	}
+	return next;
+}
+
+void jobqueue_finish(job_t* job, int result)
+{
+	char reply[64];
+
+	if(job == NULL || job->state == JOBQUEUE_JOB_FREE)
+		return;
+	if(job->state == JOBQUEUE_JOB_WAITING)
+		jobqueue_stats.waiting--;
+	if(result == 0)
+		jobqueue_stats.completed++;
+	else
+		jobqueue_stats.failed++;
+	if(job->client >= 0)
+	{
+		sprintf(reply, "done %" PRIu32 " %d\n", job->id, result);
+		jobqueue_reply(job->client, reply);
+		if(!job->keep_client)
+			close(job->client);
+		job->client = -1;
+	}
+	job->state = JOBQUEUE_JOB_FREE;
+}
+
+void jobqueue_close(void)
+{
+	uint8_t i;
+
+	if(!ready)
+		return;
+	for(i = 0; i < JOBQUEUE_MAX_JOBS; i++)
+		jobqueue_finish(&jobs[i], -1);
+	for(i = 0; i < JOBQUEUE_MAX_CLIENTS; i++)
+	{
+		if(clients[i].fd >= 0)
+			jobqueue_drop_client(&clients[i]);
+	}
+	if(listenFd >= 0)
+	{
+		close(listenFd);
+		listenFd = -1;
+		unlink(socketPath);
+	}
+	ready = 0;
+}
+
+void jobqueue_get_stats(jobqueue_stats_t* stats)
+{
+	memcpy(stats, &jobqueue_stats, sizeof(jobqueue_stats_t));
+}
+
+int jobqueue_submit(const char* path, uint8_t priority, uint8_t wait, const char* destination, const char* local_filename, const char* command)
+{
+	struct sockaddr_un address;
+	char line[JOBQUEUE_MAX_LINE + 1];
+	char* end;
+	uint32_t id;
+	int fd, res, length = 0, result = 0;
+
+	if(strlen(path) >= sizeof(address.sun_path))
+	{
+		fprintf(stderr, "job socket path too long\n");
+		return -1;
+	}
+	length = snprintf(line, sizeof(line), "%u %u %s %s %s\n", priority, wait ? 1 : 0, (destination != NULL && destination[0]) ? destination : "-",
+			(local_filename != NULL && local_filename[0]) ? local_filename : "-", command);
+	if(length >= JOBQUEUE_MAX_LINE)
+	{
+		fprintf(stderr, "job too long\n");
+		return -1;
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0)
+	{
+		perror("couldn't create job socket");
+		return -1;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	if(connect(fd, (struct sockaddr*) &address, sizeof(address)) < 0)
+	{
+		perror("couldn't reach the radiotftp daemon");
+		close(fd);
+		return -1;
+	}
+	if(write(fd, line, length) != length)
+	{
+		perror("couldn't send job");
+		close(fd);
+		return -1;
+	}
+
+	//answers are whole lines, the daemon closes the connection after the last one
+	length = 0;
+	while((res = read(fd, line + length, JOBQUEUE_MAX_LINE - length)) > 0)
+	{
+		length += res;
+		line[length] = 0;
+		while((end = strchr(line, '\n')) != NULL)
+		{
+			*end = 0;
+			printf("%s\n", line);
+			if(!strncmp(line, "rejected", strlen("rejected")))
+				result = -1;
+			else if(sscanf(line, "done %" SCNu32 " %d", &id, &res) == 2)
+				result = res;
+			length -= end + 1 - line;
+			memmove(line, end + 1, length + 1);
+		}
+	}
+	close(fd);
+	return result;
+}
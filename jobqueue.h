@@ -0,0 +1,124 @@
+/*
+ * File:   jobqueue.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef JOBQUEUE_H
+#define	JOBQUEUE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+/*
+ * host daemon job queue on a unix domain socket
+ * a client sends one line per job:
+ *     <priority> <wait> <destination ip|-> <local filename|-> <command...>\n
+ * where command is what radiotftp takes on its command line, e.g. "put remote.txt"
+ * the daemon answers "queued <id>\n" or "rejected <reason>\n", and if wait is 1 keeps
+ * the connection open until it can answer "done <id> <result>\n"
+ */
+
+/*! jobs waiting or running, later submissions are rejected */
+#ifndef JOBQUEUE_MAX_JOBS
+#define JOBQUEUE_MAX_JOBS 32
+#endif
+/*! connections still sending their request line */
+#ifndef JOBQUEUE_MAX_CLIENTS
+#define JOBQUEUE_MAX_CLIENTS 8
+#endif
+/*! 0 is the most urgent, jobs of the same priority run in submission order */
+#define JOBQUEUE_PRIORITIES 4
+#define JOBQUEUE_DEFAULT_PRIORITY 2
+#define JOBQUEUE_MAX_LINE 320
+#define JOBQUEUE_MAX_COMMAND 256
+#define JOBQUEUE_MAX_FIELD 32
+
+#define JOBQUEUE_JOB_FREE		0
+#define JOBQUEUE_JOB_WAITING	1
+#define JOBQUEUE_JOB_RUNNING	2
+
+    typedef struct
+    {
+        uint32_t id;
+        uint8_t state;
+        uint8_t priority;
+        //connection waiting for the result, -1 once nobody is
+        int client;
+        //the connection came from jobqueue_attach() and stays open after the result
+        uint8_t keep_client;
+        char destination[JOBQUEUE_MAX_FIELD];
+        char local_filename[JOBQUEUE_MAX_FIELD];
+        char command[JOBQUEUE_MAX_COMMAND];
+        uint16_t command_length;
+    } job_t;
+
+    typedef struct
+    {
+        uint32_t submitted;
+        uint32_t rejected;
+        uint32_t completed;
+        uint32_t failed;
+        uint8_t waiting;
+    } jobqueue_stats_t;
+
+    /*!
+     * jobqueue_initialize()
+     * binds and listens on path, a stale socket left by an earlier daemon is replaced
+     * returns zero on success
+     */
+    int jobqueue_initialize(const char* path);
+
+    /*!
+     * jobqueue_attach()
+     * takes requests from an already connected fd as well, e.g. a pipe from a supervisor
+     * every request on it waits for its result and the connection stays open
+     * returns zero on success
+     */
+    int jobqueue_attach(int fd);
+
+    /*!
+     * jobqueue_poll()
+     * never blocks, accepts connections and queues every complete request line
+     * returns negative once the attached connection is closed
+     */
+    int jobqueue_poll(void);
+
+    /*!
+     * jobqueue_next()
+     * takes the most urgent waiting job off the queue, NULL if there is none
+     * the job stays valid until it is given to jobqueue_finish()
+     */
+    job_t* jobqueue_next(void);
+
+    /*!
+     * jobqueue_finish()
+     * reports result to a waiting client and frees the job
+     */
+    void jobqueue_finish(job_t* job, int result);
+
+    /*!
+     * jobqueue_close()
+     * fails every job left and removes the socket
+     */
+    void jobqueue_close(void);
+
+    void jobqueue_get_stats(jobqueue_stats_t* stats);
+
+    /*!
+     * jobqueue_submit()
+     * client side, sends one job to the daemon listening on path and prints its answers
+     * returns the job's result when waiting, zero once queued otherwise, negative on failure
+     */
+    int jobqueue_submit(const char* path, uint8_t priority, uint8_t wait, const char* destination, const char* local_filename, const char* command);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* JOBQUEUE_H */
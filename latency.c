@@ -0,0 +1,233 @@
+/*
+ * latency.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "latency.h"
+#include "tftp.h"
+#include "udp_ip.h"
+#include "avr_util.h"
+
+#define PEER_ADDRESS_LENGTH IPV4_DESTINATION_LENGTH
+
+typedef struct
+{
+	uint8_t address[PEER_ADDRESS_LENGTH];
+	uint8_t used;
+	latency_histogram_t metrics[LATENCY_NUM_METRICS];
+	uint32_t aborted;
+} latency_peer_t;
+
+/*
+ * tftp runs one transfer at a time, its request usually goes to the broadcast address
+ * so it is kept apart from the peers and charged to whoever sends the first ack
+ */
+typedef struct
+{
+	uint8_t in_transfer;
+	uint8_t waiting_first_ack;
+	uint8_t block_retransmitted;
+	uint16_t block;
+	uint32_t retransmissions;
+	uint64_t request_ms;
+	uint64_t block_ms;
+	uint8_t requested[PEER_ADDRESS_LENGTH];
+	//NULL until the first ack
+	latency_peer_t* responder;
+} latency_transfer_t;
+
+static RADIO_LOCAL latency_peer_t peers[LATENCY_MAX_PEERS];
+static RADIO_LOCAL latency_transfer_t transfer;
+
+static const char* metric_names[LATENCY_NUM_METRICS] =
+{ "first_ack_ms", "block_rtt_ms", "transfer_ms", "retransmissions" };
+
+static uint64_t latency_now_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static uint8_t latency_bucket(uint32_t value)
+{
+	uint8_t exponent = 0;
+
+	if(value < (1 << LATENCY_SUB_BUCKET_BITS))
+		return value;
+	while((value >> exponent) > 1)
+		exponent++;
+	//the top bit picks the power of two, the two bits below it the sub-bucket
+	return ((exponent - 1) << LATENCY_SUB_BUCKET_BITS) + ((value >> (exponent - LATENCY_SUB_BUCKET_BITS)) & 3);
+}
+
+static uint32_t latency_bucket_lower(uint8_t bucket)
+{
+	uint8_t exponent = (bucket >> LATENCY_SUB_BUCKET_BITS) + 1;
+
+	if(bucket < (1 << LATENCY_SUB_BUCKET_BITS))
+		return bucket;
+	return (uint32_t) (4 | (bucket & 3)) << (exponent - LATENCY_SUB_BUCKET_BITS);
+}
+
+static latency_peer_t* latency_find(uint8_t* address)
+{
+	uint8_t i;
+
+	for(i = 0; i < LATENCY_MAX_PEERS; i++)
+	{
+		if(peers[i].used && !memcmp(peers[i].address, address, PEER_ADDRESS_LENGTH))
+			return &peers[i];
+	}
+	for(i = 0; i < LATENCY_MAX_PEERS; i++)
+	{
+		if(!peers[i].used)
+		{
+			peers[i].used = 1;
+			memcpy(peers[i].address, address, PEER_ADDRESS_LENGTH);
+			return &peers[i];
+		}
+	}
+	return NULL;
+}
+
+void latency_initialize(void)
+{
+	memset(peers, 0, sizeof(peers));
+	memset(&transfer, 0, sizeof(transfer));
+}
+
+void latency_record(latency_histogram_t* histogram, uint32_t value)
+{
+	if(histogram->count == 0 || value < histogram->min)
+		histogram->min = value;
+	if(value > histogram->max)
+		histogram->max = value;
+	histogram->count++;
+	histogram->sum += value;
+	histogram->buckets[latency_bucket(value)]++;
+}
+
+uint32_t latency_percentile(latency_histogram_t* histogram, uint8_t percent)
+{
+	uint64_t rank, seen = 0;
+	uint32_t upper;
+	uint8_t i;
+
+	if(histogram->count == 0)
+		return 0;
+	rank = ((uint64_t) histogram->count * percent + 99) / 100;
+	if(rank == 0)
+		rank = 1;
+	for(i = 0; i < LATENCY_BUCKETS; i++)
+	{
+		seen += histogram->buckets[i];
+		if(seen >= rank)
+			break;
+	}
+	upper = (i + 1 < LATENCY_BUCKETS) ? latency_bucket_lower(i + 1) - 1 : histogram->max;
+	return (upper < histogram->max) ? upper : histogram->max;
+}
+
+void latency_tftp_event(uint8_t event, uint8_t* peer, uint16_t block)
+{
+	latency_peer_t* state;
+	uint64_t now = latency_now_ms();
+
+	switch(event)
+	{
+	case TFTP_EVENT_REQUEST:
+		transfer.in_transfer = 1;
+		transfer.waiting_first_ack = 1;
+		transfer.block = 0;
+		transfer.block_retransmitted = 0;
+		transfer.retransmissions = 0;
+		transfer.request_ms = now;
+		transfer.block_ms = now;
+		memcpy(transfer.requested, peer, PEER_ADDRESS_LENGTH);
+		transfer.responder = NULL;
+		break;
+	case TFTP_EVENT_DATA:
+		transfer.block = block;
+		transfer.block_ms = now;
+		transfer.block_retransmitted = 0;
+		break;
+	case TFTP_EVENT_RETRANSMIT:
+		transfer.retransmissions++;
+		transfer.block_retransmitted = 1;
+		break;
+	case TFTP_EVENT_ACK:
+		if(!transfer.in_transfer)
+			break;
+		if(transfer.waiting_first_ack)
+		{
+			transfer.waiting_first_ack = 0;
+			transfer.responder = latency_find(peer);
+			if(transfer.responder != NULL)
+				latency_record(&transfer.responder->metrics[LATENCY_FIRST_ACK], now - transfer.request_ms);
+		}
+		else if(transfer.responder != NULL && block == transfer.block && !transfer.block_retransmitted)
+		{
+			//only samples nobody can confuse with an ack to an earlier copy
+			latency_record(&transfer.responder->metrics[LATENCY_BLOCK_RTT], now - transfer.block_ms);
+		}
+		break;
+	case TFTP_EVENT_COMPLETE:
+	case TFTP_EVENT_ABORT:
+		if(!transfer.in_transfer)
+			break;
+		transfer.in_transfer = 0;
+		//nobody answered, the transfer is charged to where the request went
+		state = (transfer.responder != NULL) ? transfer.responder : latency_find(transfer.requested);
+		if(state == NULL)
+			break;
+		latency_record(&state->metrics[LATENCY_RETRANSMISSIONS], transfer.retransmissions);
+		if(event == TFTP_EVENT_COMPLETE)
+			latency_record(&state->metrics[LATENCY_TRANSFER], now - transfer.request_ms);
+		else
+			state->aborted++;
+		break;
+	}
+}
+
+void latency_dump(FILE* out)
+{
+	latency_histogram_t* histogram;
+	uint8_t i, metric, bucket, separator;
+
+	fprintf(out, "#peer\tmetric\tcount\tmin\tp50\tp95\tp99\tmax\tmean\tbuckets\n");
+	for(i = 0; i < LATENCY_MAX_PEERS; i++)
+	{
+		if(!peers[i].used)
+			continue;
+		for(metric = 0; metric < LATENCY_NUM_METRICS; metric++)
+		{
+			histogram = &peers[i].metrics[metric];
+			fprintf(out, "%u.%u.%u.%u\t%s\t%" PRIu32 "\t%" PRIu32 "\t%" PRIu32 "\t%" PRIu32 "\t%" PRIu32 "\t%" PRIu32 "\t%" PRIu64 "\t", peers[i].address[0],
+					peers[i].address[1], peers[i].address[2], peers[i].address[3], metric_names[metric], histogram->count, histogram->min,
+					latency_percentile(histogram, 50), latency_percentile(histogram, 95), latency_percentile(histogram, 99), histogram->max,
+					histogram->count ? histogram->sum / histogram->count : 0);
+			separator = 0;
+			for(bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+			{
+				if(histogram->buckets[bucket] == 0)
+					continue;
+				fprintf(out, "%s%" PRIu32 ":%" PRIu32, separator ? "," : "", latency_bucket_lower(bucket), histogram->buckets[bucket]);
+				separator = 1;
+			}
+			fprintf(out, "\n");
+		}
+		fprintf(out, "%u.%u.%u.%u\taborted_transfers\t%" PRIu32 "\t\t\t\t\t\t\t\n", peers[i].address[0], peers[i].address[1], peers[i].address[2],
+				peers[i].address[3], peers[i].aborted);
+	}
+	fflush(out);
+}
@@ -0,0 +1,83 @@
+/*
+ * File:   latency.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef LATENCY_H
+#define	LATENCY_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * host side tftp timing, one set of histograms per peer
+ * a transfer is charged to the peer that sends its first ack, not to the broadcast
+ * address its request usually goes to
+ * buckets are logarithmic with four sub-buckets per power of two, values below
+ * four fall in buckets of their own, so every bucket is at most 25% wide
+ */
+
+/*! peers tracked, later ones are not recorded */
+#ifndef LATENCY_MAX_PEERS
+#define LATENCY_MAX_PEERS 16
+#endif
+
+#define LATENCY_SUB_BUCKET_BITS 2
+#define LATENCY_BUCKETS 124
+
+#define LATENCY_FIRST_ACK		0	//request sent to the first ack, ms
+#define LATENCY_BLOCK_RTT		1	//data block sent to its ack, blocks that were retransmitted are left out, ms
+#define LATENCY_TRANSFER		2	//request sent to transmission complete, ms
+#define LATENCY_RETRANSMISSIONS	3	//retransmissions per transfer
+#define LATENCY_NUM_METRICS		4
+
+    typedef struct
+    {
+        uint32_t buckets[LATENCY_BUCKETS];
+        uint32_t count;
+        uint32_t min;
+        uint32_t max;
+        uint64_t sum;
+    } latency_histogram_t;
+
+    void latency_initialize(void);
+
+    /*!
+     * latency_record()
+     * adds value to histogram
+     */
+    void latency_record(latency_histogram_t* histogram, uint32_t value);
+
+    /*!
+     * latency_percentile()
+     * upper bound of the bucket holding the given percentile, never above the largest value seen
+     */
+    uint32_t latency_percentile(latency_histogram_t* histogram, uint8_t percent);
+
+    /*!
+     * latency_tftp_event()
+     * tftp event handler, see tftp_set_event_handler()
+     */
+    void latency_tftp_event(uint8_t event, uint8_t* peer, uint16_t block);
+
+    /*!
+     * latency_dump()
+     * writes one tab separated line per peer and metric:
+     * peer metric count min p50 p95 p99 max mean buckets
+     * where buckets lists lower_bound:count for every non-empty bucket
+     * and one line per peer with the number of aborted transfers
+     */
+    void latency_dump(FILE* out);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* LATENCY_H */
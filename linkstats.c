@@ -0,0 +1,94 @@
+/*
+ * linkstats.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "linkstats.h"
+#include "avr_util.h"
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+//the isr counts into the same struct, interrupts are only restored to what they were
+#define LINKSTATS_LOCK() uint8_t sreg = SREG; cli()
+#define LINKSTATS_UNLOCK() SREG = sreg
+#else
+#define LINKSTATS_LOCK()
+#define LINKSTATS_UNLOCK()
+#endif
+
+RADIO_LOCAL linkstats_t linkstats;
+
+static void linkstats_put16(uint8_t* out, uint16_t value)
+{
+	out[0] = (value >> 8) & 0xFF;
+	out[1] = value & 0xFF;
+}
+
+static void linkstats_put32(uint8_t* out, uint32_t value)
+{
+	linkstats_put16(out, value >> 16);
+	linkstats_put16(out + 2, value & 0xFFFF);
+}
+
+void linkstats_initialize(void)
+{
+	memset(&linkstats, 0, sizeof(linkstats));
+}
+
+uint16_t linkstats_snapshot(uint8_t* payload_out, uint32_t uptime_seconds)
+{
+	linkstats_t copy;
+
+	//the 16 and 32 bit counters take more than one load each on the avr
+	{
+		LINKSTATS_LOCK();
+		memcpy(&copy, &linkstats, sizeof(copy));
+		LINKSTATS_UNLOCK();
+	}
+
+	payload_out[LINKSTATS_VERSION_OFFSET] = LINKSTATS_SNAPSHOT_VERSION;
+	linkstats_put32(payload_out + LINKSTATS_UPTIME_OFFSET, uptime_seconds);
+	linkstats_put16(payload_out + LINKSTATS_SYNC_HITS_OFFSET, copy.phy.sync_hits);
+	linkstats_put16(payload_out + LINKSTATS_SYNC_ABORTS_OFFSET, copy.phy.sync_aborts);
+	linkstats_put16(payload_out + LINKSTATS_INVALID_SYMBOLS_OFFSET, copy.phy.invalid_symbols);
+	linkstats_put16(payload_out + LINKSTATS_CRC_FAILURES_OFFSET, copy.link.crc_failures);
+	linkstats_put16(payload_out + LINKSTATS_LENGTH_MISMATCHES_OFFSET, copy.link.length_mismatches);
+	linkstats_put16(payload_out + LINKSTATS_HEADER_ERRORS_OFFSET, copy.net.header_errors);
+	linkstats_put16(payload_out + LINKSTATS_CHECKSUM_FAILURES_OFFSET, copy.net.checksum_failures);
+	linkstats_put16(payload_out + LINKSTATS_QUEUE_FULL_OFFSET, copy.net.queue_full);
+	linkstats_put16(payload_out + LINKSTATS_RETRANSMISSIONS_OFFSET, copy.tftp.retransmissions);
+	linkstats_put16(payload_out + LINKSTATS_TIMEOUTS_OFFSET, copy.tftp.timeouts);
+	linkstats_put16(payload_out + LINKSTATS_FRAMES_RX_OFFSET, copy.phy.frames_rx);
+	linkstats_put16(payload_out + LINKSTATS_FRAMES_TX_OFFSET, copy.phy.frames_tx);
+	linkstats_put32(payload_out + LINKSTATS_BYTES_RX_OFFSET, copy.phy.bytes_rx);
+	linkstats_put32(payload_out + LINKSTATS_BYTES_TX_OFFSET, copy.phy.bytes_tx);
+	linkstats_put16(payload_out + LINKSTATS_BUSY_DROPS_OFFSET, copy.phy.busy_drops);
+	return LINKSTATS_SNAPSHOT_LENGTH;
+}
+
+uint8_t linkstats_is_query(uint8_t* payload, uint16_t len)
+{
+	return len == 0 || (len == 1 && payload[0] == LINKSTATS_QUERY);
+}
+
+void linkstats_print(void)
+{
+	printf("phy: sync=%u aborted=%u bad_symbols=%u rx=%u/%lu tx=%u/%lu busy_drops=%u\n", linkstats.phy.sync_hits, linkstats.phy.sync_aborts,
+			linkstats.phy.invalid_symbols, linkstats.phy.frames_rx, (unsigned long) linkstats.phy.bytes_rx, linkstats.phy.frames_tx,
+			(unsigned long) linkstats.phy.bytes_tx, linkstats.phy.busy_drops);
+	printf("link: crc=%u length=%u\n", linkstats.link.crc_failures, linkstats.link.length_mismatches);
+	printf("net: header=%u checksum=%u queue_full=%u\n", linkstats.net.header_errors, linkstats.net.checksum_failures, linkstats.net.queue_full);
+	printf("tftp: retransmissions=%u timeouts=%u\n", linkstats.tftp.retransmissions, linkstats.tftp.timeouts);
+}
+
+linkstats_t* linkstats_get_stats(void)
+{
+	return &linkstats;
+}
@@ -0,0 +1,144 @@
+/*
+ * File:   linkstats.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef LINKSTATS_H
+#define	LINKSTATS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+#include "avr_util.h"
+
+/*! set to 0 to compile every counter out */
+#ifndef LINKSTATS_ENABLED
+#define LINKSTATS_ENABLED 1
+#endif
+
+#define LINKSTATS_SNAPSHOT_VERSION 2
+
+/*
+ * snapshot payload sent back to whoever queries the stats port, all fields big endian
+ * version(1) uptime_seconds(4)
+ * sync_hits(2) sync_aborts(2) invalid_symbols(2)
+ * crc_failures(2) length_mismatches(2)
+ * header_errors(2) checksum_failures(2) queue_full(2)
+ * retransmissions(2) timeouts(2)
+ * frames_rx(2) frames_tx(2) bytes_rx(4) bytes_tx(4)
+ * busy_drops(2)
+ * a query is an empty datagram or the single byte LINKSTATS_QUERY, a snapshot is never
+ * either so two nodes can not keep answering each other
+ */
+#define LINKSTATS_VERSION_OFFSET 0
+#define LINKSTATS_UPTIME_OFFSET 1
+#define LINKSTATS_SYNC_HITS_OFFSET 5
+#define LINKSTATS_SYNC_ABORTS_OFFSET 7
+#define LINKSTATS_INVALID_SYMBOLS_OFFSET 9
+#define LINKSTATS_CRC_FAILURES_OFFSET 11
+#define LINKSTATS_LENGTH_MISMATCHES_OFFSET 13
+#define LINKSTATS_HEADER_ERRORS_OFFSET 15
+#define LINKSTATS_CHECKSUM_FAILURES_OFFSET 17
+#define LINKSTATS_QUEUE_FULL_OFFSET 19
+#define LINKSTATS_RETRANSMISSIONS_OFFSET 21
+#define LINKSTATS_TIMEOUTS_OFFSET 23
+#define LINKSTATS_FRAMES_RX_OFFSET 25
+#define LINKSTATS_FRAMES_TX_OFFSET 27
+#define LINKSTATS_BYTES_RX_OFFSET 29
+#define LINKSTATS_BYTES_TX_OFFSET 33
+#define LINKSTATS_BUSY_DROPS_OFFSET 37
+#define LINKSTATS_SNAPSHOT_LENGTH 39
+#define LINKSTATS_QUERY 'S'
+
+    /*! radio, everything between the sync word and the eof byte */
+    typedef struct
+    {
+        uint16_t sync_hits;
+        //sync passed but the frame was cut off by a byte that is not manchester
+        uint16_t sync_aborts;
+        //frames with at least one invalid symbol
+        uint16_t invalid_symbols;
+        uint16_t frames_rx;
+        uint16_t frames_tx;
+        uint32_t bytes_rx;
+        uint32_t bytes_tx;
+        //frames given up because the channel stayed busy through every backoff
+        uint16_t busy_drops;
+    } linkstats_phy_t;
+
+    /*! ax25 or ethernet */
+    typedef struct
+    {
+        uint16_t crc_failures;
+        uint16_t length_mismatches;
+    } linkstats_link_t;
+
+    /*! ip and udp */
+    typedef struct
+    {
+        uint16_t header_errors;
+        uint16_t checksum_failures;
+        //frames given up because a queue on the way had no room
+        uint16_t queue_full;
+    } linkstats_net_t;
+
+    typedef struct
+    {
+        uint16_t retransmissions;
+        uint16_t timeouts;
+    } linkstats_tftp_t;
+
+    typedef struct
+    {
+        linkstats_phy_t phy;
+        linkstats_link_t link;
+        linkstats_net_t net;
+        linkstats_tftp_t tftp;
+    } linkstats_t;
+
+    /*! counted straight from the isr, everything else reads it through linkstats_get_stats() */
+    extern RADIO_LOCAL linkstats_t linkstats;
+
+#if LINKSTATS_ENABLED
+#define LINKSTATS_COUNT(layer, counter) do{ linkstats.layer.counter++; }while(0)
+#define LINKSTATS_ADD(layer, counter, n) do{ linkstats.layer.counter += (n); }while(0)
+#else
+#define LINKSTATS_COUNT(layer, counter) do{ }while(0)
+#define LINKSTATS_ADD(layer, counter, n) do{ }while(0)
+#endif
+
+    void linkstats_initialize(void);
+
+    /*!
+     * linkstats_snapshot()
+     * writes the snapshot payload described above to payload_out, the counters
+     * are copied with interrupts off so none is read halfway through an update
+     * returns LINKSTATS_SNAPSHOT_LENGTH
+     */
+    uint16_t linkstats_snapshot(uint8_t* payload_out, uint32_t uptime_seconds);
+
+    /*!
+     * linkstats_is_query()
+     * returns non-zero if a datagram to the stats port should be answered with a snapshot
+     */
+    uint8_t linkstats_is_query(uint8_t* payload, uint16_t len);
+
+    /*!
+     * linkstats_print()
+     * writes every counter to stdout, one layer per line
+     */
+    void linkstats_print(void);
+
+    linkstats_t* linkstats_get_stats(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* LINKSTATS_H */
@@ -6,7 +6,27 @@
 
 //TODO thanks Adam Dunkels
 
-static const uint16_t me_encode_tab[256] = {
+//with the vector kernels in, these are what they fall back to and get checked against
+#if MANCHESTER_SIMD
+#define SCALAR(name) name##_scalar
+#else
+#define SCALAR(name) name
+#endif
+
+#if MANCHESTER_NIBBLE_TABLES==1
+
+const uint8_t me_encode_nibble_tab[16] TABLE_PROGMEM = {
+0x55, 0x56, 0x59, 0x5a, 0x65, 0x66, 0x69, 0x6a,
+0x95, 0x96, 0x99, 0x9a, 0xa5, 0xa6, 0xa9, 0xaa, };
+
+//two symbol bit pairs per nibble, the first half of each pair is the data bit
+const uint8_t me_decode_nibble_tab[16] TABLE_PROGMEM = {
+0x0, 0x0, 0x1, 0x1, 0x0, 0x0, 0x1, 0x1,
+0x2, 0x2, 0x3, 0x3, 0x2, 0x2, 0x3, 0x3, };
+
+#else
+
+const uint16_t me_encode_tab[256] TABLE_PROGMEM = {
 0x5555, 0x5556, 0x5559, 0x555a, 0x5565, 0x5566, 0x5569, 0x556a, 0x5595,
 0x5596, 0x5599, 0x559a, 0x55a5, 0x55a6, 0x55a9, 0x55aa, 0x5655, 0x5656,
 0x5659, 0x565a, 0x5665, 0x5666, 0x5669, 0x566a, 0x5695, 0x5696, 0x5699,
@@ -37,7 +57,7 @@ static const uint16_t me_encode_tab[256] = {
 0xaa5a, 0xaa65, 0xaa66, 0xaa69, 0xaa6a, 0xaa95, 0xaa96, 0xaa99, 0xaa9a,
 0xaaa5, 0xaaa6, 0xaaa9, 0xaaaa, };
 
-static const uint8_t me_decode_tab[256] = {
+const uint8_t me_decode_tab[256] TABLE_PROGMEM = {
 0x0, 0x0, 0x1, 0x1, 0x0, 0x0, 0x1, 0x1, 0x2,
 0x2, 0x3, 0x3, 0x2, 0x2, 0x3, 0x3, 0x0, 0x0,
 0x1, 0x1, 0x0, 0x0, 0x1, 0x1, 0x2, 0x2, 0x3,
@@ -68,7 +88,7 @@ static const uint8_t me_decode_tab[256] = {
 0xd, 0xc, 0xc, 0xd, 0xd, 0xe, 0xe, 0xf, 0xf,
 0xe, 0xe, 0xf, 0xf, };
 
-static const uint8_t me_valid_tab[256] = {
+const uint8_t me_valid_tab[256] TABLE_PROGMEM = {
 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
@@ -99,27 +119,44 @@ static const uint8_t me_valid_tab[256] = {
 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
 0x0, 0x0, 0x0, 0x0, };
 
+#endif
+
 inline uint8_t isManchester_encoded(uint8_t byte)
 {
-	return me_valid_tab[byte];
+	return ME_VALID(byte);
 }
 
-uint16_t manchester_encode(uint8_t* input, uint8_t* output, uint16_t size)
+uint16_t SCALAR(manchester_encode)(uint8_t* input, uint8_t* output, uint16_t size)
 {
-	uint16_t i, j = 0;
+	uint16_t i, j = 0, symbol;
 	for(i = 0; i<size; i++)
 	{
-		output[j++] = (me_encode_tab[input[i]]>>8)&0xFF;
-		output[j++] = me_encode_tab[input[i]]&0xFF;
+		symbol = ME_ENCODE(input[i]);
+		output[j++] = (symbol>>8)&0xFF;
+		output[j++] = symbol&0xFF;
 	}
 	return j;
 }
-uint16_t manchester_decode(uint8_t* input, uint8_t* output, uint16_t size)
+uint16_t SCALAR(manchester_decode)(uint8_t* input, uint8_t* output, uint16_t size)
+{
+	uint16_t i, k = 0;
+	for(i = 0; i<size; i+=2)
+	{
+		output[k++] = (ME_DECODE(input[i])<<4)|ME_DECODE(input[i+1]);
+	}
+	return k;
+}
+uint16_t SCALAR(manchester_decode_valid)(uint8_t* input, uint8_t* output, uint16_t size, uint8_t* valid)
 {
 	uint16_t i, k = 0;
+	uint8_t a, b, v = 1;
 	for(i = 0; i<size; i+=2)
 	{
-		output[k++] = (me_decode_tab[input[i]]<<4)|me_decode_tab[input[i+1]];
+		a = input[i];
+		b = input[i+1];
+		v &= ME_VALID(a) & ME_VALID(b);
+		output[k++] = (ME_DECODE(a)<<4)|ME_DECODE(b);
 	}
+	*valid = v;
 	return k;
 }
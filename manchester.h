@@ -11,14 +11,76 @@
 #include <inttypes.h>
 #include <stdint.h>
 
+#include "avr_util.h"
+
 #ifdef	__cplusplus
 extern "C" {
 #endif
 
+/*
+ * 1 replaces the 1 KB of byte tables with two 16 byte nibble tables,
+ * a table lookup more per byte in exchange for the flash
+ */
+#ifndef MANCHESTER_NIBBLE_TABLES
+#define MANCHESTER_NIBBLE_TABLES 0
+#endif
+
+/*
+ * 1 builds the sse2, avx2 and bmi2 kernels of manchester_simd.c and picks one on the
+ * first call by what the cpu supports, the table code stays as the fallback and the
+ * reference, as manchester_*_scalar(), only ever on an x86-64 host, never on the node
+ */
+#ifndef MANCHESTER_SIMD
+#if !defined(__AVR__) && defined(__GNUC__) && defined(__x86_64__)
+#define MANCHESTER_SIMD 1
+#else
+#define MANCHESTER_SIMD 0
+#endif
+#endif
+
+/* the accessors are shared with the fused receive kernel in rxframe.c */
+#if MANCHESTER_NIBBLE_TABLES==1
+extern const uint8_t me_encode_nibble_tab[16] TABLE_PROGMEM;
+extern const uint8_t me_decode_nibble_tab[16] TABLE_PROGMEM;
+#define ME_ENCODE(byte) ((((uint16_t) TABLE_READ_BYTE(&me_encode_nibble_tab[((byte)>>4)&0x0F]))<<8) | TABLE_READ_BYTE(&me_encode_nibble_tab[(byte)&0x0F]))
+#define ME_DECODE(symbol) ((TABLE_READ_BYTE(&me_decode_nibble_tab[((symbol)>>4)&0x0F])<<2) | TABLE_READ_BYTE(&me_decode_nibble_tab[(symbol)&0x0F]))
+/* every bit pair of a valid symbol is 01 or 10 */
+#define ME_VALID(symbol) (((((symbol)^((symbol)>>1))&0x55)==0x55) ? 1 : 0)
+#else
+extern const uint16_t me_encode_tab[256] TABLE_PROGMEM;
+extern const uint8_t me_decode_tab[256] TABLE_PROGMEM;
+extern const uint8_t me_valid_tab[256] TABLE_PROGMEM;
+#define ME_ENCODE(byte) TABLE_READ_WORD(&me_encode_tab[(byte)])
+#define ME_DECODE(symbol) TABLE_READ_BYTE(&me_decode_tab[(symbol)])
+#define ME_VALID(symbol) TABLE_READ_BYTE(&me_valid_tab[(symbol)])
+#endif
+
+//output may overlap input as long as it starts at least size bytes before input
 uint16_t manchester_encode(uint8_t* input, uint8_t* output, uint16_t size);
+/* output may be the same buffer as input, every byte is written behind the pair it came from */
 uint16_t manchester_decode(uint8_t* input, uint8_t* output, uint16_t size);
+/* manchester_decode() that also sets valid to 0 if any symbol is not manchester, 1 otherwise */
+uint16_t manchester_decode_valid(uint8_t* input, uint8_t* output, uint16_t size, uint8_t* valid);
 uint8_t isManchester_encoded(uint8_t);
 
+#if MANCHESTER_SIMD
+#define MANCHESTER_KERNEL_AUTO		0
+#define MANCHESTER_KERNEL_SCALAR	1
+#define MANCHESTER_KERNEL_SSE2		2
+#define MANCHESTER_KERNEL_BMI2		3
+#define MANCHESTER_KERNEL_AVX2		4
+
+uint16_t manchester_encode_scalar(uint8_t* input, uint8_t* output, uint16_t size);
+uint16_t manchester_decode_scalar(uint8_t* input, uint8_t* output, uint16_t size);
+uint16_t manchester_decode_valid_scalar(uint8_t* input, uint8_t* output, uint16_t size, uint8_t* valid);
+/*
+ * forces a kernel, AUTO goes back to the best one the cpu has
+ * returns the kernel in use, which is AUTO's choice if the cpu lacks the one asked for
+ */
+uint8_t manchester_set_kernel(uint8_t kernel);
+uint8_t manchester_get_kernel(void);
+#endif
+
 #ifdef	__cplusplus
 }
 #endif
@@ -0,0 +1,284 @@
+/*
+ * manchester_simd.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "manchester.h"
+
+#if MANCHESTER_SIMD
+
+#include <immintrin.h>
+
+/*
+ * a data bit b is sent as the pair b,!b, most significant bit first, so a byte x
+ * becomes the 16 bit symbol spread(x)<<1 | spread(~x), where spread() moves bit k to
+ * bit 2k, big endian on the wire, and decoding gathers the odd bits back
+ * every kernel does whole blocks and leaves the tail to the table code, reading a
+ * block before writing any of it keeps the in place guarantees of manchester.h
+ */
+
+typedef uint16_t (*encodefptr_t)(uint8_t* input, uint8_t* output, uint16_t size);
+typedef uint16_t (*decodefptr_t)(uint8_t* input, uint8_t* output, uint16_t size, uint8_t* valid);
+
+static uint8_t kernel = MANCHESTER_KERNEL_AUTO;
+static encodefptr_t encoder = NULL;
+static decodefptr_t decoder = NULL;
+
+/* ==== sse2, 16 bytes in, 32 out ==== */
+
+__attribute__((target("sse2")))
+static inline __m128i sse2_encode_lanes(__m128i x)
+{
+	//x holds one byte per 16 bit lane
+	x = _mm_and_si128(_mm_or_si128(x, _mm_slli_epi16(x, 4)), _mm_set1_epi16(0x0F0F));
+	x = _mm_and_si128(_mm_or_si128(x, _mm_slli_epi16(x, 2)), _mm_set1_epi16(0x3333));
+	x = _mm_and_si128(_mm_or_si128(x, _mm_slli_epi16(x, 1)), _mm_set1_epi16(0x5555));
+	x = _mm_or_si128(_mm_slli_epi16(x, 1), _mm_xor_si128(x, _mm_set1_epi16(0x5555)));
+	//first symbol byte goes out first
+	return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i sse2_decode_lanes(__m128i x, __m128i* valid)
+{
+	//x holds one symbol pair per 16 bit lane, the first symbol in the low byte
+	*valid = _mm_and_si128(*valid,
+			_mm_cmpeq_epi16(_mm_and_si128(_mm_xor_si128(x, _mm_srli_epi16(x, 1)), _mm_set1_epi16(0x5555)), _mm_set1_epi16(0x5555)));
+	x = _mm_and_si128(_mm_srli_epi16(x, 1), _mm_set1_epi16(0x5555));
+	x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi16(x, 1)), _mm_set1_epi16(0x3333));
+	x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi16(x, 2)), _mm_set1_epi16(0x0F0F));
+	x = _mm_and_si128(_mm_or_si128(x, _mm_srli_epi16(x, 4)), _mm_set1_epi16(0x00FF));
+	//the first symbol came out as the low nibble
+	return _mm_and_si128(_mm_or_si128(_mm_slli_epi16(x, 4), _mm_srli_epi16(x, 4)), _mm_set1_epi16(0x00FF));
+}
+
+__attribute__((target("sse2")))
+static uint16_t manchester_encode_sse2(uint8_t* input, uint8_t* output, uint16_t size)
+{
+	__m128i in, zero = _mm_setzero_si128();
+	uint16_t i = 0;
+
+	for(; i + 16 <= size; i += 16)
+	{
+		in = _mm_loadu_si128((__m128i*) (input + i));
+		_mm_storeu_si128((__m128i*) (output + 2 * i), sse2_encode_lanes(_mm_unpacklo_epi8(in, zero)));
+		_mm_storeu_si128((__m128i*) (output + 2 * i + 16), sse2_encode_lanes(_mm_unpackhi_epi8(in, zero)));
+	}
+	return 2 * i + manchester_encode_scalar(input + i, output + 2 * i, size - i);
+}
+
+__attribute__((target("sse2")))
+static uint16_t manchester_decode_sse2(uint8_t* input, uint8_t* output, uint16_t size, uint8_t* valid)
+{
+	__m128i lo, hi, ok = _mm_set1_epi32(-1);
+	uint16_t i = 0, k;
+	uint8_t tail = 1;
+
+	for(; i + 32 <= size; i += 32)
+	{
+		lo = _mm_loadu_si128((__m128i*) (input + i));
+		hi = _mm_loadu_si128((__m128i*) (input + i + 16));
+		lo = sse2_decode_lanes(lo, &ok);
+		hi = sse2_decode_lanes(hi, &ok);
+		_mm_storeu_si128((__m128i*) (output + i / 2), _mm_packus_epi16(lo, hi));
+	}
+	k = i / 2 + manchester_decode_valid_scalar(input + i, output + i / 2, size - i, &tail);
+	*valid = tail && _mm_movemask_epi8(ok) == 0xFFFF;
+	return k;
+}
+
+/* ==== avx2, 32 bytes in, 64 out ==== */
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_encode_lanes(__m256i x)
+{
+	x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi16(x, 4)), _mm256_set1_epi16(0x0F0F));
+	x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi16(x, 2)), _mm256_set1_epi16(0x3333));
+	x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi16(x, 1)), _mm256_set1_epi16(0x5555));
+	x = _mm256_or_si256(_mm256_slli_epi16(x, 1), _mm256_xor_si256(x, _mm256_set1_epi16(0x5555)));
+	return _mm256_or_si256(_mm256_slli_epi16(x, 8), _mm256_srli_epi16(x, 8));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_decode_lanes(__m256i x, __m256i* valid)
+{
+	*valid = _mm256_and_si256(*valid,
+			_mm256_cmpeq_epi16(_mm256_and_si256(_mm256_xor_si256(x, _mm256_srli_epi16(x, 1)), _mm256_set1_epi16(0x5555)), _mm256_set1_epi16(0x5555)));
+	x = _mm256_and_si256(_mm256_srli_epi16(x, 1), _mm256_set1_epi16(0x5555));
+	x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi16(x, 1)), _mm256_set1_epi16(0x3333));
+	x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi16(x, 2)), _mm256_set1_epi16(0x0F0F));
+	x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi16(x, 4)), _mm256_set1_epi16(0x00FF));
+	return _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi16(x, 4), _mm256_srli_epi16(x, 4)), _mm256_set1_epi16(0x00FF));
+}
+
+__attribute__((target("avx2")))
+static uint16_t manchester_encode_avx2(uint8_t* input, uint8_t* output, uint16_t size)
+{
+	__m128i lo, hi;
+	uint16_t i = 0;
+
+	for(; i + 32 <= size; i += 32)
+	{
+		lo = _mm_loadu_si128((__m128i*) (input + i));
+		hi = _mm_loadu_si128((__m128i*) (input + i + 16));
+		_mm256_storeu_si256((__m256i*) (output + 2 * i), avx2_encode_lanes(_mm256_cvtepu8_epi16(lo)));
+		_mm256_storeu_si256((__m256i*) (output + 2 * i + 32), avx2_encode_lanes(_mm256_cvtepu8_epi16(hi)));
+	}
+	return 2 * i + manchester_encode_sse2(input + i, output + 2 * i, size - i);
+}
+
+__attribute__((target("avx2")))
+static uint16_t manchester_decode_avx2(uint8_t* input, uint8_t* output, uint16_t size, uint8_t* valid)
+{
+	__m256i lo, hi, ok = _mm256_set1_epi32(-1);
+	uint16_t i = 0, k;
+	uint8_t tail = 1;
+
+	for(; i + 64 <= size; i += 64)
+	{
+		lo = _mm256_loadu_si256((__m256i*) (input + i));
+		hi = _mm256_loadu_si256((__m256i*) (input + i + 32));
+		lo = avx2_decode_lanes(lo, &ok);
+		hi = avx2_decode_lanes(hi, &ok);
+		//packus works per 128 bit half, the permute puts the quarters back in order
+		_mm256_storeu_si256((__m256i*) (output + i / 2), _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8));
+	}
+	k = i / 2 + manchester_decode_sse2(input + i, output + i / 2, size - i, &tail);
+	*valid = tail && (uint32_t) _mm256_movemask_epi8(ok) == 0xFFFFFFFFu;
+	return k;
+}
+
+/* ==== bmi2, 4 bytes in, 8 out, pdep/pext are microcoded on amd before zen 3 ==== */
+
+__attribute__((target("bmi2")))
+static uint16_t manchester_encode_bmi2(uint8_t* input, uint8_t* output, uint16_t size)
+{
+	uint64_t symbols;
+	uint32_t x;
+	uint16_t i = 0;
+
+	for(; i + 4 <= size; i += 4)
+	{
+		memcpy(&x, input + i, 4);
+		x = __builtin_bswap32(x);
+		symbols = _pdep_u64(x, 0xAAAAAAAAAAAAAAAAull) | _pdep_u64(~x, 0x5555555555555555ull);
+		symbols = __builtin_bswap64(symbols);
+		memcpy(output + 2 * i, &symbols, 8);
+	}
+	return 2 * i + manchester_encode_scalar(input + i, output + 2 * i, size - i);
+}
+
+__attribute__((target("bmi2")))
+static uint16_t manchester_decode_bmi2(uint8_t* input, uint8_t* output, uint16_t size, uint8_t* valid)
+{
+	uint64_t symbols, ok = 0x5555555555555555ull;
+	uint32_t x;
+	uint16_t i = 0, k;
+	uint8_t tail = 1;
+
+	for(; i + 8 <= size; i += 8)
+	{
+		memcpy(&symbols, input + i, 8);
+		symbols = __builtin_bswap64(symbols);
+		ok &= symbols ^ (symbols >> 1);
+		x = __builtin_bswap32((uint32_t) _pext_u64(symbols, 0xAAAAAAAAAAAAAAAAull));
+		memcpy(output + i / 2, &x, 4);
+	}
+	k = i / 2 + manchester_decode_valid_scalar(input + i, output + i / 2, size - i, &tail);
+	*valid = tail && ok == 0x5555555555555555ull;
+	return k;
+}
+
+/* ==== dispatch ==== */
+
+static uint8_t manchester_supported(uint8_t wanted)
+{
+	__builtin_cpu_init();
+	switch(wanted)
+	{
+	case MANCHESTER_KERNEL_SCALAR:
+		return 1;
+	case MANCHESTER_KERNEL_SSE2:
+		return __builtin_cpu_supports("sse2") != 0;
+	case MANCHESTER_KERNEL_BMI2:
+		return __builtin_cpu_supports("bmi2") != 0;
+	case MANCHESTER_KERNEL_AVX2:
+		return __builtin_cpu_supports("avx2") != 0;
+	}
+	return 0;
+}
+
+uint8_t manchester_set_kernel(uint8_t wanted)
+{
+	if(wanted == MANCHESTER_KERNEL_AUTO || !manchester_supported(wanted))
+	{
+		//the vector units beat pdep/pext everywhere and have no slow implementations
+		if(manchester_supported(MANCHESTER_KERNEL_AVX2))
+			wanted = MANCHESTER_KERNEL_AVX2;
+		else if(manchester_supported(MANCHESTER_KERNEL_SSE2))
+			wanted = MANCHESTER_KERNEL_SSE2;
+		else if(manchester_supported(MANCHESTER_KERNEL_BMI2))
+			wanted = MANCHESTER_KERNEL_BMI2;
+		else
+			wanted = MANCHESTER_KERNEL_SCALAR;
+	}
+	switch(wanted)
+	{
+	case MANCHESTER_KERNEL_AVX2:
+		encoder = manchester_encode_avx2;
+		decoder = manchester_decode_avx2;
+		break;
+	case MANCHESTER_KERNEL_SSE2:
+		encoder = manchester_encode_sse2;
+		decoder = manchester_decode_sse2;
+		break;
+	case MANCHESTER_KERNEL_BMI2:
+		encoder = manchester_encode_bmi2;
+		decoder = manchester_decode_bmi2;
+		break;
+	default:
+		encoder = manchester_encode_scalar;
+		decoder = manchester_decode_valid_scalar;
+		break;
+	}
+	kernel = wanted;
+	return kernel;
+}
+
+uint8_t manchester_get_kernel(void)
+{
+	if(kernel == MANCHESTER_KERNEL_AUTO)
+		manchester_set_kernel(MANCHESTER_KERNEL_AUTO);
+	return kernel;
+}
+
+uint16_t manchester_encode(uint8_t* input, uint8_t* output, uint16_t size)
+{
+	if(encoder == NULL)
+		manchester_set_kernel(MANCHESTER_KERNEL_AUTO);
+	return encoder(input, output, size);
+}
+
+uint16_t manchester_decode(uint8_t* input, uint8_t* output, uint16_t size)
+{
+	uint8_t valid;
+
+	if(decoder == NULL)
+		manchester_set_kernel(MANCHESTER_KERNEL_AUTO);
+	return decoder(input, output, size, &valid);
+}
+
+uint16_t manchester_decode_valid(uint8_t* input, uint8_t* output, uint16_t size, uint8_t* valid)
+{
+	if(decoder == NULL)
+		manchester_set_kernel(MANCHESTER_KERNEL_AUTO);
+	return decoder(input, output, size, valid);
+}
+
+#endif
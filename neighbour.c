@@ -0,0 +1,183 @@
+/*
+ * neighbour.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "neighbour.h"
+#include "avr_util.h"
+
+/* moving averages move an eighth of the way towards every new sample */
+#define EWMA_SHIFT 3
+#define EWMA(avg, sample) ((avg) = (uint8_t) ((avg) - ((avg) >> EWMA_SHIFT) + ((sample) >> EWMA_SHIFT)))
+
+static RADIO_LOCAL neighbour_t neighbours[NEIGHBOUR_TABLE_SIZE];
+static RADIO_LOCAL uint8_t beacon_sequence = 0;
+
+static uint8_t neighbour_alive(neighbour_t* n, unsigned long now)
+{
+	return n->used && now - n->last_heard <= NEIGHBOUR_TIMEOUT_SECONDS;
+}
+
+static neighbour_t* neighbour_find_link(uint8_t* link)
+{
+	uint8_t i;
+
+	for(i = 0; i < NEIGHBOUR_TABLE_SIZE; i++)
+	{
+		if(neighbours[i].used && !memcmp(neighbours[i].link, link, NEIGHBOUR_LINK_ADDRESS_LENGTH))
+			return &neighbours[i];
+	}
+	return NULL;
+}
+
+/* etx = 1/(df*dr), we only measure our side so the link is taken as symmetric */
+static void neighbour_update_etx(neighbour_t* n)
+{
+	uint32_t q = n->delivery_ratio;
+
+	if(q == 0)
+	{
+		n->etx = NEIGHBOUR_ETX_UNKNOWN;
+		return;
+	}
+	q = ((uint32_t) NEIGHBOUR_ETX_ONE * NEIGHBOUR_RATIO_ONE * NEIGHBOUR_RATIO_ONE) / (q * q);
+	n->etx = (q >= NEIGHBOUR_ETX_UNKNOWN) ? NEIGHBOUR_ETX_UNKNOWN - 1 : q;
+}
+
+void neighbour_initialize(void)
+{
+	memset(neighbours, 0, sizeof(neighbours));
+}
+
+uint16_t neighbour_build_beacon(uint8_t* payload_out)
+{
+	payload_out[NEIGHBOUR_BEACON_VERSION_OFFSET] = NEIGHBOUR_BEACON_VERSION;
+	payload_out[NEIGHBOUR_BEACON_SEQUENCE_OFFSET] = beacon_sequence++;
+	return NEIGHBOUR_BEACON_LENGTH;
+}
+
+uint8_t neighbour_beacon_received(uint8_t* link, uint8_t* ip, uint8_t* payload, uint16_t len)
+{
+	neighbour_t* n;
+	unsigned long now = clock_seconds();
+	uint8_t i, sequence, gap, fresh = 0;
+
+	n = neighbour_find_link(link);
+	if(n == NULL || !neighbour_alive(n, now))
+	{
+		if(n == NULL)
+		{
+			//take a free entry or the one heard from the longest ago
+			n = &neighbours[0];
+			for(i = 0; i < NEIGHBOUR_TABLE_SIZE; i++)
+			{
+				if(!neighbours[i].used)
+				{
+					n = &neighbours[i];
+					break;
+				}
+				if(neighbours[i].last_heard < n->last_heard)
+					n = &neighbours[i];
+			}
+		}
+		memset(n, 0, sizeof(neighbour_t));
+		memcpy(n->link, link, NEIGHBOUR_LINK_ADDRESS_LENGTH);
+		n->used = 1;
+		n->delivery_ratio = NEIGHBOUR_RATIO_ONE;
+		fresh = 1;
+	}
+	memcpy(n->ip, ip, 4);
+	n->last_heard = now;
+	n->beacons++;
+
+	if(len >= NEIGHBOUR_BEACON_LENGTH && payload[NEIGHBOUR_BEACON_VERSION_OFFSET] == NEIGHBOUR_BEACON_VERSION)
+	{
+		sequence = payload[NEIGHBOUR_BEACON_SEQUENCE_OFFSET];
+		if(n->has_sequence)
+		{
+			//every skipped sequence number is a beacon we did not hear
+			gap = sequence - n->last_sequence - 1;
+			//a huge gap is a reboot, not a loss burst
+			if(gap < 0x80)
+			{
+				n->missed_beacons += gap;
+				while(gap--)
+					EWMA(n->delivery_ratio, 0);
+			}
+			else
+			{
+				fresh = 1;
+			}
+		}
+		n->last_sequence = sequence;
+		n->has_sequence = 1;
+	}
+	EWMA(n->delivery_ratio, NEIGHBOUR_RATIO_ONE);
+	neighbour_update_etx(n);
+	return fresh;
+}
+
+void neighbour_frame_received(uint8_t* link)
+{
+	neighbour_t* n = neighbour_find_link(link);
+
+	if(n == NULL)
+		return;
+	n->last_heard = clock_seconds();
+	n->frames++;
+	EWMA(n->crc_failure_ratio, 0);
+}
+
+void neighbour_crc_failed(uint8_t* link)
+{
+	neighbour_t* n = neighbour_find_link(link);
+
+	//the address bytes may be the corrupted ones, then nobody is charged
+	if(n == NULL)
+		return;
+	n->crc_failures++;
+	EWMA(n->crc_failure_ratio, NEIGHBOUR_RATIO_ONE);
+}
+
+neighbour_t* neighbour_lookup(uint8_t* ip)
+{
+	unsigned long now = clock_seconds();
+	uint8_t i;
+
+	for(i = 0; i < NEIGHBOUR_TABLE_SIZE; i++)
+	{
+		if(neighbour_alive(&neighbours[i], now) && !memcmp(neighbours[i].ip, ip, 4))
+			return &neighbours[i];
+	}
+	return NULL;
+}
+
+uint16_t neighbour_etx(uint8_t* ip)
+{
+	neighbour_t* n = neighbour_lookup(ip);
+
+	return (n != NULL) ? n->etx : NEIGHBOUR_ETX_UNKNOWN;
+}
+
+neighbour_t* neighbour_get(uint8_t i)
+{
+	uint8_t j;
+	unsigned long now = clock_seconds();
+
+	for(j = 0; j < NEIGHBOUR_TABLE_SIZE; j++)
+	{
+		if(!neighbour_alive(&neighbours[j], now))
+			continue;
+		if(i-- == 0)
+			return &neighbours[j];
+	}
+	return NULL;
+}
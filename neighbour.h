@@ -0,0 +1,116 @@
+/*
+ * File:   neighbour.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef NEIGHBOUR_H
+#define	NEIGHBOUR_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+/*! number of neighbours tracked, the one heard from the longest ago is replaced */
+#ifndef NEIGHBOUR_TABLE_SIZE
+#define NEIGHBOUR_TABLE_SIZE 8
+#endif
+/*! a neighbour that stays quiet this long no longer counts */
+#ifndef NEIGHBOUR_TIMEOUT_SECONDS
+#define NEIGHBOUR_TIMEOUT_SECONDS 900
+#endif
+/*! neighbours are told apart by their ax25 callsign */
+#define NEIGHBOUR_LINK_ADDRESS_LENGTH 7
+
+/*! ratios are kept as fractions of 255, etx in sixteenths */
+#define NEIGHBOUR_RATIO_ONE 255
+#define NEIGHBOUR_ETX_ONE 16
+#define NEIGHBOUR_ETX_UNKNOWN 0xFFFF
+
+/*
+ * hello beacon payload
+ * version(1) sequence(1)
+ * the old "hello world" text beacon is still accepted, it just carries no sequence
+ */
+#define NEIGHBOUR_BEACON_VERSION 1
+#define NEIGHBOUR_BEACON_VERSION_OFFSET 0
+#define NEIGHBOUR_BEACON_SEQUENCE_OFFSET 1
+#define NEIGHBOUR_BEACON_LENGTH 2
+
+    typedef struct
+    {
+        uint8_t link[NEIGHBOUR_LINK_ADDRESS_LENGTH];
+        uint8_t ip[4];
+        unsigned long last_heard;
+        uint8_t last_sequence;
+        uint8_t has_sequence;
+        uint16_t beacons;
+        uint16_t missed_beacons;
+        uint16_t frames;
+        uint16_t crc_failures;
+        //moving averages, NEIGHBOUR_RATIO_ONE is 100%
+        uint8_t delivery_ratio;
+        uint8_t crc_failure_ratio;
+        uint16_t etx;
+        uint8_t used;
+    } neighbour_t;
+
+    /*!
+     * neighbour_initialize()
+     * forgets every neighbour
+     */
+    void neighbour_initialize(void);
+
+    /*!
+     * neighbour_build_beacon()
+     * writes our next hello beacon into payload_out and returns its length
+     */
+    uint16_t neighbour_build_beacon(uint8_t* payload_out);
+
+    /*!
+     * neighbour_beacon_received()
+     * accounts a hello beacon heard from link/ip, sequence gaps count as lost beacons
+     * returns non-zero if the neighbour was not in the table before or has restarted
+     */
+    uint8_t neighbour_beacon_received(uint8_t* link, uint8_t* ip, uint8_t* payload, uint16_t len);
+
+    /*!
+     * neighbour_frame_received()
+     * any frame that passed the fcs check refreshes the sender
+     */
+    void neighbour_frame_received(uint8_t* link);
+
+    /*!
+     * neighbour_crc_failed()
+     * a frame failed the fcs check, it is charged to link if that is a known neighbour
+     */
+    void neighbour_crc_failed(uint8_t* link);
+
+    /*!
+     * neighbour_lookup()
+     * returns the live neighbour with the given ip address or NULL
+     */
+    neighbour_t* neighbour_lookup(uint8_t* ip);
+
+    /*!
+     * neighbour_etx()
+     * expected transmissions towards ip in NEIGHBOUR_ETX_ONE units
+     * NEIGHBOUR_ETX_UNKNOWN if it is not a neighbour
+     */
+    uint16_t neighbour_etx(uint8_t* ip);
+
+    /*!
+     * neighbour_get()
+     * the i'th live table entry or NULL, for dumping the table
+     */
+    neighbour_t* neighbour_get(uint8_t i);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* NEIGHBOUR_H */
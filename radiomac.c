@@ -0,0 +1,151 @@
+/*
+ * radiomac.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#endif
+
+#include "contiki.h"
+#include "radiomac.h"
+#include "manchester.h"
+#include "timers.h"
+#include "avr_util.h"
+
+#define STATE_IDLE			0
+#define STATE_BACKING_OFF	1
+#define STATE_BACKOFF_DONE	2
+
+#define QUIET_TICKS (((RADIOMAC_QUIET_TIME_MS)*CLOCK_SECOND+999)/1000)
+
+static volatile clock_time_t last_activity;
+static volatile uint8_t preamble_run = 0;
+static uint8_t state = STATE_IDLE;
+static uint8_t nb = 0;
+static uint8_t be = RADIOMAC_MIN_BE;
+static timers_timer_t backoff_timer;
+static void (*wakeupCallback)(void);
+static radiomac_stats_t stats;
+
+static void radiomac_backoff_expired(void* context)
+{
+	state = STATE_BACKOFF_DONE;
+	if(wakeupCallback != NULL)
+		wakeupCallback();
+}
+
+static void radiomac_start_backoff(void)
+{
+	uint16_t slots;
+
+	slots = rand() & ((1 << be) - 1);
+	state = STATE_BACKING_OFF;
+	stats.backoffs++;
+	if(slots == 0)
+	{
+		state = STATE_BACKOFF_DONE;
+		return;
+	}
+	timers_start(&backoff_timer, 0, slots * RADIOMAC_SLOT_TIME_MS, radiomac_backoff_expired, NULL);
+}
+
+void radiomac_initialize(void (*wakeup)(void), uint16_t seed)
+{
+	wakeupCallback = wakeup;
+	srand(seed);
+	state = STATE_IDLE;
+	last_activity = clock_time() - QUIET_TICKS;
+	memset(&stats, 0, sizeof(stats));
+}
+
+void radiomac_rx_byte(uint8_t byte)
+{
+	//noise rarely forms valid symbols, so only count bytes that could belong to a frame
+	if(isManchester_encoded(byte))
+	{
+		last_activity = clock_time();
+		if(byte == 0x55 || byte == 0xAA)
+		{
+			if(preamble_run < RADIOMAC_PREAMBLE_DETECT)
+				preamble_run++;
+		}
+	}
+	else
+	{
+		preamble_run = 0;
+	}
+}
+
+uint8_t radiomac_channel_busy(uint8_t receiving)
+{
+	clock_time_t last, quiet;
+
+	if(receiving)
+		return 1;
+	ATOMIC_SET(last, last_activity);
+	quiet = clock_time() - last;
+	if(quiet < QUIET_TICKS)
+		return 1;
+	//a preamble promises a frame, bridge short gaps before the sync word
+	if(preamble_run >= RADIOMAC_PREAMBLE_DETECT && quiet < 2*QUIET_TICKS)
+		return 1;
+	preamble_run = 0;
+	return 0;
+}
+
+uint8_t radiomac_clear_to_send(uint8_t receiving)
+{
+	switch(state)
+	{
+	case STATE_IDLE:
+		nb = 0;
+		be = RADIOMAC_MIN_BE;
+		stats.attempts++;
+		radiomac_start_backoff();
+		if(state == STATE_BACKING_OFF)
+			return RADIOMAC_WAIT;
+		//zero slots drawn, sense right away
+		/* fall through */
+	case STATE_BACKOFF_DONE:
+		if(!radiomac_channel_busy(receiving))
+		{
+			state = STATE_IDLE;
+			return RADIOMAC_TRANSMIT;
+		}
+		stats.busy++;
+		nb++;
+		if(nb > RADIOMAC_MAX_BACKOFFS)
+		{
+			stats.failures++;
+			state = STATE_IDLE;
+			return RADIOMAC_DROP;
+		}
+		if(be < RADIOMAC_MAX_BE)
+			be++;
+		radiomac_start_backoff();
+		if(state == STATE_BACKOFF_DONE)
+		{
+			//zero slots again, let the caller come back on the next pass
+			if(wakeupCallback != NULL)
+				wakeupCallback();
+		}
+		return RADIOMAC_WAIT;
+	case STATE_BACKING_OFF:
+	default:
+		return RADIOMAC_WAIT;
+	}
+}
+
+radiomac_stats_t* radiomac_get_stats(void)
+{
+	return &stats;
+}
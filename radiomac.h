@@ -0,0 +1,87 @@
+/*
+ * File:   radiomac.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef RADIOMAC_H
+#define	RADIOMAC_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+/*! length of one backoff slot, should cover the rts turnaround plus a few preamble bytes */
+#ifndef RADIOMAC_SLOT_TIME_MS
+#define RADIOMAC_SLOT_TIME_MS 32
+#endif
+/*! the channel is considered clear after this long without a plausible symbol */
+#ifndef RADIOMAC_QUIET_TIME_MS
+#define RADIOMAC_QUIET_TIME_MS 30
+#endif
+/*! consecutive preamble bytes needed to declare a transmission in progress */
+#ifndef RADIOMAC_PREAMBLE_DETECT
+#define RADIOMAC_PREAMBLE_DETECT 3
+#endif
+#ifndef RADIOMAC_MIN_BE
+#define RADIOMAC_MIN_BE 2
+#endif
+#ifndef RADIOMAC_MAX_BE
+#define RADIOMAC_MAX_BE 5
+#endif
+#ifndef RADIOMAC_MAX_BACKOFFS
+#define RADIOMAC_MAX_BACKOFFS 5
+#endif
+
+/*! return values of radiomac_clear_to_send() */
+#define RADIOMAC_WAIT		0
+#define RADIOMAC_TRANSMIT	1
+#define RADIOMAC_DROP		2
+
+    typedef struct
+    {
+        uint16_t attempts;
+        uint16_t backoffs;
+        uint16_t busy;
+        uint16_t failures;
+    } radiomac_stats_t;
+
+    /*!
+     * radiomac_initialize()
+     * wakeup is called (from timer context) whenever a backoff period ends,
+     * seed should be unique per node so that nodes powered up together don't pick the same slots
+     */
+    void radiomac_initialize(void (*wakeup)(void), uint16_t seed);
+
+    /*!
+     * radiomac_rx_byte()
+     * feeds every received radio byte to the carrier sense, safe to call from interrupt context
+     */
+    void radiomac_rx_byte(uint8_t byte);
+
+    /*!
+     * radiomac_channel_busy()
+     * returns non-zero if a frame is being received or there was recent activity on the channel
+     */
+    uint8_t radiomac_channel_busy(uint8_t receiving);
+
+    /*!
+     * radiomac_clear_to_send()
+     * runs the csma/ca state machine for the frame at the head of the queue
+     * RADIOMAC_WAIT means a backoff is running and wakeup will be called when it ends
+     * RADIOMAC_TRANSMIT means the frame can go out now
+     * RADIOMAC_DROP means the channel stayed busy for RADIOMAC_MAX_BACKOFFS attempts
+     */
+    uint8_t radiomac_clear_to_send(uint8_t receiving);
+
+    radiomac_stats_t* radiomac_get_stats(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* RADIOMAC_H */
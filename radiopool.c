@@ -0,0 +1,321 @@
+/*
+ * radiopool.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <pthread.h>
+
+#include "radiopool.h"
+#include "jobqueue.h"
+
+static radio_t radios[RADIOPOOL_MAX_RADIOS];
+static uint8_t numRadios = 0;
+static uint8_t stopping = 0;
+static radiopool_worker_t radioWorker = NULL;
+
+int radiopool_add(const char* tty)
+{
+	radio_t* radio;
+
+	if(numRadios >= RADIOPOOL_MAX_RADIOS || strlen(tty) >= RADIOPOOL_MAX_TTY)
+		return -1;
+	radio = &radios[numRadios];
+	memset(radio, 0, sizeof(radio_t));
+	strcpy(radio->tty, tty);
+	radio->fd = -1;
+	radio->success_rate = RADIOPOOL_SUCCESS_ONE;
+	return numRadios++;
+}
+
+const char* radiopool_tty(uint8_t radio)
+{
+	if(radio >= numRadios)
+		return NULL;
+	return radios[radio].tty;
+}
+
+static void* radiopool_run(void* arg)
+{
+	radio_t* radio = arg;
+
+	radioWorker(radio - radios, radio->worker_fd);
+	return NULL;
+}
+
+int radiopool_start(radiopool_worker_t worker)
+{
+	int pair[2];
+	uint8_t i, started = 0;
+	sigset_t supervisor, old;
+
+	radioWorker = worker;
+	//process wide signals are left to the supervisor
+	sigemptyset(&supervisor);
+	sigaddset(&supervisor, SIGINT);
+	sigaddset(&supervisor, SIGTERM);
+	sigaddset(&supervisor, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &supervisor, &old);
+	for(i = 0; i < numRadios; i++)
+	{
+		if(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0)
+		{
+			perror("couldn't connect radio worker");
+			continue;
+		}
+		radios[i].worker_fd = pair[1];
+		if(pthread_create(&radios[i].thread, NULL, radiopool_run, &radios[i]))
+		{
+			perror("couldn't start radio worker");
+			close(pair[0]);
+			close(pair[1]);
+			continue;
+		}
+		fcntl(pair[0], F_SETFL, O_NONBLOCK);
+		radios[i].fd = pair[0];
+		radios[i].alive = 1;
+		started++;
+		printf("radio %u on %s\n", i, radios[i].tty);
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	return started;
+}
+
+static void radiopool_finish(radio_t* radio, uint8_t slot, int result)
+{
+	jobqueue_finish(radio->outstanding[slot], result);
+	//every job moves the rate an eighth of the way to where this one says it is
+	radio->success_rate -= radio->success_rate / 8;
+	if(result == 0)
+	{
+		radio->success_rate += RADIOPOOL_SUCCESS_ONE / 8;
+		radio->completed++;
+	}
+	else
+	{
+		radio->failed++;
+	}
+	radio->depth--;
+	memmove(&radio->outstanding[slot], &radio->outstanding[slot + 1], (radio->depth - slot) * sizeof(job_t*));
+	memmove(&radio->worker_id[slot], &radio->worker_id[slot + 1], (radio->depth - slot) * sizeof(uint32_t));
+}
+
+/* a worker closes its end of the socket on the way out, it is gone soon after */
+static void radiopool_join(radio_t* radio)
+{
+	if(radio->alive || radio->joined)
+		return;
+	pthread_join(radio->thread, NULL);
+	radio->joined = 1;
+}
+
+static void radiopool_lost(radio_t* radio)
+{
+	if(!radio->alive)
+		return;
+	if(!stopping)
+		fprintf(stderr, "radio worker on %s is gone\n", radio->tty);
+	radio->alive = 0;
+	close(radio->fd);
+	radio->fd = -1;
+	while(radio->depth)
+		radiopool_finish(radio, 0, -1);
+	radiopool_join(radio);
+}
+
+static void radiopool_line(radio_t* radio, char* line)
+{
+	uint32_t id;
+	int result;
+	uint8_t slot;
+
+	if(sscanf(line, "queued %" SCNu32, &id) == 1 || !strncmp(line, "rejected", strlen("rejected")))
+	{
+		//the worker answers requests in the order they were sent
+		for(slot = 0; slot < radio->depth; slot++)
+		{
+			if(radio->worker_id[slot] != 0)
+				continue;
+			if(line[0] == 'r')
+				radiopool_finish(radio, slot, -1);
+			else
+				radio->worker_id[slot] = id;
+			return;
+		}
+	}
+	else if(sscanf(line, "done %" SCNu32 " %d", &id, &result) == 2)
+	{
+		for(slot = 0; slot < radio->depth; slot++)
+		{
+			if(radio->worker_id[slot] == id)
+			{
+				radiopool_finish(radio, slot, result);
+				return;
+			}
+		}
+	}
+}
+
+static void radiopool_read(radio_t* radio)
+{
+	char* end;
+	int res;
+
+	res = read(radio->fd, radio->line + radio->length, sizeof(radio->line) - 1 - radio->length);
+	if(res < 0 && (errno == EAGAIN || errno == EINTR))
+		return;
+	if(res <= 0)
+	{
+		radiopool_lost(radio);
+		return;
+	}
+	radio->length += res;
+	radio->line[radio->length] = 0;
+	while((end = strchr(radio->line, '\n')) != NULL)
+	{
+		*end = 0;
+		radiopool_line(radio, radio->line);
+		radio->length -= end + 1 - radio->line;
+		memmove(radio->line, end + 1, radio->length + 1);
+	}
+	//a worker never sends lines this long, start over rather than stall
+	if(radio->length >= sizeof(radio->line) - 1)
+		radio->length = 0;
+}
+
+/* the radio a new job would finish soonest on, jobs ahead of it over the chance it succeeds */
+static radio_t* radiopool_pick(void)
+{
+	radio_t* best = NULL;
+	uint32_t cost, bestCost = 0;
+	uint8_t i;
+
+	for(i = 0; i < numRadios; i++)
+	{
+		if(!radios[i].alive || radios[i].depth >= RADIOPOOL_MAX_DEPTH)
+			continue;
+		cost = (radios[i].depth + 1) * (uint32_t) RADIOPOOL_SUCCESS_ONE * RADIOPOOL_SUCCESS_ONE / (radios[i].success_rate + 1);
+		if(best == NULL || cost < bestCost)
+		{
+			best = &radios[i];
+			bestCost = cost;
+		}
+	}
+	return best;
+}
+
+static uint8_t radiopool_dispatch(radio_t* radio, job_t* job)
+{
+	char line[JOBQUEUE_MAX_LINE + 1];
+	int length;
+
+	length = snprintf(line, sizeof(line), "%u 1 %s %s %s\n", job->priority, job->destination[0] ? job->destination : "-",
+			job->local_filename[0] ? job->local_filename : "-", job->command);
+	if(send(radio->fd, line, length, MSG_NOSIGNAL) != length)
+		return 1;
+	radio->outstanding[radio->depth] = job;
+	radio->worker_id[radio->depth] = 0;
+	radio->depth++;
+	return 0;
+}
+
+void radiopool_poll(uint16_t timeout_ms)
+{
+	struct timeval timeout;
+	fd_set readable;
+	radio_t* radio;
+	job_t* job;
+	int maxFd = -1;
+	uint8_t i, alive = 0;
+
+	FD_ZERO(&readable);
+	for(i = 0; i < numRadios; i++)
+	{
+		if(!radios[i].alive)
+			continue;
+		FD_SET(radios[i].fd, &readable);
+		if(radios[i].fd > maxFd)
+			maxFd = radios[i].fd;
+	}
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_usec = (timeout_ms % 1000) * 1000l;
+	if(select(maxFd + 1, &readable, NULL, NULL, &timeout) > 0)
+	{
+		for(i = 0; i < numRadios; i++)
+		{
+			if(radios[i].alive && FD_ISSET(radios[i].fd, &readable))
+				radiopool_read(&radios[i]);
+		}
+	}
+
+	jobqueue_poll();
+	while((radio = radiopool_pick()) != NULL && (job = jobqueue_next()) != NULL)
+	{
+		if(radiopool_dispatch(radio, job))
+		{
+			jobqueue_finish(job, -1);
+			radiopool_lost(radio);
+		}
+	}
+
+	//with every worker gone nothing would ever answer the clients
+	for(i = 0; i < numRadios; i++)
+		alive |= radios[i].alive;
+	if(!alive)
+	{
+		while((job = jobqueue_next()) != NULL)
+			jobqueue_finish(job, -1);
+	}
+}
+
+void radiopool_signal(int sig)
+{
+	uint8_t i;
+
+	for(i = 0; i < numRadios; i++)
+	{
+		if(radios[i].alive)
+			pthread_kill(radios[i].thread, sig);
+	}
+}
+
+void radiopool_stop(void)
+{
+	uint8_t i;
+
+	stopping = 1;
+	//a worker reads the hangup as the end of its jobs and exits its thread
+	for(i = 0; i < numRadios; i++)
+	{
+		if(radios[i].alive)
+			shutdown(radios[i].fd, SHUT_RDWR);
+	}
+	for(i = 0; i < numRadios; i++)
+		radiopool_lost(&radios[i]);
+}
+
+void radiopool_print(FILE* out)
+{
+	uint8_t i;
+
+	fprintf(out, "#radio\ttty\talive\tdepth\tsuccess_rate\tcompleted\tfailed\n");
+	for(i = 0; i < numRadios; i++)
+	{
+		fprintf(out, "%u\t%s\t%u\t%u\t%u\t%" PRIu32 "\t%" PRIu32 "\n", i, radios[i].tty, radios[i].alive, radios[i].depth,
+				radios[i].success_rate, radios[i].completed, radios[i].failed);
+	}
+	fflush(out);
+}
@@ -0,0 +1,108 @@
+/*
+ * File:   radiopool.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef RADIOPOOL_H
+#define	RADIOPOOL_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include "jobqueue.h"
+
+/*
+ * one host daemon driving several radios
+ * tftp, udp and the link layers keep their state in RADIO_LOCAL file scope, so every
+ * radio gets a worker thread of its own, each a whole stack with its own copy of it
+ * the supervisor owns the job socket and hands jobs to the workers over a socket pair,
+ * in the same line format clients use, to the radio with the lowest expected wait
+ * workers start with SIGINT, SIGTERM and SIGUSR1 blocked, those are the supervisor's
+ */
+
+#ifndef RADIOPOOL_MAX_RADIOS
+#define RADIOPOOL_MAX_RADIOS 8
+#endif
+/*! jobs handed to one worker at a time, the second one is ready when the first ends */
+#ifndef RADIOPOOL_MAX_DEPTH
+#define RADIOPOOL_MAX_DEPTH 2
+#endif
+#define RADIOPOOL_MAX_TTY 128
+/*! success rate of a radio whose every job succeeds */
+#define RADIOPOOL_SUCCESS_ONE 256
+
+    typedef struct
+    {
+        char tty[RADIOPOOL_MAX_TTY];
+        pthread_t thread;
+        //the supervisor's end of the connection and the worker's
+        int fd;
+        int worker_fd;
+        uint8_t alive;
+        //the worker has exited and been joined
+        uint8_t joined;
+        //jobs on the worker in the order they were sent, worker ids are 0 until it queued them
+        job_t* outstanding[RADIOPOOL_MAX_DEPTH];
+        uint32_t worker_id[RADIOPOOL_MAX_DEPTH];
+        uint8_t depth;
+        //moving average of how many of its jobs succeed, RADIOPOOL_SUCCESS_ONE if all of them do
+        //it says nothing about the link itself, a job fails just as well on a busy or absent peer
+        uint16_t success_rate;
+        uint32_t completed;
+        uint32_t failed;
+        char line[JOBQUEUE_MAX_LINE];
+        uint16_t length;
+    } radio_t;
+
+    /*! runs one radio until its connection closes, fd is its end of the supervisor's connection */
+    typedef void (*radiopool_worker_t)(uint8_t radio, int fd);
+
+    /*!
+     * radiopool_add()
+     * registers a tty, returns its radio number or negative if the pool is full
+     */
+    int radiopool_add(const char* tty);
+
+    /*!
+     * radiopool_start()
+     * starts a worker thread running worker for every radio
+     * returns how many were started
+     */
+    int radiopool_start(radiopool_worker_t worker);
+
+    const char* radiopool_tty(uint8_t radio);
+
+    /*!
+     * radiopool_poll()
+     * supervisor loop body, waits up to timeout_ms for the workers, polls the job socket,
+     * passes finished jobs back to their clients and hands out waiting ones
+     */
+    void radiopool_poll(uint16_t timeout_ms);
+
+    /*!
+     * radiopool_signal()
+     * sends sig to every live worker thread
+     */
+    void radiopool_signal(int sig);
+
+    /*!
+     * radiopool_stop()
+     * hangs up on the workers and joins them, jobs they held are failed
+     */
+    void radiopool_stop(void);
+
+    void radiopool_print(FILE* out);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* RADIOPOOL_H */
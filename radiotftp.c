@@ -16,10 +16,14 @@
 #include <fcntl.h>
 #include <string.h>
 #include <signal.h>
+#include <errno.h>
 #include <inttypes.h>
 #include <sys/time.h>
 #include <sys/select.h>
 #include <stdint.h>
+#include <pthread.h>
+#include <poll.h>
+#include "avr_util.h"
 #include "lock.h"
 #include "devtag-allinone.h"
 #include "manchester.h"
@@ -30,20 +34,37 @@
 #include "radiotftp.h"
 #include "ax25.h"
 #include "util.h"
+#include "linkstats.h"
+#include "latency.h"
+#include "jobqueue.h"
+#include "radiopool.h"
+#include "spsc.h"
+#include "route.h"
+#include "bufpool.h"
+#include "frag.h"
+#include "dupcache.h"
+#include "txqueue.h"
+#include "neighbour.h"
+#include "trickle.h"
+#include "radiomac.h"
+#include "contiki.h"
+#if TDMA_ENABLED==1
+#include "tdma.h"
+#endif
 #define END_OF_FILE 28
 #define CTRLD  4
-#define P_LOCK "/var/lock"
 #define IO_DRIVEN 0
-#define TEMPFILE_PREFIX "linefeed\0"
-#define TEMPFILE_POSTFIX ".txt\0"
 #define RADIOTFTP_COMMAND_PUT	"put"
 #define RADIOTFTP_COMMAND_GET	"get"
 #define RADIOTFTP_COMMAND_APPEND_FILE	"append"
 #define RADIOTFTP_COMMAND_APPEND_LINE	"appendline"
 #define HELLO_WORLD_PORT 12345
-FILE* tempFile;
-char tempFileName[64];
-char dial_tty[128];
+//seconds a queued job may go without a tftp event before it is given up
+#define JOB_DEADLINE 60
+RADIO_LOCAL char dial_tty[128];
+//every radio starts from what the command line gave
+uint8_t destination_ip[32];
+uint8_t local_filename[32] = "\0";
 
 const uint8_t my_ip_address[6] =
 { 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6 };
@@ -56,44 +77,129 @@ unsigned char preamble[PREAMBLE_LENGTH] =
 unsigned char syncword[SYNC_LENGTH] =
 { 0xAA, 0x55, 0xAA, 0x55 };
 
-uint8_t io[BUFSIZ];
-uint8_t buf[2 * BUFSIZ];
 uint8_t command_buffer[256];
 #if ETHERNET_ENABLED==1
 const uint8_t my_eth_address[6] =
 {	0xf0, 0x0, 0x0, 0x0, 0x0, 0x1};
-uint8_t ethernet_buffer[ETH_MAX_PAYLOAD_LENGTH + ETH_TOTAL_HEADERS_LENGTH];
-uint8_t manchester_buffer[sizeof(ethernet_buffer) * 2];
+RADIO_LOCAL uint8_t ethernet_buffer[ETH_MAX_PAYLOAD_LENGTH + ETH_TOTAL_HEADERS_LENGTH];
+RADIO_LOCAL uint8_t manchester_buffer[sizeof(ethernet_buffer) * 2];
 #elif AX25_ENABLED==1
 const uint8_t my_ax25_callsign[7] = "NOCALL";
-uint8_t ax25_buffer[AX25_MAX_PAYLOAD_LENGTH + AX25_TOTAL_HEADERS_LENGTH];
-uint8_t manchester_buffer[sizeof(ax25_buffer) * 2];
+RADIO_LOCAL uint8_t ax25_buffer[AX25_MAX_PAYLOAD_LENGTH + AX25_TOTAL_HEADERS_LENGTH];
+RADIO_LOCAL uint8_t manchester_buffer[sizeof(ax25_buffer) * 2];
 #else
-uint8_t manchester_buffer[(UDP_MAX_PAYLOAD_LENGTH + UDP_TOTAL_HEADERS_LENGTH) * 2];
+RADIO_LOCAL uint8_t manchester_buffer[(UDP_MAX_PAYLOAD_LENGTH + UDP_TOTAL_HEADERS_LENGTH) * 2];
+#endif
+#define TRANSMIT_BUFFER_LENGTH (sizeof(manchester_buffer) + PREAMBLE_LENGTH + SYNC_LENGTH + 2)
+RADIO_LOCAL uint8_t udp_buffer[UDP_MAX_PAYLOAD_LENGTH + UDP_TOTAL_HEADERS_LENGTH];
+//the last datagram that went out in fragments, a fragment nack names which of them to send again
+struct
+{
+	uint8_t src[IPV4_SOURCE_LENGTH];
+	uint8_t dst[IPV4_DESTINATION_LENGTH];
+	uint16_t src_port, dst_port;
+	uint16_t length;
+	uint16_t identification;
+	uint8_t parts;
+	uint8_t traffic_class;
+	uint8_t payload[UDP_MAX_DATAGRAM_LENGTH];
+} RADIO_LOCAL kept;
+RADIO_LOCAL uint16_t next_identification = 0;
+RADIO_LOCAL uint8_t stage_buffer[UDP_MAX_DATAGRAM_LENGTH];
+//what tftp is sending, it reads blocks straight out of it until the transfer ends
+RADIO_LOCAL uint8_t* fileBuffer = NULL;
+
+/*
+ * the reader thread finds frames on the serial port, the radio's own thread decodes them
+ * and runs the protocol, the writer thread owns rts and the drain time of every frame
+ * each ring has one producer and one consumer, a byte down the wake pipe tells the
+ * consumer there is something in it
+ * outgoing frames wait in one ring per txqueue class, the writer always empties the
+ * most urgent one first so acks don't queue up behind data blocks
+ * the io threads see RADIO_LOCAL copies of their own, whatever they share with their
+ * radio is in its pipeline
+ */
+#define RX_QUEUE_SLOTS 8
+//room per class for a datagram in fragments and the resend of another one
+#define TX_QUEUE_SLOTS 8
+typedef struct
+{
+	int fd;
+	struct termios tp;
+	spsc_t rxQueue, txQueue[TXQUEUE_NUM_CLASSES];
+	uint8_t rxStorage[RX_QUEUE_SLOTS][sizeof(manchester_buffer)];
+	uint16_t rxLengths[RX_QUEUE_SLOTS];
+	uint8_t txStorage[TXQUEUE_NUM_CLASSES][TX_QUEUE_SLOTS][TRANSMIT_BUFFER_LENGTH];
+	uint16_t txLengths[TXQUEUE_NUM_CLASSES][TX_QUEUE_SLOTS];
+	int rxWake[2], txWake[2];
+	pthread_t reader, writer;
+	uint8_t running;
+	//set by the reader while a sync word is coming in or a frame is, the writer holds off
+	uint8_t rxBusy;
+	//clock_time() of the last byte the reader saw that could belong to a frame
+	clock_time_t rxActivity;
+	//the writer's backoff draws from its own sequence
+	unsigned int macSeed;
+#if TDMA_ENABLED==1
+	//a gateway's next beacon waits apart from its other frames, the writer sends it to close the gateway's slot
+	spsc_t beaconQueue;
+	uint8_t beaconStorage[1][TRANSMIT_BUFFER_LENGTH];
+	uint16_t beaconLengths[1];
+	//the schedule the beacons advertise, no slots unless this radio is a gateway
+	uint16_t slotMs;
+	uint8_t slots;
+	//the nodes are running a superframe on the last schedule without a new beacon
+	uint8_t beaconSkipped;
+	//node slot 0 starts at the end of the last beacon
+	clock_time_t superframeStart;
 #endif
-uint8_t transmit_buffer[sizeof(manchester_buffer) + PREAMBLE_LENGTH + SYNC_LENGTH + 2];
-uint8_t udp_buffer[UDP_MAX_PAYLOAD_LENGTH + 20];
-uint16_t transmit_length = 0;
+	//frames the reader had no slot for
+	uint32_t rxOverruns;
+	//only the radio's thread touches linkstats, it folds these in
+	linkstats_phy_t phy;
+} pipeline_t;
+RADIO_LOCAL pipeline_t pipeline;
+#define PIPELINE_COUNT(p, counter, n) __atomic_add_fetch(&(p)->phy.counter, (n), __ATOMIC_RELAXED)
 
 /* Default options */
 int background = 0;
 long baud = B9600;
 
-struct termios tp, old;
+RADIO_LOCAL struct termios tp, old;
 struct sigaction sa_io; //definition of signal action
 struct sigaction sa_alarm;
 
-int serialportFd;
-int restore = 0;
+RADIO_LOCAL int serialportFd = -1;
+RADIO_LOCAL int restore = 0;
 volatile uint8_t io_flag = 0;
 volatile uint8_t alarm_flag = 0;
-volatile uint8_t timer_flag = 0;
-volatile uint8_t queue_flag = 0;
-volatile uint8_t idle_flag = 0;
-
-uint8_t eth_src[6], eth_dst[6];
-uint8_t udp_src[6], udp_dst[6];
-uint16_t udp_src_prt, udp_dst_prt;
+RADIO_LOCAL volatile uint8_t timer_flag = 0;
+RADIO_LOCAL volatile uint8_t beacon_flag = 0;
+RADIO_LOCAL volatile uint8_t idle_flag = 0;
+RADIO_LOCAL volatile uint8_t latency_flag = 0;
+RADIO_LOCAL time_t started;
+FILE* latencyFile = NULL;
+char jobSocket[108] = "\0";
+int daemonMode = 0;
+//a radio of a pool, its end of the supervisor's connection
+RADIO_LOCAL int workerFd = -1;
+RADIO_LOCAL job_t* currentJob = NULL;
+RADIO_LOCAL uint8_t transferStarted = 0;
+RADIO_LOCAL time_t jobDeadline = 0;
+
+RADIO_LOCAL uint8_t eth_src[6], eth_dst[6];
+RADIO_LOCAL uint8_t udp_src[6], udp_dst[6];
+RADIO_LOCAL uint16_t udp_src_prt, udp_dst_prt;
+#if AX25_ENABLED==1
+//whoever the last frame came from, nodes behind a relay are answered through it
+RADIO_LOCAL uint8_t link_src[AX25_SOURCE_LENGTH];
+#endif
+#if TDMA_ENABLED==1
+//the gateway hands slot i to the node at tdmaOwners[i] in every beacon
+uint8_t tdmaOwners[TDMA_MAX_SLOTS][4];
+uint8_t tdmaSlots = 0;
+RADIO_LOCAL uint8_t tdmaSequence = 0;
+#endif
 
 #if PREAMBLE_LENGTH > 15
 #error preamble length cant be longer than 15
@@ -103,35 +209,13 @@ uint16_t udp_src_prt, udp_dst_prt;
 #error Both AX25 and Ethernet cannot be enabled
 #endif
 
-int createTempFile(char* prefix, char* postfix)
-{
-	int length;
-	struct timeval curtime;
-	gettimeofday(&curtime, NULL);
-	length = sprintf(tempFileName, "%s-%ld:%ld:%ld%s\0", prefix, GMT_OFFSET + (curtime.tv_sec % (3600 * 24)) / 3600, (curtime.tv_sec % 3600) / 60,
-			curtime.tv_sec % 60, postfix);
-	tempFile = fopen(tempFileName, "wb");
-	return length;
-}
-int deleteTempFile()
-{
-	if(tempFile != NULL)
-	{
-		fflush(tempFile);
-		fclose(tempFile);
-		while(remove(tempFileName))
-			;
-	}
-	return 0;
-}
-
-uint8_t setRTS(uint8_t level)
+uint8_t setPortRTS(int fd, uint8_t level)
 {
 	int status;
 
-	if(ioctl(serialportFd, TIOCMGET, &status) == -1)
+	if(ioctl(fd, TIOCMGET, &status) == -1)
 	{
-		//perror("setRTS()");
+		//perror("setPortRTS()");
 		return 0;
 	}
 
@@ -140,9 +224,9 @@ uint8_t setRTS(uint8_t level)
 	else
 		status &= ~TIOCM_RTS;
 
-	if(ioctl(serialportFd, TIOCMSET, &status) == -1)
+	if(ioctl(fd, TIOCMSET, &status) == -1)
 	{
-		//perror("setRTS()");
+		//perror("setPortRTS()");
 		return 0;
 	}
 	return 1;
@@ -155,19 +239,29 @@ TIMER_HANDLER_FUNCTION(idle_timer_handler)
 	return 0;
 }
 
+void stopPipeline(void);
 void safe_exit(int retVal)
 {
+	//the io threads work on this radio's pipeline, they go first
+	stopPipeline();
 	if(restore)
 	{
 		if(tcsetattr(serialportFd, TCSANOW, &old) < 0)
-		{
 			perror("Couldn't restore term attributes");
-			exit(-1);
-		}
+		restore = 0;
 	}
-	printf("exiting...\n");
-	deleteTempFile();
+	printf("exiting %s...\n", dial_tty);
+	linkstats_print();
+	latency_dump(latencyFile != NULL ? latencyFile : stderr);
+	jobqueue_close();
+	free(fileBuffer);
+	fileBuffer = NULL;
+	if(serialportFd >= 0)
+		close(serialportFd);
 	lockfile_remove();
+	//a radio of a pool only takes its own thread down
+	if(workerFd >= 0)
+		pthread_exit(NULL);
 	exit(retVal);
 }
 
@@ -185,19 +279,76 @@ void sigIO_handler(int status)
 	signalCount++;
 }
 
-void sigRTALRM_handler(int sig)
+void sigUSR1_handler(int sig)
+{
+	//dumped from the radio's loop, stdio isn't safe in here
+	//a pool's radios get it as SIGUSR2 on their own thread, which is the copy it sets
+	latency_flag = 1;
+}
+
+void wakeUp(int* wake)
+{
+	uint8_t c = 0;
+
+	//a full pipe already means the consumer will look
+	if(write(wake[1], &c, 1) < 0 && errno != EAGAIN)
+		perror("wake pipe");
+}
+
+/* sleeps until something is queued, timeout_ms passes or a signal comes in */
+void waitForWake(int* wake, int timeout_ms)
+{
+	struct pollfd pfd;
+	uint8_t drain[16];
+
+	pfd.fd = wake[0];
+	pfd.events = POLLIN;
+	if(poll(&pfd, 1, timeout_ms) > 0)
+	{
+		while(read(wake[0], drain, sizeof(drain)) > 0)
+			;
+	}
+}
+
+#if TDMA_ENABLED==1
+/*
+ * the gateway opens every superframe with the slot map, nodes time their slots from its eof
+ * the next beacon is kept queued, the writer decides when it goes
+ */
+void sendBeacon(void)
+{
+	uint8_t beacon[TDMA_BEACON_LENGTH(TDMA_MAX_SLOTS)];
+	uint16_t len;
+
+	if(pipeline.slots == 0 || spsc_count(&pipeline.beaconQueue))
+		return;
+	len = tdma_build_beacon(beacon, tdmaSequence++, pipeline.slotMs, tdmaOwners, tdmaSlots);
+	queueSerialData(udp_get_localhost_ip(NULL), TDMA_BEACON_PORT, udp_get_broadcast_ip(NULL), TDMA_BEACON_PORT, beacon, len);
+}
+#endif
+
+void radiotftpAlarm_callback(void* data)
 {
 	//printf("main timer handler\n");
 	timer_flag = 1;
-
+}
+void radiotftpBeacon_callback(void)
+{
+	beacon_flag = 1;
 }
 
-uint8_t queueSerialData(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t dst_port, uint8_t* dataptr, uint16_t datalen)
+/* frames an ip packet for the link and hands it to the writer on the given ring */
+uint8_t queuePacket(spsc_t* queue, uint8_t* dst, uint8_t* packet, uint16_t len)
 {
-	uint16_t idx = 0, len = 0, j = 0;
+	uint16_t idx = 0;
+	uint8_t* transmit_buffer;
+#if AX25_ENABLED==1
+	uint8_t* next_hop;
+#endif
 
-	if(queue_flag)
+	if((transmit_buffer = spsc_reserve(queue)) == NULL)
 	{
+		LINKSTATS_COUNT(net, queue_full);
 		return -1;
 	}
 
@@ -207,17 +358,9 @@ uint8_t queueSerialData(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t
 	memcpy(transmit_buffer + idx, syncword, SYNC_LENGTH);
 	idx += SYNC_LENGTH;
 
-	//printf("udp payload: %s\n", dataptr);
-	len = udp_create_packet(src, src_port, dst, dst_port, dataptr, datalen, udp_buffer);
-	if(len == 0)
-	{
-		fprintf(stderr, "couldn't prepare udp packet\n");
-		return -2;
-	}
-
 #if ETHERNET_ENABLED==1
-	//printf("eth payload: %s\n", udp_buffer);
-	len = eth_create_packet(eth_get_local_address(NULL), eth_get_broadcast_address(NULL), udp_buffer, len, ethernet_buffer);
+	//printf("eth payload: %s\n", packet);
+	len = eth_create_packet(eth_get_local_address(NULL), eth_get_broadcast_address(NULL), packet, len, ethernet_buffer);
 	if(len==0)
 	{
 		fprintf(stderr, "couldn't prepare eth packet\n");
@@ -225,8 +368,11 @@ uint8_t queueSerialData(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t
 	}
 	len = manchester_encode(ethernet_buffer, manchester_buffer, len);
 #elif AX25_ENABLED==1
-	//printf("ax25 payload: %s\n", udp_buffer);
-	len = ax25_create_ui_packet(src, ax25_get_broadcast_callsign(NULL), udp_buffer, len, ax25_buffer);
+	//printf("ax25 payload: %s\n", packet);
+	next_hop = memcmp(dst, udp_get_broadcast_ip(NULL), IPV4_DESTINATION_LENGTH) ? route_lookup(dst) : NULL;
+	if(next_hop == NULL)
+		next_hop = ax25_get_broadcast_callsign(NULL);
+	len = ax25_create_ui_packet(ax25_get_local_callsign(NULL), next_hop, packet, len, ax25_buffer);
 	if (len == 0)
 	{
 		fprintf(stderr, "couldn't prepare ax25 packet\n");
@@ -234,7 +380,7 @@ uint8_t queueSerialData(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t
 	}
 	len = manchester_encode(ax25_buffer, manchester_buffer, len);
 #else
-	len = manchester_encode(udp_buffer, manchester_buffer, len);
+	len = manchester_encode(packet, manchester_buffer, len);
 #endif
 
 	memcpy(&transmit_buffer[idx], manchester_buffer, len);
@@ -243,26 +389,100 @@ uint8_t queueSerialData(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t
 	transmit_buffer[idx++] = END_OF_FILE;
 	transmit_buffer[idx++] = 0;
 
-	queue_flag = 1;
-	transmit_length = idx;
+	spsc_commit(queue, idx);
+	wakeUp(pipeline.txWake);
 
 	//print_time("data queued");
 
 	return 0;
 }
-uint16_t transmitSerialData(void)
+/* queues the fragments of the kept datagram whose bits are set in missing */
+uint8_t queueFragments(uint8_t missing)
+{
+	uint8_t i, res, parts = 0;
+	uint16_t len;
+
+	//half a datagram is no use to the other side, queue all of it or none
+	for(i = 0; i < kept.parts; i++)
+		parts += (missing >> i) & 1;
+	if(TX_QUEUE_SLOTS - spsc_count(&pipeline.txQueue[kept.traffic_class]) < parts)
+	{
+		LINKSTATS_COUNT(net, queue_full);
+		return -1;
+	}
+	for(i = 0; i < kept.parts; i++)
+	{
+		if(!(missing & (1 << i)))
+			continue;
+		len = udp_create_fragment(kept.src, kept.src_port, kept.dst, kept.dst_port, kept.payload, kept.length, kept.identification,
+				i * UDP_FRAGMENT_LENGTH, udp_buffer);
+		if(len == 0)
+		{
+			fprintf(stderr, "couldn't prepare fragment %d\n", i);
+			return -2;
+		}
+		if((res = queuePacket(&pipeline.txQueue[kept.traffic_class], kept.dst, udp_buffer, len)))
+			return res;
+	}
+	return 0;
+}
+uint8_t queueSerialData(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t dst_port, uint8_t* dataptr, uint16_t datalen)
+{
+	uint16_t len;
+
+	if(datalen <= UDP_MAX_PAYLOAD_LENGTH)
+	{
+		//printf("udp payload: %s\n", dataptr);
+		len = udp_create_packet(src, src_port, dst, dst_port, dataptr, datalen, udp_buffer);
+		if(len == 0)
+		{
+			fprintf(stderr, "couldn't prepare udp packet\n");
+			return -2;
+		}
+#if TDMA_ENABLED==1
+		if(dst_port == TDMA_BEACON_PORT && pipeline.slots)
+			return queuePacket(&pipeline.beaconQueue, dst, udp_buffer, len);
+#endif
+		return queuePacket(&pipeline.txQueue[txqueue_classify(src_port, dst_port, dataptr, datalen)], dst, udp_buffer, len);
+	}
+	if(datalen > UDP_MAX_DATAGRAM_LENGTH)
+	{
+		fprintf(stderr, "datagram of %d bytes is too long\n", datalen);
+		return -2;
+	}
+
+	//too long for one frame, keep it until the other side stops nacking
+	memcpy(kept.src, src, IPV4_SOURCE_LENGTH);
+	memcpy(kept.dst, dst, IPV4_DESTINATION_LENGTH);
+	kept.src_port = src_port;
+	kept.dst_port = dst_port;
+	kept.length = datalen;
+	kept.traffic_class = txqueue_classify(src_port, dst_port, dataptr, datalen);
+	memcpy(kept.payload, dataptr, datalen);
+	if(++next_identification == 0)
+		next_identification = 1;
+	kept.identification = next_identification;
+	kept.parts = (datalen + 8 + UDP_FRAGMENT_LENGTH - 1) / UDP_FRAGMENT_LENGTH;
+	return queueFragments((1 << kept.parts) - 1);
+}
+uint8_t* stageSerialData(uint16_t src_port, uint16_t dst_port, uint16_t opcode)
+{
+	//memory is not scarce here, every payload is built in the same buffer
+	return stage_buffer;
+}
+uint16_t transmitSerialFrame(pipeline_t* p, uint8_t* transmit_buffer, uint16_t transmit_length)
 {
 	uint16_t res = 0;
 	int fd_flags = 0;
 	struct sigaction save_buffer[2];
 
-	fd_flags = fcntl(serialportFd, F_GETFL);
-	fcntl(serialportFd, F_SETFL, O_RDWR | O_SYNC);
+	fd_flags = fcntl(p->fd, F_GETFL);
+	fcntl(p->fd, F_SETFL, O_RDWR | O_SYNC);
 
-	tcflush(serialportFd, TCIFLUSH);
-	tcflush(serialportFd, TCOFLUSH);
+	tcflush(p->fd, TCIFLUSH);
+	tcflush(p->fd, TCOFLUSH);
 
-	if(tcsetattr(serialportFd, TCSANOW, &tp) < 0)
+	if(tcsetattr(p->fd, TCSANOW, &p->tp) < 0)
 	{
 		perror("Couldn't set term attributes");
 		return -1;
@@ -273,11 +493,11 @@ uint16_t transmitSerialData(void)
 	sigaction(SIGIO, NULL, &(save_buffer[1]));
 #endif
 
-	setRTS(0);
+	setPortRTS(p->fd, 0);
 	usleep(5000ul);
 
 	{
-		res = write(serialportFd, transmit_buffer, transmit_length);
+		res = write(p->fd, transmit_buffer, transmit_length);
 		/*
 		 for(i=0; i < idx; i++)
 		 {
@@ -295,6 +515,8 @@ uint16_t transmitSerialData(void)
 		{
 			return -2;
 		}
+		PIPELINE_COUNT(p, frames_tx, 1);
+		PIPELINE_COUNT(p, bytes_tx, transmit_length);
 		//wait for the buffer to be flushed
 		usleep(100000ul + (transmit_length * 1 / 300) * 100000ul);
 	}
@@ -304,10 +526,10 @@ uint16_t transmitSerialData(void)
 	sigaction(SIGIO, &(save_buffer[1]), NULL);
 #endif
 
-	setRTS(1);
+	setPortRTS(p->fd, 1);
 
-	fcntl(serialportFd, F_GETFL);
-	fcntl(serialportFd, F_SETFL, fd_flags | O_RDWR | O_ASYNC);
+	fcntl(p->fd, F_GETFL);
+	fcntl(p->fd, F_SETFL, fd_flags | O_RDWR | O_ASYNC);
 
 	//print_time("data sent");
 
@@ -321,12 +543,13 @@ uint8_t udp_packet_demultiplexer(uint8_t* src, uint16_t src_port, uint8_t* dst,
 //    printf("== DST: %02x.%02x.%02x.%02x.%02x.%02x:%d ==\n", dst[0], dst[1], dst[2], dst[3], dst[4], dst[5], dst_port);
 
 	uint8_t different = 0;
+	uint8_t snapshot[LINKSTATS_SNAPSHOT_LENGTH];
 
 	//check for address match
-	different = strncmp(udp_get_localhost_ip(NULL), dst, IPV6_DESTINATION_LENGTH);
+	different = memcmp(udp_get_localhost_ip(NULL), dst, IPV4_DESTINATION_LENGTH);
 	if(different)
 	{
-		different = strncmp(udp_get_broadcast_ip(NULL), dst, IPV6_DESTINATION_LENGTH);
+		different = memcmp(udp_get_broadcast_ip(NULL), dst, IPV4_DESTINATION_LENGTH);
 	}
 
 	if(!different)
@@ -341,9 +564,36 @@ uint8_t udp_packet_demultiplexer(uint8_t* src, uint16_t src_port, uint8_t* dst,
 			//printf("tftp negotiate port\n");
 			tftp_transfer(src, src_port, dst, dst_port, payload, len - 8);
 		}
+		else if(dst_port == STATS_QUERY_PORT)
+		{
+			if(linkstats_is_query(payload, len - 8))
+			{
+				queueSerialData(udp_get_localhost_ip(NULL), STATS_QUERY_PORT, src, src_port, snapshot,
+						linkstats_snapshot(snapshot, time(NULL) - started));
+			}
+		}
+		else if(dst_port == FRAG_NACK_PORT)
+		{
+			//resend only the fragments the other side is missing
+			if(len - 8 >= FRAG_NACK_LENGTH && kept.identification != 0
+					&& ((payload[FRAG_NACK_IDENTIFICATION_OFFSET] << 8) | payload[FRAG_NACK_IDENTIFICATION_OFFSET + 1]) == kept.identification)
+			{
+				queueFragments(payload[FRAG_NACK_MISSING_OFFSET] & ((1 << kept.parts) - 1));
+			}
+		}
 		else if(dst_port == HELLO_WORLD_PORT)
 		{
-			printf("New neighbour:\nIP = %d.%d.%d.%d.%d.%d\n", src[0], src[1], src[2], src[3], src[4], src[5]);
+#if AX25_ENABLED==1
+			if(!neighbour_beacon_received(link_src, src, payload, len - 8))
+			{
+				trickle_consistent();
+			}
+			else
+#endif
+			{
+				printf("New neighbour:\nIP = %d.%d.%d.%d\n", src[0], src[1], src[2], src[3]);
+				trickle_inconsistent();
+			}
 		}
 		else
 		{
@@ -360,113 +610,731 @@ uint8_t udp_packet_demultiplexer(uint8_t* src, uint16_t src_port, uint8_t* dst,
 	}
 	return 0;
 }
-int main(int ac, char *av[])
+/*
+ * puts fragmented datagrams for us back together, the host relays nothing
+ * returns the whole packet once its last fragment is in, NULL until then
+ */
+uint8_t* receiveFragment(uint8_t* packet)
 {
-	uint16_t i, j, len;
-	int16_t res = 0, result = 0;
-	uint8_t destination_ip[32];
-	uint8_t outbuf[512];
-	uint8_t linebuf[32];
-	uint8_t local_filename[32] = "\0";
-	FILE* sptr;
-
-	if(ac == 1)
-		usage();
-
-	if(!strcmp("radiotftp_client", av[0]))
-	{
-
-	}
-	else if(!strcmp("radiotftp_server", av[0]))
-	{
-
-	}
-	else
-	{
-
-	}
-
-	//setting defaults
-	udp_get_broadcast_ip(destination_ip);
-	baud = B38400;
-	strcpy(dial_tty, "/dev/ttyUSB0");
+	uint8_t nack[FRAG_NACK_LENGTH];
+	uint16_t length, nack_length;
+
+	if(udp_check_destination(udp_get_localhost_ip(NULL), NULL, packet))
+		return NULL;
+	memcpy(udp_src, packet + IPV4_SOURCE_OFFSET, IPV4_SOURCE_LENGTH);
+	packet = frag_reassemble(packet, &length, nack, &nack_length);
+	if(nack_length)
+		queueSerialData(udp_get_localhost_ip(NULL), FRAG_NACK_PORT, udp_src, FRAG_NACK_PORT, nack, nack_length);
+	return packet;
+}
+/* nacks what datagrams that went quiet are still missing, the host polls instead of arming a timer */
+void pollFragments(void)
+{
+	uint8_t nack[FRAG_NACK_LENGTH];
+	uint8_t dst[IPV4_SOURCE_LENGTH];
+	uint16_t nack_length;
 
-	for(i = 1; (i < ac) && (av[i][0] == '-'); i++)
+	while(frag_poll(dst, nack, &nack_length))
+		queueSerialData(udp_get_localhost_ip(NULL), FRAG_NACK_PORT, dst, FRAG_NACK_PORT, nack, nack_length);
+}
+/* decodes a frame the reader found and hands what is in it to udp */
+void processFrame(uint8_t* frame, uint16_t length)
+{
+	uint8_t outbuf[512];
+	uint8_t* packet;
+	int16_t result;
+	uint8_t valid;
+
+	outbuf[0] = 0;
+	result = manchester_decode_valid(frame, manchester_buffer, length, &valid);
+	if(!valid)
+		LINKSTATS_COUNT(phy, invalid_symbols);
+#if ETHERNET_ENABLED==1
+	result = eth_open_packet(NULL, NULL, ethernet_buffer, manchester_buffer, result);
+#elif AX25_ENABLED==1
+	result = ax25_open_ui_packet(link_src, NULL, ax25_buffer, manchester_buffer, result);
+#else
+	result = 1;
+#endif
+	if(result)
 	{
-		if(strcmp(av[i], "-300") == 0)
+#if ETHERNET_ENABLED==1
+		packet = ethernet_buffer;
+#elif AX25_ENABLED==1
+		packet = ax25_buffer;
+		neighbour_frame_received(link_src);
+#else
+		packet = manchester_buffer;
+#endif
+		if(udp_is_fragment(packet))
 		{
-			baud = B300;
+			packet = receiveFragment(packet);
+			if(packet == NULL)
+				return;
 		}
-		else if(strcmp(av[i], "-600") == 0)
+		result = udp_open_packet(udp_src, &udp_src_prt, udp_dst, &udp_dst_prt, udp_buffer, packet);
+		if(result)
 		{
-			baud = B600;
+#if AX25_ENABLED==1
+			//a node that needed a relay to reach us is answered through the same relay
+			if(packet[IPV4_TIME_TO_LIVE_OFFSET] <= IPV4_TTL_LIMIT)
+				route_learn(udp_src, link_src, IPV4_TTL_LIMIT - packet[IPV4_TIME_TO_LIVE_OFFSET]);
+#endif
+			//a datagram for us seen before is a retransmission, only a data block needs its ack again
+			if(!udp_check_destination(udp_get_localhost_ip(NULL), NULL, packet) && dupcache_check(packet))
+			{
+				if(udp_dst_prt == tftp_transfer_src_port())
+					tftp_duplicate(udp_src, udp_src_prt, udp_dst, udp_dst_prt, udp_buffer, result - 8);
+			}
+			else
+			{
+				udp_packet_demultiplexer(udp_src, udp_src_prt, udp_dst, udp_dst_prt, udp_buffer, result);
+			}
 		}
-		else if(strcmp(av[i], "-1200") == 0)
+		else
 		{
-			baud = B1200;
+			LINKSTATS_COUNT(net, checksum_failures);
+			strcat(outbuf, "!udp discarded!");
+			if(write(1, outbuf, strlen(outbuf)) <= 0)
+			{
+				fputs("couldn't write to tty\n", stderr);
+			}
+			if(write(1, "\n", 1) <= 0)
+			{
+				fputs("couldn't write to tty\n", stderr);
+			}
 		}
-		else if(strcmp(av[i], "-2400") == 0)
+		//a reassembled datagram has been handled by now
+		frag_release();
+	}
+	else
+	{
+		LINKSTATS_COUNT(link, crc_failures);
+#if AX25_ENABLED==1
+		//the source address was copied out before the fcs check
+		neighbour_crc_failed(link_src);
+#endif
+		strcat(outbuf, "!eth discarded!");
+		if(write(1, outbuf, strlen(outbuf)) <= 0)
 		{
-			baud = B2400;
+			fputs("couldn't write to tty\n", stderr);
 		}
-		else if(strcmp(av[i], "-4800") == 0)
+		if(write(1, "\n", 1) <= 0)
 		{
-			baud = B4800;
+			fputs("couldn't write to tty\n", stderr);
 		}
-		else if(strcmp(av[i], "-9600") == 0)
+	}
+}
+/*
+ * reader thread, looks for the sync word and copies the frame after it up to the
+ * eof into an rx slot, decoding is left to the radio's thread
+ */
+void* readerLoop(void* arg)
+{
+	pipeline_t* p = arg;
+	struct pollfd pfd;
+	uint8_t io[BUFSIZ];
+	uint8_t* frame = NULL;
+	int sync_counter = 0;
+	int sync_passed = 0;
+	uint16_t save_index = 0;
+	uint8_t active;
+	int i, res;
+
+	pfd.fd = p->fd;
+	pfd.events = POLLIN;
+	while(__atomic_load_n(&p->running, __ATOMIC_ACQUIRE))
+	{
+		if(poll(&pfd, 1, 100) <= 0)
 		{
-			baud = B9600;
+			//a line that went quiet halfway through a sync word or a frame has nothing more to give
+			if(sync_passed)
+				PIPELINE_COUNT(p, sync_aborts, 1);
+			frame = NULL;
+			sync_passed = 0;
+			sync_counter = 0;
+			save_index = 0;
+			__atomic_store_n(&p->rxBusy, 0, __ATOMIC_RELEASE);
+			continue;
 		}
-		else if(strcmp(av[i], "-19200") == 0)
+		if((res = read(p->fd, io, BUFSIZ)) <= 0)
 		{
-			baud = B19200;
+			//a tty that hung up polls readable for good, the other radios need the core
+			if(res == 0 || (errno != EAGAIN && errno != EINTR))
+				usleep(100000ul);
+			continue;
 		}
-		else if(strcmp(av[i], "-38400") == 0)
+
+		active = 0;
+		for(i = 0; i < res; i++)
 		{
-			baud = B38400;
+			if(sync_counter < SYNC_LENGTH && io[i] == syncword[sync_counter])
+			{
+				sync_counter++; /* sync continued */
+			}
+			else
+			{
+				sync_counter = 0; /* not a preamble, reset counter */
+			}
+			if(sync_counter >= SYNC_LENGTH && sync_passed == 0)
+			{ /* preamble passed */
+				sync_passed = 1;
+				save_index = 0;
+				PIPELINE_COUNT(p, sync_hits, 1);
+				if((frame = spsc_reserve(&p->rxQueue)) == NULL)
+					__atomic_add_fetch(&p->rxOverruns, 1, __ATOMIC_RELAXED);
+			}
+			else if(sync_passed)
+			{
+				if(io[i] == END_OF_FILE)
+				{
+					PIPELINE_COUNT(p, frames_rx, 1);
+					PIPELINE_COUNT(p, bytes_rx, save_index);
+					if(frame != NULL)
+					{
+						spsc_commit(&p->rxQueue, save_index);
+						wakeUp(p->rxWake);
+					}
+					frame = NULL;
+					sync_passed = 0;
+					sync_counter = 0;
+					save_index = 0;
+				}
+				else if(frame != NULL && save_index < p->rxQueue.slot_size)
+				{
+					frame[save_index++] = io[i];
+				}
+			}
+			//noise rarely forms valid symbols, only those count as someone on the air
+			if(isManchester_encoded(io[i]))
+				active = 1;
 		}
-		else if(strcmp(av[i], "-57600") == 0)
+		if(active)
+			__atomic_store_n(&p->rxActivity, clock_time(), __ATOMIC_RELEASE);
+		__atomic_store_n(&p->rxBusy, sync_passed || sync_counter > 0, __ATOMIC_RELEASE);
+	}
+	return NULL;
+}
+/*
+ * writer thread, the radio is half duplex so a frame waits for the one coming in,
+ * the drain time is slept here and never holds up the reader or the protocol
+ */
+uint8_t channelBusy(pipeline_t* p)
+{
+	if(__atomic_load_n(&p->rxBusy, __ATOMIC_ACQUIRE))
+		return 1;
+	return clock_time() - __atomic_load_n(&p->rxActivity, __ATOMIC_ACQUIRE) < RADIOMAC_QUIET_TIME_MS * CLOCK_SECOND / 1000;
+}
+/*
+ * the node's csma/ca from radiomac.c run inline, the writer has nothing else to do meanwhile
+ * each sense follows a random number of slots from a window that doubles up to RADIOMAC_MAX_BE
+ * returns RADIOMAC_DROP if the channel was busy RADIOMAC_MAX_BACKOFFS+1 times in a row
+ */
+uint8_t backoffChannel(pipeline_t* p)
+{
+	uint8_t nb, be = RADIOMAC_MIN_BE;
+
+	for(nb = 0; nb <= RADIOMAC_MAX_BACKOFFS; nb++)
+	{
+		usleep((rand_r(&p->macSeed) & ((1 << be) - 1)) * RADIOMAC_SLOT_TIME_MS * 1000ul);
+		if(!channelBusy(p))
+			return RADIOMAC_TRANSMIT;
+		if(be < RADIOMAC_MAX_BE)
+			be++;
+	}
+	return RADIOMAC_DROP;
+}
+/* the head of the most urgent class that has anything waiting, like txqueue_peek() on the node */
+spsc_t* nextTxQueue(pipeline_t* p)
+{
+	uint8_t i;
+
+	for(i = 0; i < TXQUEUE_NUM_CLASSES; i++)
+	{
+		if(spsc_count(&p->txQueue[i]))
+			return &p->txQueue[i];
+	}
+	return NULL;
+}
+#if TDMA_ENABLED==1
+/*
+ * a gateway keys up only in its own slot, the one after the node slots, and skips the carrier sense there
+ * its frames go first as long as they leave room for the beacon, which closes the slot and starts
+ * the next superframe, a frame too long to share the slot takes it alone and the nodes run one
+ * superframe on the schedule they already have
+ * returns how long the writer may wait before there is something to do
+ */
+int writeGatewaySlot(pipeline_t* p)
+{
+	clock_time_t now = clock_time();
+	clock_time_t superframe = (clock_time_t) p->slotMs * (p->slots + 1);
+	clock_time_t opens = p->superframeStart + (clock_time_t) p->slotMs * p->slots;
+	clock_time_t closes = opens + p->slotMs;
+	spsc_t* queue;
+	uint8_t* frame;
+	uint8_t* beacon;
+	uint16_t length, beacon_length, beacon_ms = 0;
+
+	if(now < opens)
+		return (opens - now < 100) ? opens - now : 100;
+	if((beacon = spsc_peek(&p->beaconQueue, &beacon_length)) != NULL)
+		beacon_ms = tdma_slot_length_ms(RADIOTFTP_RADIO_BAUD, beacon_length);
+	if((queue = nextTxQueue(p)) != NULL)
+	{
+		frame = spsc_peek(queue, &length);
+		if(now + tdma_slot_length_ms(RADIOTFTP_RADIO_BAUD, length) + beacon_ms > closes)
 		{
-			baud = B57600;
+			//never two superframes running without a beacon
+			if(p->beaconSkipped || now + tdma_slot_length_ms(RADIOTFTP_RADIO_BAUD, length) > closes)
+				frame = NULL;
+			else
+			{
+				p->beaconSkipped = 1;
+				p->superframeStart += superframe;
+			}
 		}
-		else if(strcmp(av[i], "-b") == 0)
+		if(frame != NULL)
 		{
-			background = 1;
+			transmitSerialFrame(p, frame, length);
+			spsc_release(queue);
+			return 0;
 		}
-		else if(strncmp(av[i], "-f", 2) == 0)
+	}
+	if(beacon == NULL)
+	{
+		//the radio's thread queues the next beacon on its next pass
+		if(now < closes)
+			return 10;
+		p->beaconSkipped = 1;
+		p->superframeStart += superframe;
+		return 0;
+	}
+	transmitSerialFrame(p, beacon, beacon_length);
+	spsc_release(&p->beaconQueue);
+	p->superframeStart = clock_time();
+	p->beaconSkipped = 0;
+	return 0;
+}
+#endif
+void* writerLoop(void* arg)
+{
+	pipeline_t* p = arg;
+	spsc_t* queue;
+	uint8_t* frame;
+	uint16_t length;
+
+	while(__atomic_load_n(&p->running, __ATOMIC_ACQUIRE))
+	{
+#if TDMA_ENABLED==1
+		if(p->slots)
 		{
-			strncpy(local_filename, av[i] + 2, 32);
-			printf("different filename = '%s'\n", local_filename);
+			waitForWake(p->txWake, writeGatewaySlot(p));
+			continue;
 		}
-		else if(strncmp(av[i], "-dst", 4) == 0)
+#endif
+		waitForWake(p->txWake, 100);
+		//an ack queued behind a data block overtakes it on the next pass
+		while((queue = nextTxQueue(p)) != NULL)
 		{
-			memset(destination_ip, 0, 32);
-			memcpy(destination_ip, av[i] + 4, strlen(av[i]) - 4);
-			/*! convert text ip to numerical */
-			text_to_ip(destination_ip, strlen(av[i]) - 4 + 1);
-			printf("Destination: ");
-			print_addr_dec(destination_ip);
+			frame = spsc_peek(queue, &length);
+			if(backoffChannel(p) == RADIOMAC_TRANSMIT)
+				transmitSerialFrame(p, frame, length);
+			else
+				PIPELINE_COUNT(p, busy_drops, 1);
+			spsc_release(queue);
 		}
-		else
-			usage();
-
 	}
-	res = 0;
-	result = 0;
-
-	strncpy(dial_tty, devtag_get(av[i]), sizeof(dial_tty));
-
-	while(!get_lock(dial_tty))
+	return NULL;
+}
+int startPipeline(void)
+{
+	sigset_t all, old;
+	uint8_t i;
+
+	pipeline.fd = serialportFd;
+	pipeline.tp = tp;
+	pipeline.rxActivity = clock_time() - RADIOMAC_QUIET_TIME_MS * CLOCK_SECOND / 1000;
+	pipeline.macSeed = rand();
+#if TDMA_ENABLED==1
+	spsc_initialize(&pipeline.beaconQueue, pipeline.beaconStorage[0], pipeline.beaconLengths, sizeof(pipeline.beaconStorage[0]), 1);
+	pipeline.slots = tdmaSlots;
+	pipeline.slotMs = tdma_slot_length_ms(RADIOTFTP_RADIO_BAUD, RADIOTFTP_FRAME_BUFFER_LENGTH);
+	pipeline.beaconSkipped = 0;
+	//the first beacon goes out right away
+	pipeline.superframeStart = clock_time() - (clock_time_t) pipeline.slotMs * pipeline.slots;
+#endif
+	spsc_initialize(&pipeline.rxQueue, pipeline.rxStorage[0], pipeline.rxLengths, sizeof(pipeline.rxStorage[0]), RX_QUEUE_SLOTS);
+	for(i = 0; i < TXQUEUE_NUM_CLASSES; i++)
+		spsc_initialize(&pipeline.txQueue[i], pipeline.txStorage[i][0], pipeline.txLengths[i], sizeof(pipeline.txStorage[i][0]), TX_QUEUE_SLOTS);
+	if(pipe(pipeline.rxWake) < 0 || pipe(pipeline.txWake) < 0)
 	{
-		if(decrementLockRetries() == 0)
-			exit(-1);
+		perror("couldn't create wake pipes");
+		return -1;
+	}
+	fcntl(pipeline.rxWake[0], F_SETFL, O_NONBLOCK);
+	fcntl(pipeline.rxWake[1], F_SETFL, O_NONBLOCK);
+	fcntl(pipeline.txWake[0], F_SETFL, O_NONBLOCK);
+	fcntl(pipeline.txWake[1], F_SETFL, O_NONBLOCK);
+
+	//timer and user signals have to land on the radio's thread, the others start with them blocked
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+	pipeline.running = 1;
+	if(pthread_create(&pipeline.reader, NULL, readerLoop, &pipeline))
+	{
+		pipeline.running = 0;
+	}
+	else if(pthread_create(&pipeline.writer, NULL, writerLoop, &pipeline))
+	{
+		pipeline.running = 0;
+		pthread_join(pipeline.reader, NULL);
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if(!pipeline.running)
+	{
+		perror("couldn't start the io threads");
+		return -1;
+	}
+	return 0;
+}
+/* the io threads look at running at least every 100ms */
+void stopPipeline(void)
+{
+	if(!pipeline.running)
+		return;
+	__atomic_store_n(&pipeline.running, 0, __ATOMIC_RELEASE);
+	pthread_join(pipeline.reader, NULL);
+	pthread_join(pipeline.writer, NULL);
+	close(pipeline.rxWake[0]);
+	close(pipeline.rxWake[1]);
+	close(pipeline.txWake[0]);
+	close(pipeline.txWake[1]);
+}
+/* moves what the io threads counted to linkstats, only the radio's thread may */
+void foldPipelineStats(void)
+{
+#define FOLD(counter) LINKSTATS_ADD(phy, counter, __atomic_exchange_n(&pipeline.phy.counter, 0, __ATOMIC_RELAXED))
+	FOLD(sync_hits);
+	FOLD(sync_aborts);
+	FOLD(frames_rx);
+	FOLD(frames_tx);
+	FOLD(bytes_rx);
+	FOLD(bytes_tx);
+	FOLD(busy_drops);
+#undef FOLD
+	LINKSTATS_ADD(net, queue_full, __atomic_exchange_n(&pipeline.rxOverruns, 0, __ATOMIC_RELAXED));
+}
+void goBackground(int keepFd)
+{
+	int i;
+	if(getppid() == 1)
+		return; /* Already a daemon */
+
+	i = fork();
+
+	if(i < 0)
+		exit(1); /* error */
+
+	if(i > 0)
+		_exit(0); /* parent exits */
+
+	/* child */
+
+	setsid(); /* obtain a new process group */
+	for(i = getdtablesize(); i >= 0; --i)
+	{
+		if(i == keepFd || i == workerFd)
+			continue;
+		if(i == 1)
+			continue;
+		close(i); /* close all descriptors */
+	}
+
+	i = open("/dev/null", O_RDWR);
+	dup(i);
+	dup(i); /* handle standard I/O */
+	umask(027); /* set newly created file permissions */
+	chdir("/"); /* change running directory */
+
+}
+void stopRadios(int sig)
+{
+	signal(sig, SIG_IGN);
+	radiopool_stop();
+	radiopool_print(stdout);
+	jobqueue_close();
+	exit(0);
+}
+/*
+ * the supervisor of a daemon with several radios never opens a tty itself,
+ * it only moves jobs between the socket and the radio threads
+ */
+void superviseRadios(void)
+{
+	signal(SIGINT, stopRadios);
+	signal(SIGTERM, stopRadios);
+	signal(SIGUSR1, sigUSR1_handler);
+	if(jobqueue_initialize(jobSocket))
+		stopRadios(SIGTERM);
+	printf("waiting for jobs on %s\n", jobSocket);
+	while(1)
+	{
+		radiopool_poll(100);
+		if(latency_flag)
+		{
+			//every radio dumps its own histograms
+			radiopool_signal(SIGUSR2);
+			radiopool_print(latencyFile != NULL ? latencyFile : stderr);
+			latency_flag = 0;
+		}
+	}
+}
+void tftpEvent(uint8_t event, uint8_t* peer, uint16_t block)
+{
+	latency_tftp_event(event, peer, block);
+	if(event != TFTP_EVENT_COMPLETE && event != TFTP_EVENT_ABORT)
+	{
+		//the job is still making progress
+		jobDeadline = time(NULL) + JOB_DEADLINE;
+		return;
+	}
+	transferStarted = 0;
+	if(currentJob != NULL)
+	{
+		jobqueue_finish(currentJob, (event == TFTP_EVENT_COMPLETE) ? 0 : -1);
+		currentJob = NULL;
+	}
+}
+uint16_t joinArguments(int first, int ac, char *av[], uint8_t* out)
+{
+	uint16_t i, j = 0, len;
+
+	for(i = first; i < ac; i++)
+	{
+		len = strlen(av[i]);
+		if(j + len + 1 >= sizeof(command_buffer))
+			break;
+		memcpy(out + j, av[i], len);
+		j += len;
+		if(i != ac - 1)
+		{
+			out[j++] = ' ';
+		}
+	}
+	out[j] = 0;
+	return j;
+}
+void unescapeCommand(uint8_t* command, uint16_t length)
+{
+	uint16_t i;
+
+	//process the escape characters
+	for(i = 0; i < length; i++)
+	{
+		if(command[i] == '\\')
+		{
+			if(i + 1 < length)
+			{
+				if(command[i + 1] == 'n')
+				{
+					command[i] = '\r';
+					command[i + 1] = '\n';
+				}
+			}
+		}
+	}
+}
+/*
+ * reads a whole local file into fileBuffer for tftp to send
+ * returns its length or negative if it can't be sent
+ */
+int32_t loadFile(uint8_t* filename)
+{
+	FILE* file;
+	long length;
+
+	if((file = fopen(filename, "rb")) == NULL)
+	{
+		perror("couldn't open the local file");
+		return -1;
+	}
+	fseek(file, 0, SEEK_END);
+	length = ftell(file);
+	rewind(file);
+	//blocks are numbered in a byte and the length is kept in 16 bits
+	if(length < 0 || length > 0xFFFF || length > 0xFF * TFTP_MAX_BLOCK_SIZE)
+	{
+		fprintf(stderr, "%s is too large to send\n", filename);
+		fclose(file);
+		return -1;
+	}
+	free(fileBuffer);
+	if((fileBuffer = malloc(length + 1)) == NULL || fread(fileBuffer, 1, length, file) != length)
+	{
+		perror("couldn't read the local file");
+		fclose(file);
+		return -1;
+	}
+	fclose(file);
+	return length;
+}
+/*
+ * starts what the command line or a queued job asked for
+ * transferStarted tells whether the job lasts until tftp reports it complete
+ */
+int16_t startCommand(uint8_t* destination_ip, uint8_t* local_filename, uint8_t* command, uint16_t j)
+{
+	int16_t res = 0;
+	uint16_t i;
+
+	transferStarted = 0;
+	if(!strncasecmp(RADIOTFTP_COMMAND_PUT, command, strlen(RADIOTFTP_COMMAND_PUT)))
+	{
+		printf(RADIOTFTP_COMMAND_PUT"\n");
+		if((res = loadFile(local_filename)) < 0)
+			return res;
+		if((res = tftp_sendRequest(TFTP_OPCODE_WRQ, destination_ip, fileBuffer, res, command + strlen(RADIOTFTP_COMMAND_PUT) + 1,
+				j - strlen(RADIOTFTP_COMMAND_PUT) - 1, 0)))
+		{
+			printf("%d\n", res);
+			perror("tftp request fail");
+			return res;
+		}
+		transferStarted = 1;
+	}
+	else if(!strncasecmp(RADIOTFTP_COMMAND_APPEND_LINE, command, strlen(RADIOTFTP_COMMAND_APPEND_LINE)))
+	{
+		printf(RADIOTFTP_COMMAND_APPEND_LINE"\n");
+		//the line itself is the file
+		i = j - strlen(RADIOTFTP_COMMAND_APPEND_LINE) - 1;
+		free(fileBuffer);
+		if((fileBuffer = malloc(i + 1)) == NULL)
+			return -1;
+		memcpy(fileBuffer, command + strlen(RADIOTFTP_COMMAND_APPEND_LINE) + 1, i);
+		if((res = tftp_sendRequest(TFTP_OPCODE_WRQ, destination_ip, fileBuffer, i, local_filename, strlen(local_filename), 1)))
+		{
+			printf("%d\n", res);
+			perror("tftp request fail");
+			return res;
+		}
+		transferStarted = 1;
+	}
+	else if(!strncasecmp(RADIOTFTP_COMMAND_APPEND_FILE, command, strlen(RADIOTFTP_COMMAND_APPEND_FILE)))
+	{
+		printf(RADIOTFTP_COMMAND_APPEND_FILE"\n");
+		if((res = loadFile(local_filename)) < 0)
+			return res;
+		if((res = tftp_sendRequest(TFTP_OPCODE_WRQ, destination_ip, fileBuffer, res, command + strlen(RADIOTFTP_COMMAND_APPEND_FILE) + 1,
+				j - strlen(RADIOTFTP_COMMAND_APPEND_FILE) - 1, 1)))
+		{
+			printf("%d\n", res);
+			perror("tftp request fail");
+			return res;
+		}
+		transferStarted = 1;
+	}
+	else if(!strncasecmp(RADIOTFTP_COMMAND_GET, command, strlen(RADIOTFTP_COMMAND_GET)))
+	{
+		//tftp only takes write requests, a read request would never complete nor abort
+		printf(RADIOTFTP_COMMAND_GET" is not supported, tftp only takes writes\n");
+		return -1;
+	}
+	else
+	{
+		printf("unknown command\n");
+		return -1;
+	}
+	return 0;
+}
+/*
+ * hands the most urgent queued job to tftp once the radio is free
+ * jobs that finish as soon as they are queued are answered right away
+ */
+void runNextJob(uint8_t* default_ip, uint8_t* default_filename)
+{
+	uint8_t destination_ip[32];
+	uint8_t* local_filename = default_filename;
+	int16_t res;
+
+	//a worker has nothing left to do once its supervisor is gone
+	if(jobqueue_poll() < 0)
+		safe_exit(0);
+	if(currentJob != NULL && time(NULL) >= jobDeadline)
+	{
+		printf("job %" PRIu32 ": no answer in %d seconds, giving up\n", currentJob->id, JOB_DEADLINE);
+		tftp_setStatus(TFTP_STATUS_IDLE);
+		transferStarted = 0;
+		jobqueue_finish(currentJob, -1);
+		currentJob = NULL;
+	}
+	if(currentJob != NULL || transferStarted || tftp_getStatus() != TFTP_STATUS_IDLE)
+		return;
+	if((currentJob = jobqueue_next()) == NULL)
+		return;
+
+	printf("job %" PRIu32 ": %s\n", currentJob->id, currentJob->command);
+	memcpy(destination_ip, default_ip, sizeof(destination_ip));
+	if(currentJob->destination[0])
+	{
+		memset(destination_ip, 0, sizeof(destination_ip));
+		strncpy(destination_ip, currentJob->destination, sizeof(destination_ip) - 1);
+		text_to_ip(destination_ip, strlen(currentJob->destination) + 1);
+	}
+	if(currentJob->local_filename[0])
+		local_filename = currentJob->local_filename;
+	unescapeCommand(currentJob->command, currentJob->command_length);
+
+	jobDeadline = time(NULL) + JOB_DEADLINE;
+	res = startCommand(destination_ip, local_filename, currentJob->command, currentJob->command_length);
+	if(res || !transferStarted)
+	{
+		jobqueue_finish(currentJob, res);
+		currentJob = NULL;
+	}
+}
+void usage(void)
+{
+	printf("usage: radiotftp [options] tty [put|append <remote file>|appendline <line>]\n");
+	printf("       radiotftp [options] -s<socket> tty [tty...]\n");
+	printf("       radiotftp [options] -q<socket> [-p<priority>] [-w] <command>\n");
+	printf("  -300 .. -57600  baud rate\n");
+	printf("  -b              go to the background\n");
+	printf("  -f<file>        local file, put and append read it, appendline names the remote file with it\n");
+	printf("  -dst<ip>        destination, broadcast by default\n");
+	printf("  -lat<file>      append latency histograms here on SIGUSR1 and exit\n");
+	printf("  -s<socket>      run as a daemon taking jobs on socket, one radio per tty\n");
+	printf("  -q<socket>      submit the command as a job to the daemon on socket\n");
+	printf("  -p<priority>    job priority, 0 is the most urgent\n");
+	printf("  -w              wait for the job to finish, exit with its result\n");
+	printf("                  a -f path too long to resolve is taken from the daemon's directory\n");
+#if TDMA_ENABLED==1
+	printf("  -tdma<ip>       give the node at ip the next tdma slot\n");
+#endif
+	exit(-1);
+}
+/*
+ * opens dial_tty and runs a whole stack on it until it exits, never returns
+ * a pool runs one on each of its threads, everything it keeps is RADIO_LOCAL
+ */
+void runRadio(uint16_t command_length)
+{
+	uint16_t len;
+	uint8_t* frame;
+	uint8_t beacon[NEIGHBOUR_BEACON_LENGTH];
+	uint8_t linebuf[32];
+	FILE* sptr;
+
+	while(!get_lock(dial_tty))
+	{
+		if(decrementLockRetries() == 0)
+			safe_exit(-1);
 		sleep(1);
 	}
 
-	if((serialportFd = open(devtag_get(av[i]), O_RDWR | O_NOCTTY | O_NONBLOCK)) < 0)
+	if((serialportFd = open(dial_tty, O_RDWR | O_NOCTTY | O_NONBLOCK)) < 0)
 	{
 		perror("bad terminal device, try another");
-		exit(-1);
+		safe_exit(-1);
 	}
 
 #if IO_DRIVEN==1
@@ -489,7 +1357,7 @@ int main(int ac, char *av[])
 	if(tcgetattr(serialportFd, &tp) < 0)
 	{
 		perror("Couldn't get term attributes");
-		exit(-1);
+		safe_exit(-1);
 	}
 	old = tp;
 
@@ -543,71 +1411,12 @@ int main(int ac, char *av[])
 
 	//TODO go over the background codes
 	if(background)
-	{
-		int i;
-		if(getppid() == 1)
-			return 0; /* Already a daemon */
-
-		i = fork();
-
-		if(i < 0)
-			exit(1); /* error */
-
-		if(i > 0)
-			_exit(0); /* parent exits */
-
-		/* child */
-
-		setsid(); /* obtain a new process group */
-		for(i = getdtablesize(); i >= 0; --i)
-		{
-			if(i == serialportFd)
-				continue;
-			if(i == 1)
-				continue;
-			close(i); /* close all descriptors */
-		}
-
-		i = open("/dev/null", O_RDWR);
-		dup(i);
-		dup(i); /* handle standard I/O */
-		umask(027); /* set newly created file permissions */
-		chdir("/"); /* change running directory */
-
-	}
-
-	srand((unsigned) time(NULL));
-
-	j = 0;
-	i++;
-	for(; i < ac; i++)
-	{
-		len = strlen(av[i]);
-		memcpy(command_buffer + j, av[i], len);
-		j += len;
-		if(i != ac - 1)
-		{
-			command_buffer[j++] = ' ';
-		}
-	}
+		goBackground(serialportFd);
 
-	//process the escape characters
-	for(i = 0; i < j; i++)
-	{
-		if(command_buffer[i] == '\\')
-		{
-			if(i + 1 < j)
-			{
-				if(command_buffer[i + 1] == 'n')
-				{
-					command_buffer[i] = '\r';
-					command_buffer[i + 1] = '\n';
-				}
-			}
-		}
-	}
-
-	timers_initialize(&sigRTALRM_handler);
+	timers_initialize(&radiotftpAlarm_callback);
+	linkstats_initialize();
+	latency_initialize();
+	started = time(NULL);
 
 	/*! read settings from radiotftp.conf file */
 	sptr = fopen("radiotftp.conf", "r");
@@ -616,7 +1425,7 @@ int main(int ac, char *av[])
 		readnline(sptr, linebuf, 32);
 		printf("AX25 Callsign: ");
 		printf("%s\n", linebuf);
-#if AX_25_ENABLED==1
+#if AX25_ENABLED==1
 		ax25_initialize_network(linebuf);
 		printf("USING AX25 LINK LAYER!!!\n");
 #endif
@@ -653,211 +1462,275 @@ int main(int ac, char *av[])
 		print_addr_dec(udp_get_localhost_ip(NULL));
 	}
 
-	tftp_initialize(udp_get_data_queuer_fptr());
+	route_initialize();
+	neighbour_initialize();
+	trickle_initialize(radiotftpBeacon_callback);
+	dupcache_initialize();
+	bufpool_initialize();
+	frag_initialize(NULL);
+	tftp_initialize(udp_get_data_queuer_fptr(), stageSerialData);
+	tftp_set_event_handler(&tftpEvent);
 
-	if(!strncasecmp(RADIOTFTP_COMMAND_PUT, command_buffer, strlen(RADIOTFTP_COMMAND_PUT)))
+	if(workerFd >= 0)
 	{
-		printf(RADIOTFTP_COMMAND_PUT"\n");
-		if((res = tftp_sendRequest(TFTP_OPCODE_WRQ, destination_ip, local_filename, command_buffer + strlen(RADIOTFTP_COMMAND_PUT) + 1,
-				j - strlen(RADIOTFTP_COMMAND_PUT) - 1, 0)))
-		{
-			printf("%d\n", res);
-			perror("tftp request fail");
-			goto error;
-		}
+		printf("%s waiting for jobs\n", dial_tty);
 	}
-	else if(!strncasecmp(RADIOTFTP_COMMAND_APPEND_LINE, command_buffer, strlen(RADIOTFTP_COMMAND_APPEND_LINE)))
+	else if(daemonMode)
 	{
-		printf(RADIOTFTP_COMMAND_APPEND_LINE"\n");
-		i = createTempFile(TEMPFILE_PREFIX, TEMPFILE_POSTFIX);
-		if(tempFile == NULL)
-		{
-			perror("couldn't create temp file to store the line feed");
+		if(jobqueue_initialize(jobSocket))
 			goto error;
-		}
-		fwrite(command_buffer + strlen(RADIOTFTP_COMMAND_APPEND_LINE) + 1, 1, j - strlen(RADIOTFTP_COMMAND_APPEND_LINE) - 1, tempFile);
-		fflush(tempFile);
-		fclose(tempFile);
-		if((res = tftp_sendRequest(TFTP_OPCODE_WRQ, destination_ip, tempFileName, local_filename, strlen(local_filename), 1)))
-		{
-			printf("%d\n", res);
-			perror("tftp request fail");
-			goto error;
-		}
+		printf("waiting for jobs on %s\n", jobSocket);
 	}
-	else if(!strncasecmp(RADIOTFTP_COMMAND_APPEND_FILE, command_buffer, strlen(RADIOTFTP_COMMAND_APPEND_FILE)))
-	{
-		printf(RADIOTFTP_COMMAND_APPEND_FILE"\n");
-		if((res = tftp_sendRequest(TFTP_OPCODE_WRQ, destination_ip, local_filename, command_buffer + strlen(RADIOTFTP_COMMAND_APPEND_FILE) + 1,
-				j - strlen(RADIOTFTP_COMMAND_APPEND_FILE) - 1, 1)))
-		{
-			printf("%d\n", res);
-			perror("tftp request fail");
-			goto error;
-		}
-	}
-	else if(!strncasecmp(RADIOTFTP_COMMAND_GET, command_buffer, strlen(RADIOTFTP_COMMAND_GET)))
-	{
-		printf(RADIOTFTP_COMMAND_GET"\n");
-		if((res = tftp_sendRequest(TFTP_OPCODE_RRQ, destination_ip, local_filename, command_buffer + strlen(RADIOTFTP_COMMAND_GET) + 1,
-				j - strlen(RADIOTFTP_COMMAND_GET) - 1, 0)))
-		{
-			printf("%d\n", res);
-			perror("tftp request fail");
-			goto error;
-		}
-	}
-	else
+
+	//the writer has to be up before the first frame is queued for it
+	if(startPipeline())
+		goto error;
+
+	//a daemon only runs queued jobs, without a command we just listen and beacon
+	if(!daemonMode && command_length)
 	{
-		printf("hello radio world!\n");
-		if((res = queueSerialData(udp_get_localhost_ip(NULL), HELLO_WORLD_PORT, udp_get_broadcast_ip(NULL), HELLO_WORLD_PORT, "hello world\n\0x00",
-				strlen("hello world\n\0x00"))))
-		{
-			printf("%d\n", res);
-			perror("tftp request fail");
+		if(startCommand(destination_ip, local_filename, command_buffer, command_length))
 			goto error;
-		}
 	}
 
-	int sync_counter = 0;
-	int sync_passed = 0;
-	int save_index = 0;
 	//entering the main while loop
 	printf("started listening...\n");
 	while(1)
 	{
+		waitForWake(pipeline.rxWake, ctimer_run(100));
+		ctimer_run(0);
 		if(timer_flag)
 		{
 			idle_timer_handler();
 			tftp_timer_handler();
 			timer_flag = 0;
 		}
+		if(daemonMode)
+		{
+			runNextJob(destination_ip, local_filename);
+		}
+		pollFragments();
+		if(beacon_flag)
+		{
+			beacon_flag = 0;
+			len = neighbour_build_beacon(beacon);
+			queueSerialData(udp_get_localhost_ip(NULL), HELLO_WORLD_PORT, udp_get_broadcast_ip(NULL), HELLO_WORLD_PORT, beacon, len);
+		}
+#if TDMA_ENABLED==1
+		sendBeacon();
+#endif
+		if(latency_flag)
+		{
+			latency_dump(latencyFile != NULL ? latencyFile : stderr);
+			latency_flag = 0;
+		}
 		if(idle_flag)
 		{
 			//print_time("System Idle");
 			//usleep(1000l);
 			idle_flag = 0;
 		}
-		if(queue_flag)
+		while((frame = spsc_peek(&pipeline.rxQueue, &len)) != NULL)
 		{
-			if(!sync_passed && sync_counter < 1)
-			{
-#if IO_DRIVEN==1
-				usleep(600000ul);
-#else
-				usleep(200000ul);
+			processFrame(frame, len);
+			spsc_release(&pipeline.rxQueue);
+		}
+		foldPipelineStats();
+	}
+
+	safe_exit(0);
+	error: safe_exit(-1);
+}
+/* a radio of a pool, on a thread of its own until the supervisor hangs up */
+void radioWorker(uint8_t radio, int fd)
+{
+	//attached first, however the radio ends its connection is closed on the way out
+	workerFd = fd;
+	if(jobqueue_attach(fd))
+	{
+		close(fd);
+		return;
+	}
+	strncpy(dial_tty, radiopool_tty(radio), sizeof(dial_tty) - 1);
+	runRadio(0);
+}
+int main(int ac, char *av[])
+{
+	uint16_t i, j;
+#if TDMA_ENABLED==1
+	uint8_t linebuf[32];
 #endif
-				transmitSerialData();
-				queue_flag = 0;
+	uint8_t destination_text[32] = "\0";
+	uint8_t job_priority = JOBQUEUE_DEFAULT_PRIORITY;
+	uint8_t job_wait = 0;
+	int submitMode = 0;
+
+	if(ac == 1)
+		usage();
+
+	if(!strcmp("radiotftp_client", av[0]))
+	{
+
+	}
+	else if(!strcmp("radiotftp_server", av[0]))
+	{
+
+	}
+	else
+	{
+
+	}
+
+	//setting defaults
+	udp_get_broadcast_ip(destination_ip);
+	baud = B38400;
+	strcpy(dial_tty, "/dev/ttyUSB0");
+
+	for(i = 1; (i < ac) && (av[i][0] == '-'); i++)
+	{
+		if(strcmp(av[i], "-300") == 0)
+		{
+			baud = B300;
+		}
+		else if(strcmp(av[i], "-600") == 0)
+		{
+			baud = B600;
+		}
+		else if(strcmp(av[i], "-1200") == 0)
+		{
+			baud = B1200;
+		}
+		else if(strcmp(av[i], "-2400") == 0)
+		{
+			baud = B2400;
+		}
+		else if(strcmp(av[i], "-4800") == 0)
+		{
+			baud = B4800;
+		}
+		else if(strcmp(av[i], "-9600") == 0)
+		{
+			baud = B9600;
+		}
+		else if(strcmp(av[i], "-19200") == 0)
+		{
+			baud = B19200;
+		}
+		else if(strcmp(av[i], "-38400") == 0)
+		{
+			baud = B38400;
+		}
+		else if(strcmp(av[i], "-57600") == 0)
+		{
+			baud = B57600;
+		}
+		else if(strcmp(av[i], "-b") == 0)
+		{
+			background = 1;
+		}
+		else if(strncmp(av[i], "-f", 2) == 0)
+		{
+			strncpy(local_filename, av[i] + 2, 32);
+			printf("different filename = '%s'\n", local_filename);
+		}
+		else if(strncmp(av[i], "-lat", 4) == 0)
+		{
+			latencyFile = fopen(av[i] + 4, "a");
+			if(latencyFile == NULL)
+			{
+				perror("couldn't open latency file");
+				exit(-1);
 			}
 		}
-#if IO_DRIVEN==1
-		if(io_flag)
-#endif
+		else if(strncmp(av[i], "-dst", 4) == 0)
 		{
-			if((res = read(serialportFd, io, BUFSIZ)) > 0)
+			strncpy(destination_text, av[i] + 4, sizeof(destination_text) - 1);
+			memset(destination_ip, 0, 32);
+			memcpy(destination_ip, av[i] + 4, strlen(av[i]) - 4);
+			/*! convert text ip to numerical */
+			text_to_ip(destination_ip, strlen(av[i]) - 4 + 1);
+			printf("Destination: ");
+			print_addr_dec(destination_ip);
+		}
+		else if(strncmp(av[i], "-s", 2) == 0)
+		{
+			strncpy(jobSocket, av[i] + 2, sizeof(jobSocket) - 1);
+			daemonMode = 1;
+		}
+		else if(strncmp(av[i], "-q", 2) == 0)
+		{
+			strncpy(jobSocket, av[i] + 2, sizeof(jobSocket) - 1);
+			submitMode = 1;
+		}
+		else if(strncmp(av[i], "-p", 2) == 0)
+		{
+			job_priority = atoi(av[i] + 2);
+		}
+		else if(strcmp(av[i], "-w") == 0)
+		{
+			job_wait = 1;
+		}
+#if TDMA_ENABLED==1
+		else if(strncmp(av[i], "-tdma", 5) == 0)
+		{
+			//every -tdma<ip> gives that node the next slot of the superframe
+			if(tdmaSlots >= TDMA_MAX_SLOTS)
 			{
-				//printf("# of bytes read = %d\n", res);
-
-				for(i = 0; i < res; i++)
-				{
-					//printf("%02x\n",io[i]);
-					if(sync_counter < SYNC_LENGTH && io[i] == syncword[sync_counter])
-					{
-						sync_counter++; /* sync continued */
-						//printf("sync counting %d\n",sync_counter);
-					}
-					else
-					{
-						//printf("sync reset %d\n",sync_counter);
-						sync_counter = 0; /* not a preamble, reset counter */
-					}
-					if(sync_counter >= SYNC_LENGTH && sync_passed == 0)
-					{ /* preamble passed */
-						sync_passed = 1;
-					}
-					if(sync_passed)
-					{
-						//printf("getting data '%c'\n", io[i]);
-						if(io[i] == END_OF_FILE)
-						{
-							//printf("EOF\n");
-							outbuf[0] = 0;
-							result = manchester_decode(buf + 1, manchester_buffer, save_index);
-#if ETHERNET_ENABLED==1
-							result = eth_open_packet(NULL, NULL, ethernet_buffer, manchester_buffer, result);
-#elif AX25_ENABLED==1
-							result = ax25_open_ui_packet(NULL, NULL, ax25_buffer, manchester_buffer, result);
-#else
-							result = 1;
-#endif
-							if(result)
-							{
-								//strcat(outbuf, ethernet_buffer);
-								//printf("%s\n",buf);
-								//write(1, outbuf, strlen(outbuf));
-								//write(1, "\n", 1);
-#if ETHERNET_ENABLED==1
-								result = udp_open_packet(udp_src, &udp_src_prt, udp_dst, &udp_dst_prt, udp_buffer, ethernet_buffer);
-#elif AX25_ENABLED==1
-								result = udp_open_packet(udp_src, &udp_src_prt, udp_dst, &udp_dst_prt, udp_buffer, ax25_buffer);
-#else
-								result = udp_open_packet(udp_src, &udp_src_prt, udp_dst, &udp_dst_prt, udp_buffer, manchester_buffer);
-#endif
-								if(result)
-								{
-									//strncat(outbuf, udp_buffer, result);
-									//printf("%s\n",buf);
-									//write(1, outbuf, strlen(outbuf));
-									//write(1, "\n", 1);
-									udp_packet_demultiplexer(udp_src, udp_src_prt, udp_dst, udp_dst_prt, udp_buffer, result);
-								}
-								else
-								{
-									strcat(outbuf, "!udp discarded!");
-									if(write(1, outbuf, strlen(outbuf)) <= 0)
-									{
-										fputs("couldn't write to tty\n", stderr);
-									}
-									if(write(1, "\n", 1) <= 0)
-									{
-										fputs("couldn't write to tty\n", stderr);
-									}
-								}
-							}
-							else
-							{
-								strcat(outbuf, "!eth discarded!");
-								if(write(1, outbuf, strlen(outbuf)) <= 0)
-								{
-									fputs("couldn't write to tty\n", stderr);
-								}
-								if(write(1, "\n", 1) <= 0)
-								{
-									fputs("couldn't write to tty\n", stderr);
-								}
-							}
-							sync_passed = 0;
-							sync_counter = 0;
-							save_index = 0;
-						}
-						else
-						{
-							//printf("saved data '%c'\n", io[i]);
-							//printf("save_index=%d\ti=%d\n",save_index,i);
-							buf[save_index++] = io[i];
-							buf[save_index + 1] = 0;
-							//printf("-\n%s\n-\n", buf);
-						}
-					}
-				}
-				io_flag = 0;
+				fprintf(stderr, "too many tdma slots\n");
+				exit(-1);
 			}
+			memset(linebuf, 0, sizeof(linebuf));
+			strncpy(linebuf, av[i] + 5, sizeof(linebuf) - 1);
+			text_to_ip(linebuf, strlen(linebuf) + 1);
+			memcpy(tdmaOwners[tdmaSlots++], linebuf, 4);
 		}
+#endif
+		else
+			usage();
+
 	}
 
-	safe_exit(0);
-	error: safe_exit(-1);
+	//the daemon already has the radio, just hand it the job
+	if(submitMode)
+	{
+		//the daemon runs somewhere else, it needs the whole path when it fits in a job
+		if(local_filename[0] && realpath(local_filename, command_buffer) != NULL && strlen(command_buffer) < sizeof(local_filename))
+			strcpy(local_filename, command_buffer);
+		j = joinArguments(i, ac, av, command_buffer);
+		exit(jobqueue_submit(jobSocket, job_priority, job_wait, destination_text, local_filename, command_buffer));
+	}
+
+	if(i >= ac)
+		usage();
+	signal(SIGUSR1, sigUSR1_handler);
+	//a pool's supervisor passes SIGUSR1 on to its radio threads as SIGUSR2
+	signal(SIGUSR2, sigUSR1_handler);
+	srand((unsigned) time(NULL));
 
-	return -2;
+	//a daemon takes every argument left as a radio, each one more gets a thread of its own
+	if(daemonMode && ac - i > 1)
+	{
+		for(j = i; j < ac; j++)
+		{
+			if(radiopool_add(devtag_get(av[j])) < 0)
+			{
+				fprintf(stderr, "too many radios\n");
+				exit(-1);
+			}
+		}
+		if(background)
+			goBackground(-1);
+		background = 0;
+		if(radiopool_start(radioWorker) == 0)
+			exit(-1);
+		superviseRadios();
+	}
+
+	strncpy(dial_tty, devtag_get(av[i]), sizeof(dial_tty) - 1);
+	signal(SIGINT, sigINT_handler);
+	signal(SIGTERM, sigINT_handler);
+	j = daemonMode ? 0 : joinArguments(i + 1, ac, av, command_buffer);
+	unescapeCommand(command_buffer, j);
+	runRadio(j);
+	return 0;
 }
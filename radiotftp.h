@@ -28,20 +28,48 @@
 #define REMOTE_FILENAME "sensors.dat"
 #define APPEND 1
 #define HELLO_WORLD_PORT 12345
+#define TDMA_BEACON_PORT 12346
+#define FRAG_NACK_PORT 12347
+#define STATS_QUERY_PORT 12348
+#define TDMA_ENABLED 0
+#define RADIOTFTP_RADIO_BAUD 2400
 #define END_OF_FILE 28 //do not change
 #define AX25_ENABLED 1
 #define ETHERNET_ENABLED 0
 #define MY_AX25_CALLSIGN "SA0BXI\x0f"
 #define MY_ETHERNET_ADDRESS	{0xf0, 0x0, 0x0, 0x0, 0x0, 0x1}
 #define MY_IP_ADDRESS { 0xa1, 0xa2, 0xa3, 0xa4 }
+//nodes that cannot hear the gateway send everything through this relay
+//#define ROUTE_DEFAULT_VIA "SA0BXJ\x0f"
+
+#define RADIOTFTP_PREAMBLE_LENGTH 10
+#define RADIOTFTP_SYNC_LENGTH 4
+#if ETHERNET_ENABLED==1
+#define RADIOTFTP_LINK_FRAME_LENGTH (ETH_MAX_PAYLOAD_LENGTH+ETH_TOTAL_HEADERS_LENGTH)
+#define RADIOTFTP_LINK_PAYLOAD_OFFSET ETH_PAYLOAD_OFFSET
+#elif AX25_ENABLED==1
+#define RADIOTFTP_LINK_FRAME_LENGTH (AX25_MAX_PAYLOAD_LENGTH+AX25_TOTAL_HEADERS_LENGTH)
+#define RADIOTFTP_LINK_PAYLOAD_OFFSET AX25_PAYLOAD_OFFSET
+#else
+#define RADIOTFTP_LINK_FRAME_LENGTH (UDP_MAX_PAYLOAD_LENGTH+UDP_TOTAL_HEADERS_LENGTH)
+#define RADIOTFTP_LINK_PAYLOAD_OFFSET 0
+#endif
+//preamble, sync word, the encoded link frame, eof and a trailing zero
+#define RADIOTFTP_FRAME_BUFFER_LENGTH (RADIOTFTP_LINK_FRAME_LENGTH*2+RADIOTFTP_PREAMBLE_LENGTH+RADIOTFTP_SYNC_LENGTH+2)
 
 void radiotftpAlarm_callback(void* data);
+void radiotftpMac_callback(void);
+void radiotftpBeacon_callback(void);
+void radiotftpFrag_callback(void);
 int uart0_rx(unsigned char receivedByte);
 int uart1_rx(unsigned char receivedByte);
 uint8_t setRTS(uint8_t level);
 void radiotftp_setNumBytesToSend(uint16_t numBytes);
 uint16_t radiotftp_getNumBytesToSend();
+uint32_t radiotftp_getAirtimeBudget(void);
 uint8_t queueSerialData(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t dst_port, uint8_t* dataptr, uint16_t datalen);
+uint8_t requeueSerialData(uint16_t src_port, uint16_t block);
+uint8_t* stageSerialData(uint16_t src_port, uint16_t dst_port, uint16_t opcode);
 uint16_t transmitSerialData(void);
 uint8_t udp_packet_demultiplexer(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t dst_port, uint8_t* payload, uint16_t len);
 PROCESS_NAME(radiotftp_process);
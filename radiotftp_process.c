@@ -20,34 +20,50 @@
 #include "util.h"
 #include "avr_util.h"
 #include "printAsciiHex.h"
+#include "txqueue.h"
+#include "radiomac.h"
+#include "tdma.h"
+#include "airtime.h"
+#include "route.h"
+#include "neighbour.h"
+#include "trickle.h"
+#include "dupcache.h"
+#include "frag.h"
+#include "rxframe.h"
+#include "bufpool.h"
+#include "linkstats.h"
+#include "trace.h"
+#include "dlog.h"
 
 const uint8_t my_ip_address[4] = MY_IP_ADDRESS;
 
-#define PREAMBLE_LENGTH 10
+#define PREAMBLE_LENGTH RADIOTFTP_PREAMBLE_LENGTH
 unsigned char preamble[PREAMBLE_LENGTH] =
 { 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55 };
 
-#define SYNC_LENGTH 4
+#define SYNC_LENGTH RADIOTFTP_SYNC_LENGTH
 unsigned char syncword[SYNC_LENGTH] =
 { 0xAA, 0x55, 0xAA, 0x55 };
 
 #if ETHERNET_ENABLED==1
 const uint8_t my_eth_address[6] = MY_ETHERNET_ADDRESS;
-static uint8_t ethernet_buffer[ETH_MAX_PAYLOAD_LENGTH + ETH_TOTAL_HEADERS_LENGTH];
-static uint8_t manchester_buffer[sizeof(ethernet_buffer) * 2];
 #elif AX25_ENABLED==1
 const uint8_t my_ax25_callsign[7] = MY_AX25_CALLSIGN;
-static uint8_t ax25_buffer[AX25_MAX_PAYLOAD_LENGTH+AX25_TOTAL_HEADERS_LENGTH];
-static uint8_t manchester_buffer[sizeof(ax25_buffer)*2];
-#else
-uint8_t manchester_buffer[(UDP_MAX_PAYLOAD_LENGTH + UDP_TOTAL_HEADERS_LENGTH) * 2];
 #endif
-static uint8_t udp_buffer[UDP_MAX_PAYLOAD_LENGTH+20];
+#define LINK_FRAME_LENGTH RADIOTFTP_LINK_FRAME_LENGTH
 
-static uint8_t transmit_buffer[sizeof(manchester_buffer)+PREAMBLE_LENGTH+SYNC_LENGTH+2];
-static uint16_t transmit_length = 0;
+/*
+ * outgoing link frames are built in the last LINK_FRAME_LENGTH bytes of their slot's
+ * block and encoded towards its head, the encoder stays ahead of what it reads
+ */
+#define STAGING_OFFSET (BUFPOOL_BLOCK_SIZE-LINK_FRAME_LENGTH)
 
-static uint8_t io[sizeof(manchester_buffer)+PREAMBLE_LENGTH+SYNC_LENGTH+2];
+//the isr fills rx_block through io while io_flag is clear, the main loop owns it while it is set
+static int8_t rx_block = BUFPOOL_NO_BLOCK;
+static uint8_t* volatile io = NULL;
+//the block being parsed, the isr may already be filling another one
+static int8_t rx_frame_block = BUFPOOL_NO_BLOCK;
+static uint8_t* rx_frame;
 static uint16_t io_index = 0;
 static uint16_t saved_io_index = 0;
 static uint8_t sync_counter = 0;
@@ -56,16 +72,52 @@ static uint8_t sync_passed = 0;
 volatile uint8_t io_flag = 0;
 volatile uint8_t alarm_flag = 0;
 volatile uint8_t timer_flag = 0;
-volatile uint8_t queue_flag = 0;
+volatile uint8_t beacon_flag = 0;
+volatile uint8_t frag_flag = 0;
+#if TRACE_ENABLED
+volatile uint8_t trace_flag = 0;
+#endif
 volatile uint16_t numBytesToSend = 0;
 
 static uint8_t udp_src[4], udp_dst[4];
 static uint16_t udp_src_prt, udp_dst_prt;
 
+//the last message tftp may retransmit, its frames stay encoded in the transmit queue
+#define RETRANSMIT_TAG(port, block) ((((uint32_t)(port))<<16) | (block))
+static struct
+{
+	uint32_t tag;
+	uint16_t identification;
+	uint8_t parts;
+} kept;
+static uint16_t next_identification = 0;
+//the slot a tftp payload is built in until queueSerialData encodes it into slots of its own
+static int8_t stage_slot = TXQUEUE_NO_SLOT;
+
+//headers of the last endpoints sent to, in practice those of the running tftp session
+static udp_template_t session_udp;
+#if AX25_ENABLED==1
+static ax25_template_t session_ax25;
+#endif
+
+#if AX25_ENABLED==1
+static uint8_t link_src[AX25_SOURCE_LENGTH];
+static uint16_t rx_frame_length;
+static rxframe_t rx;
+#endif
+
 #if PREAMBLE_LENGTH > 15
 #error preamble length cant be longer than 15
 #endif
 
+#if BUFPOOL_BLOCK_SIZE < RADIOTFTP_FRAME_BUFFER_LENGTH
+#error a bufpool block must hold a whole encoded frame
+#endif
+
+#if BUFPOOL_BLOCK_SIZE < UDP_MAX_DATAGRAM_LENGTH
+#error a bufpool block must hold a whole tftp payload while it is staged
+#endif
+
 #if AX25_ENABLED==1 && ETHERNET_ENABLED==1
 #error Both AX25 and Ethernet cannot be enabled
 #endif
@@ -79,44 +131,86 @@ void radiotftpAlarm_callback(void* data)
 	process_post(&radiotftp_process, PROCESS_EVENT_TIMER, NULL);
 }
 
+void radiotftpMac_callback(void)
+{
+	process_poll(&radiotftp_process);
+}
+
+void radiotftpBeacon_callback(void)
+{
+	beacon_flag = 1;
+	process_poll(&radiotftp_process);
+}
+
+void radiotftpFrag_callback(void)
+{
+	frag_flag = 1;
+	process_poll(&radiotftp_process);
+}
+
 int uart0_rx(unsigned char receivedByte)
 {
 	//stdin
 	rs232_send(RS232_PORT_0, receivedByte);
+#if TRACE_ENABLED
+	if(receivedByte==TRACE_QUERY)
+	{
+		trace_flag = 1;
+		process_poll(&radiotftp_process);
+	}
+#endif
 	return 0;
 }
 int uart1_rx(unsigned char receivedByte)
 {
 	//radiometrix
 //	putchar(receivedByte);
+	radiomac_rx_byte(receivedByte);
 	if(sync_passed)
 	{
 		if(receivedByte==END_OF_FILE || !isManchester_encoded(receivedByte) )
 		{
-			putchar('\n');
+			DLOG1(DLOG_RX_END, io_index);
+			if(receivedByte!=END_OF_FILE)
+			{
+				LINKSTATS_COUNT(phy, sync_aborts);
+				TRACE(TRACE_ABORT, io_index);
+			}
+			else
+			{
+				TRACE(TRACE_EOF, io_index);
+			}
 			sync_passed = 0;
 			saved_io_index = io_index;
 			io_flag=1;
 			if(process_post(&radiotftp_process, PROCESS_EVENT_COM, (void*) io)==PROCESS_ERR_FULL)
 			{
-				printf("incoming transmission discarded\n");
+				LINKSTATS_COUNT(net, queue_full);
+				DLOG0(DLOG_EVENT_QUEUE_FULL);
 			}
 		}
 		else
 		{
 			io[io_index] = receivedByte;
-			io_index = ((io_index+1)%sizeof(io));
+			io_index = ((io_index+1)%BUFPOOL_BLOCK_SIZE);
 		}
 	}
 	else
 	{
-		if(receivedByte==syncword[sync_counter])
+		//the last frame is still being parsed in place, this one is lost
+		if(io_flag)
+		{
+			sync_counter = 0;
+		}
+		else if(receivedByte==syncword[sync_counter])
 		{
 			//one more step closer to
 			sync_counter++;
 			//PRINTF_D("sync counting=%d\n", sync_counter);
 			if(sync_counter==SYNC_LENGTH)
 			{
+				LINKSTATS_COUNT(phy, sync_hits);
+				TRACE(TRACE_SYNC, 0);
 				io_index=0;
 				sync_passed = 1;
 				sync_counter = 0;
@@ -152,78 +246,264 @@ uint16_t radiotftp_getNumBytesToSend()
 	return numBytesToSend;
 }
 
-uint8_t queueSerialData(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t dst_port, uint8_t* dataptr, uint16_t datalen)
+uint32_t radiotftp_getAirtimeBudget(void)
 {
-	uint16_t idx = 0, len = 0;
+	return airtime_remaining_budget_ms(TXQUEUE_CLASS_BULK);
+}
 
-	wdt_reset();
-	if(queue_flag)
-	{
-		return -1;
-	}
+/*
+ * where the ip packet of a frame is built inside its slot
+ */
+static uint8_t* stagePacket(int8_t slot)
+{
+	return txqueue_get_buffer(slot)+STAGING_OFFSET+RADIOTFTP_LINK_PAYLOAD_OFFSET;
+}
 
-	memcpy(transmit_buffer, preamble, PREAMBLE_LENGTH);
+/*
+ * wraps the ip packet staged in slot into a link frame and queues it
+ * the frame is encoded in place in the slot it will be sent from and
+ * stays there after it is sent if it is part of a tagged message
+ * upstream broadcasts follow the default route, other broadcasts stay broadcasts
+ */
+static int8_t queuePacket(int8_t slot, uint8_t* dst, uint16_t len, uint8_t upstream)
+{
+	uint16_t idx = 0;
+	uint8_t* frame;
+	uint8_t* staged;
+#if AX25_ENABLED==1
+	uint8_t* next_hop;
+#endif
+
+	frame = txqueue_get_buffer(slot);
+	staged = frame+STAGING_OFFSET;
+
+	memcpy(frame, preamble, PREAMBLE_LENGTH);
 	idx += PREAMBLE_LENGTH;
 
-	memcpy(transmit_buffer+idx, syncword, SYNC_LENGTH);
+	memcpy(frame+idx, syncword, SYNC_LENGTH);
 	idx += SYNC_LENGTH;
 
-	//PRINTF_D("udp payload: %s\n", dataptr);
-	len = udp_create_packet(src, src_port, dst, dst_port, dataptr, datalen, udp_buffer);
-	if(len==0)
-	{
-		PRINTF_D("couldn't prepare udp packet\n");
-		return -2;
-	}
-
 #if ETHERNET_ENABLED==1
-	//PRINTF_D("eth payload: %s\n", udp_buffer);
-	len = eth_create_packet(eth_get_local_address(NULL), eth_get_broadcast_address(NULL), udp_buffer, len, ethernet_buffer);
+	len = eth_create_packet(eth_get_local_address(NULL), eth_get_broadcast_address(NULL), staged+ETH_PAYLOAD_OFFSET, len, staged);
 	if(len==0)
 	{
-		PRINTF_D("couldn't prepare eth packet\n");
+		DLOG0(DLOG_LINK_BUILD_FAILED);
+		txqueue_cancel(slot);
 		return -3;
 	}
-	len = manchester_encode(ethernet_buffer, manchester_buffer, len);
 #elif AX25_ENABLED==1
-	//PRINTF_D("ax25 payload: %s\n", udp_buffer);
-	len = ax25_create_ui_packet(ax25_get_local_callsign(NULL), ax25_get_broadcast_callsign(NULL), udp_buffer, len, ax25_buffer);
+	//unicast to the relay when the destination is behind one, only the default route matches broadcast
+	next_hop = (upstream || memcmp(dst, udp_get_broadcast_ip(NULL), IPV4_DESTINATION_LENGTH)) ? route_lookup(dst) : NULL;
+	if(next_hop==NULL)
+		next_hop = ax25_get_broadcast_callsign(NULL);
+	if(!ax25_template_matches(&session_ax25, ax25_get_local_callsign(NULL), next_hop))
+		ax25_create_template(ax25_get_local_callsign(NULL), next_hop, &session_ax25);
+	len = ax25_create_ui_packet_from_template(&session_ax25, staged+AX25_PAYLOAD_OFFSET, len, staged);
 	if(len==0)
 	{
-		PRINTF_D("couldn't prepare ax25 packet\n");
+		DLOG0(DLOG_LINK_BUILD_FAILED);
+		txqueue_cancel(slot);
 		return -3;
 	}
-	len = manchester_encode(ax25_buffer, manchester_buffer, len);
-#else
-	len = manchester_encode(udp_buffer, manchester_buffer, len);
 #endif
+	idx += manchester_encode(staged, frame+idx, len);
+
+	frame[idx++] = END_OF_FILE;
+	frame[idx++] = 0;
+
+	txqueue_commit(slot, idx);
+	return 0;
+}
 
-	memcpy(&transmit_buffer[idx], manchester_buffer, len);
-	idx += len;
+/*
+ * tags the datagrams tftp retransmits on its own timer, requests and data blocks
+ * of the running transfer, everything else is forgotten once it is sent
+ */
+static uint32_t retransmitTag(uint16_t src_port, uint8_t* payload, uint16_t len)
+{
+	uint16_t opcode;
 
-	transmit_buffer[idx++] = END_OF_FILE;
-	transmit_buffer[idx++] = 0;
+	if(src_port!=tftp_transfer_src_port() || len<2)
+		return TXQUEUE_NO_TAG;
+	opcode = (payload[0]<<8) | payload[1];
+	if(opcode==TFTP_OPCODE_DATA && len>=4)
+		return RETRANSMIT_TAG(src_port, (payload[2]<<8) | payload[3]);
+	if(opcode==TFTP_OPCODE_WRQ || opcode==TFTP_OPCODE_RRQ)
+		return RETRANSMIT_TAG(src_port, 0);
+	return TXQUEUE_NO_TAG;
+}
 
-	queue_flag = 1;
-	transmit_length = idx;
+static uint8_t queueDatagram(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t dst_port, uint8_t* dataptr, uint16_t datalen)
+{
+	uint16_t len = 0;
+	uint32_t tag;
+	uint8_t class, parts, i, upstream;
+	int8_t result, slot;
+
+	wdt_reset();
+	class = txqueue_classify(src_port, dst_port, dataptr, datalen);
+	//tftp requests go to whoever answers, through the relay if the gateway is out of reach
+	upstream = (src_port==tftp_transfer_src_port());
+
+	tag = retransmitTag(src_port, dataptr, datalen);
+
+	if(datalen>UDP_MAX_PAYLOAD_LENGTH)
+	{
+		if(datalen>UDP_MAX_DATAGRAM_LENGTH)
+		{
+			DLOG0(DLOG_UDP_BUILD_FAILED);
+			return -2;
+		}
+		//every fragment is encoded right away, dataptr is not needed after we return
+		parts = (datalen+8+UDP_FRAGMENT_LENGTH-1)/UDP_FRAGMENT_LENGTH;
+		if(txqueue_room(class)<parts)
+		{
+			LINKSTATS_COUNT(net, queue_full);
+			DLOG1(DLOG_NO_ROOM, parts);
+			return -1;
+		}
+		if(++next_identification==0)
+			next_identification = 1;
+		for(i = 0; i<parts; i++)
+		{
+			slot = txqueue_reserve(class);
+			if(slot==TXQUEUE_NO_SLOT)
+			{
+				LINKSTATS_COUNT(net, queue_full);
+				DLOG1(DLOG_FRAGMENT_FAILED, i);
+				return -1;
+			}
+			txqueue_tag(slot, tag, i);
+			len = udp_create_fragment(src, src_port, dst, dst_port, dataptr, datalen, next_identification, i*UDP_FRAGMENT_LENGTH, stagePacket(slot));
+			if(len==0)
+			{
+				txqueue_cancel(slot);
+				result = -2;
+			}
+			else
+			{
+				result = queuePacket(slot, dst, len, upstream);
+			}
+			if(result)
+			{
+				DLOG1(DLOG_FRAGMENT_FAILED, i);
+				return result;
+			}
+		}
+	}
+	else
+	{
+		//PRINTF_D("udp payload: %s\n", dataptr);
+		slot = txqueue_reserve(class);
+		if(slot==TXQUEUE_NO_SLOT)
+		{
+			LINKSTATS_COUNT(net, queue_full);
+			return -1;
+		}
+		txqueue_tag(slot, tag, 0);
+		if(!udp_template_matches(&session_udp, src, src_port, dst, dst_port))
+			udp_create_template(src, src_port, dst, dst_port, &session_udp);
+		len = udp_create_packet_from_template(&session_udp, dataptr, datalen, stagePacket(slot));
+		if(len==0)
+		{
+			DLOG0(DLOG_UDP_BUILD_FAILED);
+			txqueue_cancel(slot);
+			return -2;
+		}
+		parts = 1;
+		result = queuePacket(slot, dst, len, upstream);
+		if(result)
+		{
+			return result;
+		}
+	}
+	if(tag!=TXQUEUE_NO_TAG)
+	{
+		kept.tag = tag;
+		kept.parts = parts;
+		kept.identification = (parts>1) ? next_identification : 0;
+	}
 
 	//print_time("data queued");
 	wdt_reset();
 
 	if(process_post(&radiotftp_process, PROCESS_EVENT_COM, (void*) io)==PROCESS_ERR_FULL)
 	{
-		printf("incoming transmission discarded\n");
+		DLOG0(DLOG_EVENT_QUEUE_FULL);
 	}
 	
+	return result;
+}
+
+uint8_t queueSerialData(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t dst_port, uint8_t* dataptr, uint16_t datalen)
+{
+	uint8_t result;
+
+	TRACE(TRACE_QUEUE_ENTER, datalen);
+	result = queueDatagram(src, src_port, dst, dst_port, dataptr, datalen);
+	//a staged payload has been encoded into its own slots or given up by now
+	if(stage_slot!=TXQUEUE_NO_SLOT)
+	{
+		txqueue_cancel(stage_slot);
+		stage_slot = TXQUEUE_NO_SLOT;
+	}
+	TRACE(TRACE_QUEUE_EXIT, result);
+	return result;
+}
+
+uint8_t* stageSerialData(uint16_t src_port, uint16_t dst_port, uint16_t opcode)
+{
+	uint8_t header[2];
+
+	//the payload gets a transmit slot of its class for itself, no stack copy of it is needed
+	if(stage_slot==TXQUEUE_NO_SLOT)
+	{
+		header[0] = (opcode>>8)&0xFF;
+		header[1] = opcode&0xFF;
+		stage_slot = txqueue_reserve(txqueue_classify(src_port, dst_port, header, sizeof(header)));
+		if(stage_slot==TXQUEUE_NO_SLOT)
+		{
+			LINKSTATS_COUNT(net, queue_full);
+			return NULL;
+		}
+	}
+	return txqueue_get_buffer(stage_slot);
+}
+
+uint8_t requeueSerialData(uint16_t src_port, uint16_t block)
+{
+	//the frames on air last time are still encoded, unless something needed their slots
+	if(kept.tag!=RETRANSMIT_TAG(src_port, block) || !txqueue_requeue(kept.tag, (1<<kept.parts)-1))
+	{
+		return 1;
+	}
+	if(process_post(&radiotftp_process, PROCESS_EVENT_COM, (void*) io)==PROCESS_ERR_FULL)
+	{
+		DLOG0(DLOG_EVENT_QUEUE_FULL);
+	}
 	return 0;
 }
 
 uint16_t transmitSerialData(void)
 {
 	uint16_t i = 0;
+	uint16_t transmit_length;
+	uint8_t* frame;
+	int8_t slot;
+	uint8_t class;
+
+	slot = txqueue_peek();
+	if(slot==TXQUEUE_NO_SLOT)
+	{
+		return 0;
+	}
+	frame = txqueue_get_buffer(slot);
+	transmit_length = txqueue_get_length(slot);
+	class = txqueue_get_class(slot);
 
 	wdt_reset();
 	setRTS(0);
+	TRACE(TRACE_RTS_ASSERT, transmit_length);
 	_delay_ms(2e1);
 
 	ATOMIC_BEGIN();
@@ -232,22 +512,163 @@ uint16_t transmitSerialData(void)
 		//NOTE: rs232_send has caused problems before
 		//while (!READ_BIT(UCSR1A, UDRE1));
 		//UDR1 = transmit_buffer[i];
-		rs232_send(RS232_PORT_1, transmit_buffer[i]);
-		//rs232_send(RS232_PORT_0, transmit_buffer[i]);
+		rs232_send(RS232_PORT_1, frame[i]);
+		//rs232_send(RS232_PORT_0, frame[i]);
 	}
 	while (!READ_BIT(UCSR1A, UDRE1));
 	ATOMIC_END();
 
 	_delay_ms(2e1);
 	setRTS(1);
+	TRACE(TRACE_RTS_RELEASE, transmit_length);
 	wdt_reset();
 
+	txqueue_release(slot);
+	airtime_commit(class, airtime_frame_ms(transmit_length));
+	LINKSTATS_COUNT(phy, frames_tx);
+	LINKSTATS_ADD(phy, bytes_tx, transmit_length);
+
 
 	//print_time("data sent");
 
 	return 0;
 }
 
+#if AX25_ENABLED==1
+/*
+ * a broadcast handed to us at the link layer comes from a node that cannot hear
+ * the gateway and sends upstream through us
+ */
+static uint8_t isUpstreamBroadcast(uint8_t* dst)
+{
+	return !memcmp(dst, udp_get_broadcast_ip(NULL), IPV4_DESTINATION_LENGTH)
+			&& !memcmp(rx_frame+AX25_DESTINATION_OFFSET, ax25_get_local_callsign(NULL), AX25_DESTINATION_LENGTH);
+}
+
+/*
+ * relays the frame that was just decoded in place in rx_frame[]
+ * the addresses, ttl, header checksum and fcs are patched where they are and, if the
+ * isr has moved on to another block, the block itself is handed over to the transmit
+ * queue and encoded in place, nothing is parsed, built or copied to another buffer
+ */
+static uint8_t forwardFrame(uint8_t class, uint8_t* dst)
+{
+	uint8_t* next_hop;
+	uint8_t* out;
+	uint8_t* in;
+	uint16_t idx = 0, ip_offset;
+	int8_t slot;
+
+	//only relay frames that were handed to us at the link layer
+	if(memcmp(rx_frame+AX25_DESTINATION_OFFSET, ax25_get_local_callsign(NULL), AX25_DESTINATION_LENGTH))
+		return 0;
+	next_hop = route_lookup(dst);
+	//without a default route of our own the gateway is in reach
+	if(next_hop==NULL && !memcmp(dst, udp_get_broadcast_ip(NULL), IPV4_DESTINATION_LENGTH))
+		next_hop = ax25_get_broadcast_callsign(NULL);
+	if(next_hop==NULL || !memcmp(next_hop, link_src, AX25_SOURCE_LENGTH))
+	{
+		route_get_stats()->no_route++;
+		return 0;
+	}
+	ip_offset = AX25_PAYLOAD_OFFSET;
+	if(!udp_decrement_ttl(rx_frame+ip_offset))
+	{
+		route_get_stats()->ttl_expired++;
+		return 0;
+	}
+	ax25_readdress_ui_packet(ax25_get_local_callsign(NULL), next_hop, rx_frame, rx_frame_length);
+
+	if(rx_frame_block!=rx_block)
+	{
+		slot = txqueue_reserve_block(class, rx_frame_block);
+		if(slot==TXQUEUE_NO_SLOT)
+		{
+			LINKSTATS_COUNT(net, queue_full);
+			return 0;
+		}
+		//the block is the transmit queue's now, move the frame out of the encoder's way
+		rx_frame_block = BUFPOOL_NO_BLOCK;
+		out = txqueue_get_buffer(slot);
+		in = out+BUFPOOL_BLOCK_SIZE-rx_frame_length;
+		memmove(in, out, rx_frame_length);
+	}
+	else
+	{
+		//the isr is waiting for this very block, the frame has to be encoded into a new one
+		slot = txqueue_reserve(class);
+		if(slot==TXQUEUE_NO_SLOT)
+		{
+			LINKSTATS_COUNT(net, queue_full);
+			return 0;
+		}
+		out = txqueue_get_buffer(slot);
+		in = rx_frame;
+	}
+
+	memcpy(out, preamble, PREAMBLE_LENGTH);
+	idx += PREAMBLE_LENGTH;
+	memcpy(out+idx, syncword, SYNC_LENGTH);
+	idx += SYNC_LENGTH;
+
+	idx += manchester_encode(in, out+idx, rx_frame_length);
+
+	out[idx++] = END_OF_FILE;
+	out[idx++] = 0;
+
+	txqueue_commit(slot, idx);
+	route_get_stats()->forwarded++;
+	process_poll(&radiotftp_process);
+	return 1;
+}
+#endif
+
+#if AX25_ENABLED==1
+static void countFrameErrors(uint8_t errors)
+{
+	if(errors & RXFRAME_ERROR_SYMBOL)
+		LINKSTATS_COUNT(phy, invalid_symbols);
+	if(errors & (RXFRAME_ERROR_LENGTH|RXFRAME_ERROR_UDP_LENGTH))
+		LINKSTATS_COUNT(link, length_mismatches);
+	if(errors & RXFRAME_ERROR_FCS)
+		LINKSTATS_COUNT(link, crc_failures);
+	if(errors & RXFRAME_ERROR_IP_HEADER)
+		LINKSTATS_COUNT(net, header_errors);
+	if(errors & RXFRAME_ERROR_UDP_CHECKSUM)
+		LINKSTATS_COUNT(net, checksum_failures);
+}
+#endif
+
+/*
+ * relays pass fragments on one by one, only the destination puts them back together
+ * returns the whole packet once its last fragment is in, NULL until then
+ */
+static uint8_t* receiveFragment(uint8_t* packet)
+{
+	uint8_t nack[FRAG_NACK_LENGTH];
+	uint16_t length, nack_length;
+
+#if AX25_ENABLED==1
+	if(udp_check_destination(udp_get_localhost_ip(NULL), udp_dst, packet) || isUpstreamBroadcast(udp_dst))
+	{
+		forwardFrame(TXQUEUE_CLASS_BULK, udp_dst);
+		return NULL;
+	}
+#else
+	if(udp_check_destination(udp_get_localhost_ip(NULL), udp_dst, packet))
+	{
+		return NULL;
+	}
+#endif
+	memcpy(udp_src, packet+IPV4_SOURCE_OFFSET, IPV4_SOURCE_LENGTH);
+	packet = frag_reassemble(packet, &length, nack, &nack_length);
+	if(nack_length)
+	{
+		queueSerialData(udp_get_localhost_ip(NULL), FRAG_NACK_PORT, udp_src, FRAG_NACK_PORT, nack, nack_length);
+	}
+	return packet;
+}
+
 uint8_t udp_packet_demultiplexer(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t dst_port, uint8_t* payload, uint16_t len)
 {
 	//TODO put back the server functions to handle single block messages
@@ -256,8 +677,18 @@ uint8_t udp_packet_demultiplexer(uint8_t* src, uint16_t src_port, uint8_t* dst,
 //    PRINTF_D("== DST: %d.%d.%d.%d:%d ==\n", dst[0], dst[1], dst[2], dst[3], dst_port);
 
 	uint8_t different = 0;
+	uint8_t snapshot[LINKSTATS_SNAPSHOT_LENGTH];
+	uint16_t length;
 	wdt_reset();
 
+#if AX25_ENABLED==1
+	if(isUpstreamBroadcast(dst))
+	{
+		forwardFrame(txqueue_classify(src_port, dst_port, payload, len-8), dst);
+		return 0;
+	}
+#endif
+
 	//check for address match
 	different = memcmp(udp_get_localhost_ip(NULL), dst, IPV4_DESTINATION_LENGTH);
 	if(different)
@@ -281,31 +712,88 @@ uint8_t udp_packet_demultiplexer(uint8_t* src, uint16_t src_port, uint8_t* dst,
 		}
 		else if(dst_port==HELLO_WORLD_PORT)
 		{
-			PRINTF_D("New neighbour:\nIP = %d.%d.%d.%d\n", src[0], src[1], src[2], src[3]);
+#if AX25_ENABLED==1
+			if(!neighbour_beacon_received(link_src, src, payload, len-8))
+			{
+				trickle_consistent();
+			}
+			else
+#endif
+			{
+				PRINTF_D("New neighbour:\nIP = %d.%d.%d.%d\n", src[0], src[1], src[2], src[3]);
+				trickle_inconsistent();
+			}
 		}
+		else if(dst_port==STATS_QUERY_PORT)
+		{
+#if TRACE_ENABLED
+			if(len-8==1 && payload[0]==TRACE_QUERY)
+			{
+				uint8_t trace_reply[TRACE_SNAPSHOT_LENGTH];
+				length = trace_snapshot(trace_reply, sizeof(trace_reply));
+				queueSerialData(udp_get_localhost_ip(NULL), STATS_QUERY_PORT, src, src_port, trace_reply, length);
+				return 0;
+			}
+#endif
+			if(linkstats_is_query(payload, len-8))
+			{
+				length = linkstats_snapshot(snapshot, clock_seconds());
+				queueSerialData(udp_get_localhost_ip(NULL), STATS_QUERY_PORT, src, src_port, snapshot, length);
+			}
+		}
+		else if(dst_port==FRAG_NACK_PORT)
+		{
+			//resend only the fragments the other side is missing
+			if(len-8>=FRAG_NACK_LENGTH && kept.identification!=0
+					&& ((payload[FRAG_NACK_IDENTIFICATION_OFFSET]<<8)|payload[FRAG_NACK_IDENTIFICATION_OFFSET+1])==kept.identification)
+			{
+				if(txqueue_requeue(kept.tag, payload[FRAG_NACK_MISSING_OFFSET] & ((1<<kept.parts)-1)))
+					process_poll(&radiotftp_process);
+			}
+		}
+#if TDMA_ENABLED==1
+		else if(dst_port==TDMA_BEACON_PORT)
+		{
+			if(!tdma_beacon_received(payload, len-8, udp_get_localhost_ip(NULL)))
+			{
+				PRINTF_D("no tdma slot for us, using csma\n");
+			}
+		}
+#endif
 		else
 		{
-			PRINTF_D("packet received for unassigned port: %d\n", dst_port);
+			DLOG1(DLOG_UNASSIGNED_PORT, dst_port);
 		}
 	}
 	else
 	{
-		//nothing to do here yet
-		//may be for routing purposes...
-		PRINTF_D("packet for someone else: ");
-		print_addr_dec(dst);
+#if AX25_ENABLED==1
+		if(!forwardFrame(txqueue_classify(src_port, dst_port, payload, len-8), dst))
+#endif
+		{
+			DLOG2(DLOG_NOT_FOR_US, (dst[0]<<8)|dst[1], (dst[2]<<8)|dst[3]);
+		}
 
 	}
 	return 0;
 }
 PROCESS_THREAD(radiotftp_process, ev, data)
 {
-	uint16_t i, temp_io_index;
+	uint16_t i, temp_io_index, seed, airtime, length;
+	int8_t head, next_block;
+	uint8_t admit;
+	uint8_t* packet;
+	uint8_t* payload;
+	uint8_t beacon[NEIGHBOUR_BEACON_LENGTH];
+	uint8_t nack[FRAG_NACK_LENGTH];
+	uint8_t nack_dst[IPV4_SOURCE_LENGTH];
 	int16_t result = 0;
 	static struct etimer wait_timer;
 	PROCESS_BEGIN()
 		;
 		PRINTF_D("%s begin\n", PROCESS_CURRENT()->name);
+		//hot paths log through dlog, its process writes the records out whenever we are idle
+		dlog_initialize();
 
 		SET_BIT(DDRF, 0);
 		SET_BIT(MCUCR, PUD);
@@ -323,6 +811,11 @@ PROCESS_THREAD(radiotftp_process, ev, data)
 		SET_BIT(PORTE, 3);
 		SET_BIT(PORTE, 4);
 
+		//the isr needs a block to sync into before the radio uart is switched on
+		bufpool_initialize();
+		rx_block = bufpool_alloc(BUFPOOL_OWNER_RX);
+		io = bufpool_data(rx_block);
+
 		rs232_init(RS232_PORT_0, USART_BAUD_38400, USART_PARITY_NONE|USART_STOP_BITS_1|USART_DATA_BITS_8|USART_RECEIVER_ENABLE|USART_INTERRUPT_RX_COMPLETE);
 		rs232_set_input(RS232_PORT_0, uart0_rx);
 
@@ -358,7 +851,36 @@ PROCESS_THREAD(radiotftp_process, ev, data)
 		udp_initialize_ip_network(my_ip_address, &queueSerialData);
 		PRINTF_D("IPv4 Address = ");
 		print_addr_dec(udp_get_localhost_ip(NULL));
-		tftp_initialize(udp_get_data_queuer_fptr());
+		tftp_initialize(udp_get_data_queuer_fptr(), stageSerialData);
+		tftp_set_data_requeuer(requeueSerialData);
+
+		txqueue_initialize();
+		//nodes switched on together must not draw the same backoff slots
+		seed = 0;
+		for(i = 0; i<IPV4_SOURCE_LENGTH; i++)
+			seed = (seed<<4) ^ my_ip_address[i];
+#if AX25_ENABLED==1
+		for(i = 0; i<AX25_SOURCE_LENGTH; i++)
+			seed = (seed<<3) ^ my_ax25_callsign[i];
+#endif
+		radiomac_initialize(radiotftpMac_callback, seed);
+		airtime_initialize(RADIOTFTP_RADIO_BAUD, radiotftpMac_callback);
+		route_initialize();
+		neighbour_initialize();
+		trickle_initialize(radiotftpBeacon_callback);
+		dupcache_initialize();
+		frag_initialize(radiotftpFrag_callback);
+		linkstats_initialize();
+#if TRACE_ENABLED
+		trace_initialize();
+#endif
+#ifdef ROUTE_DEFAULT_VIA
+		route_add(udp_get_broadcast_ip(NULL), 0, (uint8_t*) ROUTE_DEFAULT_VIA);
+#endif
+#if TDMA_ENABLED==1
+		tdma_initialize(radiotftpMac_callback);
+		PRINTF_D("tdma slot length needed = %u ms\n", tdma_slot_length_ms(RADIOTFTP_RADIO_BAUD, RADIOTFTP_FRAME_BUFFER_LENGTH));
+#endif
 
 		//entering the main while loop
 		PRINTF_D("started listening...\n");
@@ -368,12 +890,12 @@ PROCESS_THREAD(radiotftp_process, ev, data)
 			 * radiotftp_setNumBytesToSend(500);
 			 * process_post_synch(&radiotftp_process, PROCESS_EVENT_CONTINUE, io);
 			 */
-			PRINTF_D("waiting for an event/flag\n");
 			PROCESS_WAIT_EVENT();
-			//PROCESS_WAIT_EVENT_UNTIL(timer_flag || queue_flag || io_flag || numBytesToSend);
+			DLOG1(DLOG_WAKEUP, ev);
+			//PROCESS_WAIT_EVENT_UNTIL(timer_flag || txqueue_pending() || io_flag || numBytesToSend);
 			if(numBytesToSend)
 			{
-				PRINTF_D("starting to send request, numBytes=%d\n", numBytesToSend);
+				DLOG1(DLOG_SEND_REQUEST, numBytesToSend);
 #if RADIOTFTP_ENABLE_ACKNOWLEDGMENTS
 				tftp_sendRequest(TFTP_OPCODE_WRQ, udp_get_broadcast_ip(NULL), (uint8_t*) data, numBytesToSend, REMOTE_FILENAME, strlen(REMOTE_FILENAME), APPEND);
 #else
@@ -383,68 +905,199 @@ PROCESS_THREAD(radiotftp_process, ev, data)
 			}
 			if(timer_flag)
 			{
-				PRINTF_D("timer_flag=1\n");
+				DLOG0(DLOG_TIMER);
 				tftp_timer_handler();
 				timer_flag = 0;
 			}
-			if(queue_flag)
+#if TRACE_ENABLED
+			if(trace_flag)
+			{
+				trace_flag = 0;
+				trace_dump();
+			}
+#endif
+			if(beacon_flag)
+			{
+				beacon_flag = 0;
+				i = neighbour_build_beacon(beacon);
+				queueSerialData(udp_get_localhost_ip(NULL), HELLO_WORLD_PORT, udp_get_broadcast_ip(NULL), HELLO_WORLD_PORT, beacon, i);
+			}
+			if(frag_flag)
 			{
-				if(!sync_passed&&sync_counter<1)
+				frag_flag = 0;
+				while(frag_poll(nack_dst, nack, &length))
+					queueSerialData(udp_get_localhost_ip(NULL), FRAG_NACK_PORT, nack_dst, FRAG_NACK_PORT, nack, length);
+			}
+			if(txqueue_pending())
+			{
+				result = RADIOMAC_WAIT;
+				head = txqueue_peek();
+				airtime = airtime_frame_ms(txqueue_get_length(head));
+				//the duty cycle budget is checked first, no point winning the channel without it
+				admit = airtime_admit(txqueue_get_class(head), airtime);
+				if(admit==AIRTIME_DROP)
+				{
+					DLOG1(DLOG_CLASS_DISABLED, txqueue_get_class(head));
+					txqueue_drop(head);
+					result = RADIOMAC_DROP;
+				}
+				else if(admit==AIRTIME_ADMIT)
+				{
+#if TDMA_ENABLED==1
+					//inside a tdma superframe only our own slots count, no carrier sense needed
+					if(tdma_synchronized())
+					{
+						if(tdma_clear_to_send(airtime)==TDMA_TRANSMIT)
+							result = RADIOMAC_TRANSMIT;
+					}
+					else
+#endif
+					result = radiomac_clear_to_send(sync_passed || sync_counter>0);
+				}
+				if(result==RADIOMAC_TRANSMIT)
 				{
-					//usleep(600000ul);
-					/*
-					 etimer_set(&wait_timer, CLOCK_SECOND * 3 / 5);
-					 do
-					 {
-					 PROCESS_YIELD();
-					 } while(ev != PROCESS_EVENT_TIMER);
-					 */
 					transmitSerialData();
-					queue_flag = 0;
+				}
+				else if(result==RADIOMAC_DROP && admit!=AIRTIME_DROP)
+				{
+					DLOG1(DLOG_CHANNEL_BUSY, txqueue_get_class(head));
+					LINKSTATS_COUNT(phy, busy_drops);
+					txqueue_drop(head);
+				}
+				//every frame goes through its own backoff
+				if(result!=RADIOMAC_WAIT && txqueue_pending())
+				{
+					process_poll(&radiotftp_process);
 				}
 			}
 			if(io_flag)
 			{
 				//PRINTF_D("# of bytes read = %d\n", saved_io_index);
 				ATOMIC_SET(temp_io_index, saved_io_index);
-				result = manchester_decode(io, manchester_buffer, temp_io_index);
+				LINKSTATS_COUNT(phy, frames_rx);
+				LINKSTATS_ADD(phy, bytes_rx, temp_io_index);
+				rx_frame_block = rx_block;
+				rx_frame = io;
+				//give the isr a fresh block so the next frame can come in while this one is parsed
+				next_block = bufpool_alloc(BUFPOOL_OWNER_RX);
+				if(next_block!=BUFPOOL_NO_BLOCK)
+				{
+					rx_block = next_block;
+					io = bufpool_data(next_block);
+					ATOMIC_SET(io_flag, 0);
+				}
+#if AX25_ENABLED==1
+				//one pass decodes rx_frame[] in place and checks symbols, fcs and udp checksum together
+				rxframe_decode(rx_frame, temp_io_index, &rx);
+				rx_frame_length = temp_io_index>>1;
+				packet = rx.packet;
+				result = !(rx.errors & (RXFRAME_ERROR_SYMBOL|RXFRAME_ERROR_LENGTH|RXFRAME_ERROR_FCS));
+				countFrameErrors(rx.errors);
+				TRACE(TRACE_RX_PARSE, rx.errors);
+				if(result)
+				{
+					memcpy(link_src, rx_frame+AX25_SOURCE_OFFSET, AX25_SOURCE_LENGTH);
+					neighbour_frame_received(link_src);
+				}
+#else
+				//decoded in place, every parser below only hands out pointers into rx_frame[]
+				result = manchester_decode(rx_frame, rx_frame, temp_io_index);
 #if ETHERNET_ENABLED==1
-				result = eth_open_packet(NULL, NULL, ethernet_buffer, manchester_buffer, result);
-#elif AX25_ENABLED==1
-				result = ax25_open_ui_packet(NULL, NULL, ax25_buffer, manchester_buffer, result);
+				result = eth_open_packet(NULL, NULL, NULL, rx_frame, result);
+				packet = rx_frame+ETH_PAYLOAD_OFFSET;
 #else
+				packet = rx_frame;
 				result = 1;
+#endif
 #endif
 				if(result)
 				{
 					//PRINTF_D("%s\n",buf);
-#if ETHERNET_ENABLED==1
-					result = udp_open_packet(udp_src, &udp_src_prt, udp_dst, &udp_dst_prt, udp_buffer, ethernet_buffer);
-#elif AX25_ENABLED==1
-					result = udp_open_packet(udp_src, &udp_src_prt, udp_dst, &udp_dst_prt, udp_buffer, ax25_buffer);
-#else
-					result = udp_open_packet(udp_src, &udp_src_prt, udp_dst, &udp_dst_prt, udp_buffer, manchester_buffer);
+					if(udp_is_fragment(packet))
+					{
+						packet = receiveFragment(packet);
+					}
+#if AX25_ENABLED==1
+					//the kernel has checked everything already unless this is a reassembled datagram
+					if(packet!=NULL && packet==rx.packet)
+					{
+						payload = rx.errors ? NULL : rx.payload;
+						memcpy(udp_src, packet+IPV4_SOURCE_OFFSET, IPV4_SOURCE_LENGTH);
+						memcpy(udp_dst, packet+IPV4_DESTINATION_OFFSET, IPV4_DESTINATION_LENGTH);
+						udp_src_prt = rx.src_port;
+						udp_dst_prt = rx.dst_port;
+						length = rx.udp_length;
+					}
+					else
 #endif
-					if(result)
+					payload = (packet!=NULL) ? udp_open_packet_view(udp_src, &udp_src_prt, udp_dst, &udp_dst_prt, packet, &length) : NULL;
+					if(payload!=NULL)
 					{
 						//PRINTF_D("%s\n",buf);
-						udp_packet_demultiplexer(udp_src, udp_src_prt, udp_dst, udp_dst_prt, udp_buffer, result);
+#if AX25_ENABLED==1
+						//whoever we heard it from can take frames back to its source
+						if(memcmp(udp_src, udp_get_localhost_ip(NULL), IPV4_SOURCE_LENGTH) && packet[IPV4_TIME_TO_LIVE_OFFSET]<=IPV4_TTL_LIMIT)
+						{
+							route_learn(udp_src, link_src, IPV4_TTL_LIMIT-packet[IPV4_TIME_TO_LIVE_OFFSET]);
+						}
+#endif
+						//frames for us that we have already seen stop here, relayed ones are left to the next hop
+						if(!udp_check_destination(udp_get_localhost_ip(NULL), NULL, packet)
+#if AX25_ENABLED==1
+								&& !isUpstreamBroadcast(udp_dst)
+#endif
+								&& dupcache_check(packet))
+						{
+							if(udp_dst_prt==tftp_transfer_src_port())
+							{
+								tftp_duplicate(udp_src, udp_src_prt, udp_dst, udp_dst_prt, payload, length-8);
+							}
+							DLOG2(DLOG_DUPLICATE, udp_src_prt, udp_dst_prt);
+						}
+						else
+						{
+							udp_packet_demultiplexer(udp_src, udp_src_prt, udp_dst, udp_dst_prt, payload, length);
+						}
 					}
-					else
+					else if(packet!=NULL)
 					{
-						PRINTF_D("!udp discarded!\n");
+#if AX25_ENABLED==1
+						if(packet!=rx.packet)
+							LINKSTATS_COUNT(net, checksum_failures);
+						DLOG1(DLOG_UDP_DISCARDED, rx.errors);
+#else
+						LINKSTATS_COUNT(net, checksum_failures);
+						DLOG1(DLOG_UDP_DISCARDED, 0);
+#endif
 					}
 				}
 				else
 				{
 #if ETHERNET_ENABLED==1
-					PRINTF_D("!eth discarded!\n");
+					LINKSTATS_COUNT(link, crc_failures);
+					DLOG1(DLOG_LINK_DISCARDED, 0);
 #elif AX25_ENABLED==1
-					PRINTF_D("!ax25_discarded!\n");
+					DLOG1(DLOG_LINK_DISCARDED, rx.errors);
+					if(rx.errors & RXFRAME_ERROR_FCS)
+					{
+						neighbour_crc_failed(rx_frame+AX25_SOURCE_OFFSET);
+					}
 #endif
 				}
+				TRACE(TRACE_RX_DONE, 0);
+				//a reassembled datagram has been handled by now
+				frag_release();
+				if(rx_frame_block==rx_block)
+				{
+					//parsed in the isr's own block, it can have it back
+					ATOMIC_SET(io_flag, 0);
+				}
+				else if(rx_frame_block!=BUFPOOL_NO_BLOCK)
+				{
+					bufpool_free(rx_frame_block);
+				}
+				rx_frame_block = BUFPOOL_NO_BLOCK;
 			}
-			ATOMIC_SET(io_flag, 0);
 		}
 
 	PROCESS_END();
@@ -0,0 +1,153 @@
+/*
+ * route.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "route.h"
+#include "avr_util.h"
+
+typedef struct
+{
+	uint8_t dst[4];
+	uint8_t prefix_length;
+	//relays on the way, ROUTE_STATIC for configured routes
+	uint8_t hops;
+	uint8_t next_hop[ROUTE_LINK_ADDRESS_LENGTH];
+	unsigned long last_heard;
+	uint8_t used;
+} route_entry_t;
+
+static RADIO_LOCAL route_entry_t routes[ROUTE_TABLE_SIZE];
+static RADIO_LOCAL route_stats_t stats;
+
+static uint8_t route_prefix_match(uint8_t* a, uint8_t* b, uint8_t prefix_length)
+{
+	uint8_t i, mask;
+
+	for(i = 0; prefix_length >= 8; i++, prefix_length -= 8)
+	{
+		if(a[i] != b[i])
+			return 0;
+	}
+	if(prefix_length == 0)
+		return 1;
+	mask = 0xFF << (8 - prefix_length);
+	return (a[i] & mask) == (b[i] & mask);
+}
+
+static uint8_t route_expired(route_entry_t* route, unsigned long now)
+{
+	return route->hops != ROUTE_STATIC && now - route->last_heard > ROUTE_LIFETIME_SECONDS;
+}
+
+/* a free entry, otherwise the learned route heard from the longest ago */
+static route_entry_t* route_find_victim(void)
+{
+	route_entry_t* victim = NULL;
+	uint8_t i;
+
+	for(i = 0; i < ROUTE_TABLE_SIZE; i++)
+	{
+		if(!routes[i].used)
+			return &routes[i];
+		if(routes[i].hops == ROUTE_STATIC)
+			continue;
+		if(victim == NULL || routes[i].last_heard < victim->last_heard)
+			victim = &routes[i];
+	}
+	return victim;
+}
+
+void route_initialize(void)
+{
+	memset(routes, 0, sizeof(routes));
+	memset(&stats, 0, sizeof(stats));
+}
+
+uint8_t route_add(uint8_t* dst_ip, uint8_t prefix_length, uint8_t* next_hop)
+{
+	route_entry_t* route;
+
+	route = route_find_victim();
+	if(route == NULL)
+		return 0;
+	memcpy(route->dst, dst_ip, 4);
+	route->prefix_length = (prefix_length > 32) ? 32 : prefix_length;
+	route->hops = ROUTE_STATIC;
+	memcpy(route->next_hop, next_hop, ROUTE_LINK_ADDRESS_LENGTH);
+	route->used = 1;
+	return 1;
+}
+
+void route_learn(uint8_t* src_ip, uint8_t* heard_from, uint8_t hops)
+{
+	route_entry_t* route = NULL;
+	unsigned long now = clock_seconds();
+	uint8_t i;
+
+	for(i = 0; i < ROUTE_TABLE_SIZE; i++)
+	{
+		if(routes[i].used && routes[i].hops != ROUTE_STATIC && routes[i].prefix_length == 32 && !memcmp(routes[i].dst, src_ip, 4))
+		{
+			route = &routes[i];
+			break;
+		}
+	}
+
+	if(route != NULL)
+	{
+		//keep the shorter path unless it went quiet
+		if(hops > route->hops && !route_expired(route, now) && memcmp(route->next_hop, heard_from, ROUTE_LINK_ADDRESS_LENGTH))
+			return;
+	}
+	else
+	{
+		route = route_find_victim();
+		if(route == NULL)
+			return;
+		memcpy(route->dst, src_ip, 4);
+		route->prefix_length = 32;
+		route->used = 1;
+		stats.learned++;
+	}
+	route->hops = hops;
+	memcpy(route->next_hop, heard_from, ROUTE_LINK_ADDRESS_LENGTH);
+	route->last_heard = now;
+}
+
+uint8_t* route_lookup(uint8_t* dst_ip)
+{
+	route_entry_t* best = NULL;
+	unsigned long now = clock_seconds();
+	uint8_t i;
+
+	for(i = 0; i < ROUTE_TABLE_SIZE; i++)
+	{
+		if(!routes[i].used)
+			continue;
+		if(route_expired(&routes[i], now))
+		{
+			routes[i].used = 0;
+			continue;
+		}
+		if(!route_prefix_match(routes[i].dst, dst_ip, routes[i].prefix_length))
+			continue;
+		if(best == NULL || routes[i].prefix_length > best->prefix_length
+				|| (routes[i].prefix_length == best->prefix_length && routes[i].hops < best->hops))
+			best = &routes[i];
+	}
+	return (best != NULL) ? best->next_hop : NULL;
+}
+
+route_stats_t* route_get_stats(void)
+{
+	return &stats;
+}
@@ -0,0 +1,72 @@
+/*
+ * File:   route.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef ROUTE_H
+#define	ROUTE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+/*! number of routes kept, learned routes are evicted oldest first */
+#ifndef ROUTE_TABLE_SIZE
+#define ROUTE_TABLE_SIZE 8
+#endif
+/*! a learned route is forgotten if nothing is heard over it for this long */
+#ifndef ROUTE_LIFETIME_SECONDS
+#define ROUTE_LIFETIME_SECONDS 600
+#endif
+/*! link layer addresses are stored as ax25 callsigns */
+#define ROUTE_LINK_ADDRESS_LENGTH 7
+
+#define ROUTE_STATIC	0xFF
+
+    typedef struct
+    {
+        uint16_t learned;
+        uint16_t forwarded;
+        uint16_t no_route;
+        uint16_t ttl_expired;
+    } route_stats_t;
+
+    /*!
+     * route_initialize()
+     * empties the table and clears the statistics
+     */
+    void route_initialize(void);
+
+    /*!
+     * route_add()
+     * installs a static route, destinations matching the first prefix_length bits of dst_ip
+     * are sent to next_hop, a zero prefix length makes it the default route
+     * returns zero if the table is full of static routes
+     */
+    uint8_t route_add(uint8_t* dst_ip, uint8_t prefix_length, uint8_t* next_hop);
+
+    /*!
+     * route_learn()
+     * reverse path learning, src_ip was heard through heard_from after hops relays
+     */
+    void route_learn(uint8_t* src_ip, uint8_t* heard_from, uint8_t hops);
+
+    /*!
+     * route_lookup()
+     * returns the next hop link address for dst_ip or NULL if there is no route
+     * the longest prefix wins, then the fewest hops
+     */
+    uint8_t* route_lookup(uint8_t* dst_ip);
+
+    route_stats_t* route_get_stats(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* ROUTE_H */
@@ -0,0 +1,105 @@
+/*
+ * rxframe.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "rxframe.h"
+#include "manchester.h"
+#include "ax25.h"
+#include "udp_ip.h"
+
+#define PACKET_OFFSET AX25_PAYLOAD_OFFSET
+/* pseudo header addresses and udp payload, in frame offsets */
+#define SUM_ADDRESS_START (PACKET_OFFSET+IPV4_SOURCE_OFFSET)
+#define SUM_ADDRESS_END (PACKET_OFFSET+IPV4_PAYLOAD_OFFSET)
+#define SUM_PAYLOAD_START (PACKET_OFFSET+UDP_PAYLOAD_OFFSET)
+
+#define MIN_FRAGMENT_LENGTH (PACKET_OFFSET+IPV4_PAYLOAD_OFFSET+AX25_FCS_LENGTH)
+#define MIN_DATAGRAM_LENGTH (SUM_PAYLOAD_START+AX25_FCS_LENGTH)
+
+#define READ16(p) ((((uint16_t) (p)[0]) << 8) | (p)[1])
+
+uint8_t rxframe_decode(uint8_t* io, uint16_t encoded_length, rxframe_t* frame_out)
+{
+	uint8_t* packet;
+	uint16_t i, n, fcs_end, fcs, ip_length, udp_length;
+	uint8_t a, b, byte, valid, errors = 0;
+	uint32_t sum = 0;
+
+	memset(frame_out, 0, sizeof(rxframe_t));
+	n = encoded_length >> 1;
+	if((encoded_length & 1) || n < MIN_FRAGMENT_LENGTH)
+	{
+		frame_out->errors = RXFRAME_ERROR_LENGTH;
+		return frame_out->errors;
+	}
+	fcs_end = n - AX25_FCS_LENGTH;
+	fcs = AX25_FCS_INIT;
+	valid = 1;
+
+	//the output index never passes the input index, so io[] is decoded where it is
+	for(i = 0; i < n; i++)
+	{
+		a = io[i << 1];
+		b = io[(i << 1) + 1];
+		valid &= ME_VALID(a) & ME_VALID(b);
+		byte = (ME_DECODE(a) << 4) | ME_DECODE(b);
+		io[i] = byte;
+		if(i < fcs_end)
+		{
+			fcs = AX25_FCS_UPDATE(fcs, byte);
+			//words line up with even offsets from the packet start, which is itself even
+			if(i >= SUM_ADDRESS_START && (i < SUM_ADDRESS_END || i >= SUM_PAYLOAD_START))
+				sum += ((i - PACKET_OFFSET) & 1) ? byte : ((uint16_t) byte << 8);
+		}
+	}
+	if(!valid)
+		errors |= RXFRAME_ERROR_SYMBOL;
+	if((fcs ^ 0xffff) != READ16(io + fcs_end))
+		errors |= RXFRAME_ERROR_FCS;
+
+	packet = io + PACKET_OFFSET;
+	frame_out->packet = packet;
+	frame_out->packet_length = fcs_end - PACKET_OFFSET;
+	ip_length = READ16(packet + IPV4_TOTAL_LENGTH_OFFSET);
+	if(packet[IPV4_VERSIONnIHL_OFFSET] != 0x45 || packet[IPV4_PROTOCOL_OFFSET] != UDP_IPV4_PROTOCOL_NUMBER
+			|| ip_length != frame_out->packet_length)
+		errors |= RXFRAME_ERROR_IP_HEADER;
+
+	if(udp_is_fragment(packet))
+	{
+		frame_out->fragment = 1;
+		frame_out->errors = errors;
+		return errors;
+	}
+	if(n < MIN_DATAGRAM_LENGTH)
+	{
+		frame_out->errors = errors | RXFRAME_ERROR_LENGTH;
+		return frame_out->errors;
+	}
+
+	udp_length = READ16(packet + UDP_LENGTH_OFFSET);
+	if(udp_length + IPV4_PAYLOAD_OFFSET != ip_length || udp_length + IPV4_PAYLOAD_OFFSET != frame_out->packet_length)
+		errors |= RXFRAME_ERROR_UDP_LENGTH;
+
+	//same nonstandard sum as udp_calculate_checksum, the udp header itself is left out
+	sum += UDP_IPV4_PROTOCOL_NUMBER + udp_length;
+	while(sum >> 16)
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	if((uint16_t) ~sum != READ16(packet + UDP_CHECKSUM_OFFSET))
+		errors |= RXFRAME_ERROR_UDP_CHECKSUM;
+
+	frame_out->src_port = READ16(packet + UDP_SOURCE_PORT_OFFSET);
+	frame_out->dst_port = READ16(packet + UDP_DESTINATION_PORT_OFFSET);
+	frame_out->payload = packet + UDP_PAYLOAD_OFFSET;
+	frame_out->udp_length = udp_length;
+	frame_out->errors = errors;
+	return errors;
+}
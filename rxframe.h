@@ -0,0 +1,53 @@
+/*
+ * File:   rxframe.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef RXFRAME_H
+#define	RXFRAME_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+/*! failure reasons, every one that applies is reported */
+#define RXFRAME_ERROR_SYMBOL		0x01
+#define RXFRAME_ERROR_LENGTH		0x02
+#define RXFRAME_ERROR_FCS			0x04
+#define RXFRAME_ERROR_IP_HEADER		0x08
+#define RXFRAME_ERROR_UDP_LENGTH	0x10
+#define RXFRAME_ERROR_UDP_CHECKSUM	0x20
+
+    typedef struct
+    {
+        uint8_t errors;
+        //non-zero for a fragment, its udp fields are left to reassembly
+        uint8_t fragment;
+        //views into the decoded frame
+        uint8_t* packet;
+        uint16_t packet_length;
+        uint8_t* payload;
+        //udp length as udp_open_packet returns it, header included
+        uint16_t udp_length;
+        uint16_t src_port;
+        uint16_t dst_port;
+    } rxframe_t;
+
+    /*!
+     * rxframe_decode()
+     * single pass over a manchester encoded ax25/ipv4/udp frame: decodes it in place,
+     * checks every symbol, runs the ax25 fcs and sums the udp checksum on the way
+     * fills frame_out and returns its errors, zero for a good frame
+     */
+    uint8_t rxframe_decode(uint8_t* io, uint16_t encoded_length, rxframe_t* frame_out);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* RXFRAME_H */
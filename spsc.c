@@ -0,0 +1,67 @@
+/*
+ * spsc.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "spsc.h"
+
+#define SLOT(ring, index) ((ring)->storage + (uint32_t) ((index) & ((ring)->num_slots - 1)) * (ring)->slot_size)
+
+void spsc_initialize(spsc_t* ring, uint8_t* storage, uint16_t* lengths, uint16_t slot_size, uint16_t num_slots)
+{
+	ring->storage = storage;
+	ring->lengths = lengths;
+	ring->slot_size = slot_size;
+	ring->num_slots = num_slots;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->full = 0;
+}
+
+uint8_t* spsc_reserve(spsc_t* ring)
+{
+	uint32_t head = ring->head;
+
+	if(head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= ring->num_slots)
+	{
+		ring->full++;
+		return NULL;
+	}
+	return SLOT(ring, head);
+}
+
+void spsc_commit(spsc_t* ring, uint16_t length)
+{
+	uint32_t head = ring->head;
+
+	ring->lengths[head & (ring->num_slots - 1)] = length;
+	//the slot and its length have to be visible before the new head is
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+uint8_t* spsc_peek(spsc_t* ring, uint16_t* length)
+{
+	uint32_t tail = ring->tail;
+
+	if(__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == tail)
+		return NULL;
+	*length = ring->lengths[tail & (ring->num_slots - 1)];
+	return SLOT(ring, tail);
+}
+
+void spsc_release(spsc_t* ring)
+{
+	//everything read out of the slot happens before the producer may reuse it
+	__atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
+
+uint16_t spsc_count(spsc_t* ring)
+{
+	return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,86 @@
+/*
+ * File:   spsc.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef SPSC_H
+#define	SPSC_H
+
+#include <inttypes.h>
+#include <stdint.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+/*
+ * lock-free ring of fixed size slots between exactly one producer thread and
+ * one consumer thread of the host tool
+ * the producer fills a slot in place and commits it, the consumer works on it
+ * in place and releases it, frames are never copied in or out
+ * head is only written by the producer and tail only by the consumer, each
+ * publishes with a release store the other side reads with an acquire load
+ */
+
+    typedef struct
+    {
+        uint8_t* storage;
+        uint16_t* lengths;
+        uint16_t slot_size;
+        uint16_t num_slots;
+        uint32_t head;
+        uint32_t tail;
+        //producer side, commits refused because the ring was full
+        uint32_t full;
+    } spsc_t;
+
+/*! declares a ring with its storage, num_slots must be a power of two */
+#define SPSC_DEFINE(name, slot_size, num_slots) \
+    static uint8_t name##_storage[(num_slots)*(slot_size)]; \
+    static uint16_t name##_lengths[(num_slots)]; \
+    spsc_t name = { name##_storage, name##_lengths, (slot_size), (num_slots), 0, 0, 0 }
+
+    /*!
+     * spsc_initialize()
+     * sets up an empty ring over storage the caller keeps, for rings SPSC_DEFINE can't declare
+     * storage holds num_slots slots of slot_size bytes, num_slots must be a power of two
+     */
+    void spsc_initialize(spsc_t* ring, uint8_t* storage, uint16_t* lengths, uint16_t slot_size, uint16_t num_slots);
+
+    /*!
+     * spsc_reserve()
+     * producer only, the next free slot to fill or NULL if the ring is full
+     */
+    uint8_t* spsc_reserve(spsc_t* ring);
+
+    /*!
+     * spsc_commit()
+     * producer only, hands the reserved slot with length bytes in it to the consumer
+     */
+    void spsc_commit(spsc_t* ring, uint16_t length);
+
+    /*!
+     * spsc_peek()
+     * consumer only, the oldest committed slot and its length or NULL if the ring is empty
+     */
+    uint8_t* spsc_peek(spsc_t* ring, uint16_t* length);
+
+    /*!
+     * spsc_release()
+     * consumer only, gives the slot spsc_peek() returned back to the producer
+     */
+    void spsc_release(spsc_t* ring);
+
+    /*!
+     * spsc_count()
+     * committed slots not released yet, only a snapshot when called from a third thread
+     */
+    uint16_t spsc_count(spsc_t* ring);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* SPSC_H */
@@ -0,0 +1,198 @@
+/*
+ * tdma.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "tdma.h"
+#include "timers.h"
+#include "avr_util.h"
+
+#define MS_TO_TICKS(ms) ((((uint32_t)(ms))*CLOCK_SECOND+999)/1000)
+#define TICKS_TO_MS(t) ((((uint32_t)(t))*1000)/CLOCK_SECOND)
+//clock_time() differences are exact up to half its range, after that clock_seconds() counts
+#define EXACT_TICKS_SECONDS (((clock_time_t) ~(clock_time_t) 0) / 2 / CLOCK_SECOND)
+
+static RADIO_LOCAL clock_time_t beacon_time;
+static RADIO_LOCAL unsigned long beacon_seconds;
+static RADIO_LOCAL uint32_t slot_ticks;
+static RADIO_LOCAL uint8_t num_slots = 0;
+static RADIO_LOCAL uint32_t my_slots = 0;
+static RADIO_LOCAL uint8_t synchronized = 0;
+static RADIO_LOCAL timers_timer_t slot_timer;
+static void (*wakeupCallback)(void);
+
+static void tdma_slot_started(void* context)
+{
+	if(wakeupCallback != NULL)
+		wakeupCallback();
+}
+
+/*
+ * ticks since the last beacon, clock_time() is only 16 bits and wraps every
+ * few minutes, so long gaps are measured in whole seconds instead
+ */
+static uint32_t tdma_elapsed(void)
+{
+	unsigned long seconds = clock_seconds() - beacon_seconds;
+
+	if(seconds < EXACT_TICKS_SECONDS)
+		return (clock_time_t) (clock_time() - beacon_time);
+	return (uint32_t) seconds * CLOCK_SECOND;
+}
+
+/*
+ * position inside the current superframe in ticks, the superframe is
+ * num_slots data slots followed by one slot for the next beacon
+ */
+static uint32_t tdma_superframe_position(void)
+{
+	uint32_t elapsed = tdma_elapsed();
+	uint32_t superframe = slot_ticks * (num_slots + 1);
+
+	if(elapsed >= superframe * TDMA_MAX_MISSED_BEACONS)
+		synchronized = 0;
+	return elapsed % superframe;
+}
+
+uint16_t tdma_slot_length_ms(uint16_t baud, uint16_t frame_length)
+{
+	uint32_t airtime;
+
+	//8N1 framing, ten bits per byte on the air
+	airtime = ((uint32_t) frame_length * 10 * 1000 + baud - 1) / baud;
+	return airtime + TDMA_TX_OVERHEAD_MS + TDMA_GUARD_MS;
+}
+
+uint16_t tdma_build_beacon(uint8_t* payload_out, uint8_t sequence, uint16_t slot_length_ms, uint8_t (*slot_owners)[4], uint8_t num_slots)
+{
+	uint8_t i;
+
+	if(num_slots > TDMA_MAX_SLOTS)
+		num_slots = TDMA_MAX_SLOTS;
+
+	payload_out[TDMA_BEACON_VERSION_OFFSET] = TDMA_BEACON_VERSION;
+	payload_out[TDMA_BEACON_SEQUENCE_OFFSET] = sequence;
+	payload_out[TDMA_BEACON_SLOT_LENGTH_OFFSET] = (slot_length_ms >> 8) & 0xFF;
+	payload_out[TDMA_BEACON_SLOT_LENGTH_OFFSET + 1] = slot_length_ms & 0xFF;
+	payload_out[TDMA_BEACON_NUM_SLOTS_OFFSET] = num_slots;
+	for(i = 0; i < num_slots; i++)
+		memcpy(payload_out + TDMA_BEACON_MAP_OFFSET + 4 * i, slot_owners[i], 4);
+
+	return TDMA_BEACON_LENGTH(num_slots);
+}
+
+void tdma_initialize(void (*wakeup)(void))
+{
+	wakeupCallback = wakeup;
+	synchronized = 0;
+	my_slots = 0;
+	num_slots = 0;
+}
+
+uint8_t tdma_beacon_received(uint8_t* payload, uint16_t len, uint8_t* my_ip)
+{
+	uint16_t slot_ms;
+	uint8_t i, n, mine = 0;
+
+	if(len < TDMA_BEACON_MAP_OFFSET || payload[TDMA_BEACON_VERSION_OFFSET] != TDMA_BEACON_VERSION)
+		return 0;
+	n = payload[TDMA_BEACON_NUM_SLOTS_OFFSET];
+	if(n == 0 || n > TDMA_MAX_SLOTS || len < TDMA_BEACON_LENGTH(n))
+		return 0;
+	slot_ms = payload[TDMA_BEACON_SLOT_LENGTH_OFFSET];
+	slot_ms <<= 8;
+	slot_ms |= payload[TDMA_BEACON_SLOT_LENGTH_OFFSET + 1];
+	if(slot_ms == 0)
+		return 0;
+
+	//the frame was handed over right after its eof byte, that is our reference point
+	beacon_time = clock_time();
+	beacon_seconds = clock_seconds();
+	slot_ticks = MS_TO_TICKS(slot_ms);
+	num_slots = n;
+	my_slots = 0;
+	for(i = 0; i < n; i++)
+	{
+		if(!memcmp(payload + TDMA_BEACON_MAP_OFFSET + 4 * i, my_ip, 4))
+		{
+			my_slots |= ((uint32_t) 1) << i;
+			mine++;
+		}
+	}
+	synchronized = (mine != 0);
+	if(!synchronized)
+		timers_stop(&slot_timer);
+	return mine;
+}
+
+uint8_t tdma_synchronized(void)
+{
+	if(synchronized)
+		tdma_superframe_position();
+	return synchronized;
+}
+
+static uint8_t tdma_owns(uint8_t slot)
+{
+	return slot < num_slots && (my_slots & (((uint32_t) 1) << slot));
+}
+
+/*
+ * ticks from position to the start of the next slot we own,
+ * not counting the slot position is in
+ */
+static uint32_t tdma_ticks_to_next_slot(uint32_t position)
+{
+	uint32_t slot_start;
+	uint8_t slot, i;
+
+	slot = position / slot_ticks;
+	for(i = 0; i <= num_slots; i++)
+	{
+		slot = (slot + 1) % (num_slots + 1);
+		if(tdma_owns(slot))
+			break;
+	}
+	slot_start = slot * slot_ticks;
+	if(slot_start <= position)
+		slot_start += slot_ticks * (num_slots + 1);
+	return slot_start - position;
+}
+
+uint32_t tdma_ms_until_slot(void)
+{
+	uint32_t position;
+
+	if(!tdma_synchronized())
+		return 0;
+	position = tdma_superframe_position();
+	if(tdma_owns(position / slot_ticks))
+		return 0;
+	return TICKS_TO_MS(tdma_ticks_to_next_slot(position));
+}
+
+uint8_t tdma_clear_to_send(uint16_t airtime_ms)
+{
+	uint32_t position, left, wait_ms;
+
+	position = tdma_superframe_position();
+	if(tdma_owns(position / slot_ticks))
+	{
+		left = slot_ticks - (position % slot_ticks);
+		if(left >= MS_TO_TICKS(airtime_ms + TDMA_GUARD_MS))
+			return TDMA_TRANSMIT;
+	}
+	//not our slot or not enough room left in it, sleep until the next one of ours
+	wait_ms = TICKS_TO_MS(tdma_ticks_to_next_slot(position));
+	if(!timers_is_running(&slot_timer))
+		timers_start(&slot_timer, wait_ms / 1000, wait_ms % 1000, tdma_slot_started, NULL);
+	return TDMA_WAIT;
+}
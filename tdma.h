@@ -0,0 +1,99 @@
+/*
+ * File:   tdma.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef TDMA_H
+#define	TDMA_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+#define TDMA_MAX_SLOTS 30
+#define TDMA_BEACON_VERSION 1
+
+/*! radio turnaround around every transmission, rts lead plus tail on the node */
+#ifndef TDMA_TX_OVERHEAD_MS
+#define TDMA_TX_OVERHEAD_MS 40
+#endif
+/*! idle time at the end of each slot to absorb clock drift between beacons */
+#ifndef TDMA_GUARD_MS
+#define TDMA_GUARD_MS 30
+#endif
+/*! superframes without a beacon before a node falls back to contention */
+#ifndef TDMA_MAX_MISSED_BEACONS
+#define TDMA_MAX_MISSED_BEACONS 3
+#endif
+
+/*
+ * beacon payload, all fields big endian
+ * version(1) sequence(1) slot_length_ms(2) number_of_slots(1) slot_owner_ip(4)*number_of_slots
+ * slots start right after the beacon, the superframe ends with one more slot for the next beacon
+ */
+#define TDMA_BEACON_VERSION_OFFSET 0
+#define TDMA_BEACON_SEQUENCE_OFFSET 1
+#define TDMA_BEACON_SLOT_LENGTH_OFFSET 2
+#define TDMA_BEACON_NUM_SLOTS_OFFSET 4
+#define TDMA_BEACON_MAP_OFFSET 5
+#define TDMA_BEACON_LENGTH(numSlots) (TDMA_BEACON_MAP_OFFSET+4*(numSlots))
+
+#define TDMA_WAIT		0
+#define TDMA_TRANSMIT	1
+
+    /*!
+     * tdma_slot_length_ms()
+     * length of a slot that fits one frame of frame_length bytes (8N1) at the given baud rate
+     */
+    uint16_t tdma_slot_length_ms(uint16_t baud, uint16_t frame_length);
+
+    /*!
+     * tdma_build_beacon()
+     * gateway side, writes a beacon payload assigning slot i to slot_owners[i]
+     * returns the payload length
+     */
+    uint16_t tdma_build_beacon(uint8_t* payload_out, uint8_t sequence, uint16_t slot_length_ms, uint8_t (*slot_owners)[4], uint8_t num_slots);
+
+    /*!
+     * tdma_initialize()
+     * wakeup is called from timer context when the node's next slot begins
+     */
+    void tdma_initialize(void (*wakeup)(void));
+
+    /*!
+     * tdma_beacon_received()
+     * node side, synchronizes to a beacon and picks up the slots owned by my_ip
+     * returns the number of slots assigned to this node
+     */
+    uint8_t tdma_beacon_received(uint8_t* payload, uint16_t len, uint8_t* my_ip);
+
+    /*!
+     * tdma_synchronized()
+     * non-zero while the node has slots and the last beacon is recent enough
+     */
+    uint8_t tdma_synchronized(void);
+
+    /*!
+     * tdma_clear_to_send()
+     * TDMA_TRANSMIT if a frame keying the transmitter for airtime_ms (turnaround included)
+     * fits in what is left of one of our slots
+     * otherwise arms the wakeup for the start of our next slot and returns TDMA_WAIT
+     */
+    uint8_t tdma_clear_to_send(uint16_t airtime_ms);
+
+    /*!
+     * tdma_ms_until_slot()
+     * time the radio may sleep before our next slot starts, zero inside our slot
+     */
+    uint32_t tdma_ms_until_slot(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TDMA_H */
@@ -11,28 +11,51 @@
 #include "radiotftp.h"
 #include "util.h"
 #include "avr_util.h"
+#include "linkstats.h"
+#include "trace.h"
+#include "dlog.h"
 
-static uint8_t* data_buffer;
-static uint16_t fileLen;
-static uint16_t buffer_pos=0;
-static message_t lastMessage;
-static uint8_t status=TFTP_STATUS_IDLE;
-static uint8_t timeouts=0;
-static uint8_t isRequestOwner=0;
-static uint16_t blockNumber=0;
-static uint16_t ackNumber=0;
-static uint16_t tftp_dst_port=70;
-static uint16_t tftp_src_port=71;
-static dataQueuerfptr_t mainDataQueuer;
+static RADIO_LOCAL uint8_t* data_buffer;
+static RADIO_LOCAL uint16_t fileLen;
+static RADIO_LOCAL uint16_t buffer_pos=0;
+static RADIO_LOCAL message_t lastMessage;
+static RADIO_LOCAL uint8_t status=TFTP_STATUS_IDLE;
+static RADIO_LOCAL uint8_t timeouts=0;
+static RADIO_LOCAL uint8_t isRequestOwner=0;
+static RADIO_LOCAL uint16_t blockNumber=0;
+static RADIO_LOCAL uint16_t ackNumber=0;
+static RADIO_LOCAL uint16_t tftp_dst_port=70;
+static RADIO_LOCAL uint16_t tftp_src_port=71;
+static RADIO_LOCAL dataQueuerfptr_t mainDataQueuer;
+static RADIO_LOCAL dataRequeuerfptr_t mainDataRequeuer=NULL;
+static RADIO_LOCAL dataStagerfptr_t mainDataStager=NULL;
+static RADIO_LOCAL tftpEventfptr_t mainEventHandler=NULL;
+#if TFTP_RECEIVE_ENABLED
+static RADIO_LOCAL FILE* receiveFile=NULL;
+#endif
+
+#define TFTP_EVENT(event, peer, block) do{ if(mainEventHandler!=NULL) mainEventHandler((event), (peer), (block)); }while(0)
 
-uint8_t tftp_initialize(dataQueuerfptr_t dataQueuer)
+uint8_t tftp_initialize(dataQueuerfptr_t dataQueuer, dataStagerfptr_t dataStager)
 {
+    //data blocks and errors have nowhere to be built without a stager
+    if(dataQueuer==NULL || dataStager==NULL)
+        return 1;
     mainDataQueuer=dataQueuer;
+    mainDataStager=dataStager;
     tftp_setStatus(TFTP_STATUS_IDLE);
     //for testing
     //timers_create_timer("TFTP Timer", &tftp_timer, 3, 0);
     return 0;
 }
+void tftp_set_data_requeuer(dataRequeuerfptr_t dataRequeuer)
+{
+    mainDataRequeuer=dataRequeuer;
+}
+void tftp_set_event_handler(tftpEventfptr_t eventHandler)
+{
+    mainEventHandler=eventHandler;
+}
 uint8_t tftp_getStatus(void)
 {
 	return status;
@@ -58,6 +81,8 @@ uint8_t tftp_getRandomRetransmissionTime(void)
 uint8_t tftp_sendSingleBlockData(uint8_t* dst_ip, uint8_t* data_ptr, uint16_t data_len, uint8_t* remote_filename)
 {
 	uint8_t filenameCheck=0;
+	//single blocks are never retransmitted, the payload only lives until it is queued
+	uint8_t* payload;
 
 	if(data_len>450)
 	{
@@ -105,15 +130,21 @@ uint8_t tftp_sendSingleBlockData(uint8_t* dst_ip, uint8_t* data_ptr, uint16_t da
     tftp_src_port=lastMessage.src_port;
     printf("tftp src port = %d\n", tftp_src_port);
     //create the payload
-    lastMessage.payload[lastMessage.payloadLength++] = 0x00;
-    lastMessage.payload[lastMessage.payloadLength++] = TFTP_OPCODE_WRQ_SINGLE;
-    memcpy(lastMessage.payload+lastMessage.payloadLength, remote_filename, strnlen(remote_filename, 16));
+    payload = mainDataStager(lastMessage.src_port, lastMessage.dst_port, lastMessage.opcode);
+    if(payload==NULL)
+    {
+        printf("no room for the data\n");
+        return (-4);
+    }
+    payload[lastMessage.payloadLength++] = 0x00;
+    payload[lastMessage.payloadLength++] = TFTP_OPCODE_WRQ_SINGLE;
+    memcpy(payload+lastMessage.payloadLength, remote_filename, strnlen(remote_filename, 16));
     lastMessage.payloadLength+=strnlen(remote_filename, 16);
     printf("remote_filename = '%s'\n", remote_filename);
-    memcpy(lastMessage.payload+lastMessage.payloadLength, "\0netascii\0", 10);
+    memcpy(payload+lastMessage.payloadLength, "\0netascii\0", 10);
     lastMessage.payloadLength+=10;
     lastMessage.append=0;
-    memcpy(&(lastMessage.payload[lastMessage.payloadLength]), data_ptr, data_len);
+    memcpy(&(payload[lastMessage.payloadLength]), data_ptr, data_len);
     lastMessage.payloadLength+=data_len;
 
     //put the block number in
@@ -128,7 +159,7 @@ uint8_t tftp_sendSingleBlockData(uint8_t* dst_ip, uint8_t* data_ptr, uint16_t da
     blockNumber=0;
     isRequestOwner=1;
     timeouts=0;
-    return mainDataQueuer(udp_get_localhost_ip(NULL), lastMessage.src_port, lastMessage.dst, lastMessage.dst_port, lastMessage.payload, lastMessage.payloadLength);
+    return mainDataQueuer(udp_get_localhost_ip(NULL), lastMessage.src_port, lastMessage.dst, lastMessage.dst_port, payload, lastMessage.payloadLength);
 }
 uint8_t tftp_sendRequest(uint8_t opcode, uint8_t* dst_ip, uint8_t* local_databuffer, uint16_t local_databuffer_len, uint8_t* remote_filename, uint8_t remote_filename_len, uint8_t append)
 {
@@ -151,6 +182,10 @@ uint8_t tftp_sendRequest(uint8_t opcode, uint8_t* dst_ip, uint8_t* local_databuf
 		remote_filename="sensors.dat";
 		remote_filename_len=strlen("sensors.dat");
 	}
+	if(remote_filename_len>TFTP_MAX_FILENAME_LENGTH)
+	{
+		remote_filename_len=TFTP_MAX_FILENAME_LENGTH;
+	}
 	if(filenameCheck == 0x03)
 	{
 		return -1;
@@ -223,28 +258,29 @@ uint8_t tftp_sendRequest(uint8_t opcode, uint8_t* dst_ip, uint8_t* local_databuf
     blockNumber=0;
     isRequestOwner=1;
     timeouts=0;
+    TFTP_EVENT(TFTP_EVENT_REQUEST, lastMessage.dst, 0);
     return mainDataQueuer(udp_get_localhost_ip(NULL), lastMessage.src_port, lastMessage.dst, lastMessage.dst_port, lastMessage.payload, lastMessage.payloadLength);
 }
-uint8_t tftp_sendData(uint8_t* dst_ip, uint8_t blockNum)
+/*
+ * builds data block blockNum from the file buffer straight into the room the stager
+ * hands out and queues it, a retransmission builds it again
+ */
+static uint8_t tftp_queueData(uint8_t blockNum)
 {
     uint16_t curPos, writeLen;
-//    PRINTF_D("tftp_sendData\n");
+    uint8_t* payload;
+
     lastMessage.payloadLength=0;
-    //put opcode in
-    lastMessage.opcode=TFTP_OPCODE_DATA;
-    //put source ip in
-    udp_get_localhost_ip(lastMessage.src);
-    //put destination ip in
-    memcpy(lastMessage.dst, dst_ip, 6);
-    //select destination port
-    lastMessage.dst_port=tftp_dst_port;
-    //select a random src port
-    lastMessage.src_port=tftp_src_port;
     //create the payload
-    lastMessage.payload[lastMessage.payloadLength++] = 0x00;
-    lastMessage.payload[lastMessage.payloadLength++] = lastMessage.opcode;
-    lastMessage.payload[lastMessage.payloadLength++] = 0x00;
-    lastMessage.payload[lastMessage.payloadLength++] = blockNum;
+    payload = mainDataStager(lastMessage.src_port, lastMessage.dst_port, lastMessage.opcode);
+    if(payload==NULL)
+    {
+        return (-1);
+    }
+    payload[lastMessage.payloadLength++] = 0x00;
+    payload[lastMessage.payloadLength++] = lastMessage.opcode;
+    payload[lastMessage.payloadLength++] = 0x00;
+    payload[lastMessage.payloadLength++] = blockNum;
     //copy the data
 #if 0
     curPos=buffer_pos; //this one was found to be faulty in case of retransmission
@@ -256,20 +292,38 @@ uint8_t tftp_sendData(uint8_t* dst_ip, uint8_t blockNum)
     	writeLen=fileLen-curPos;
     else
     	writeLen=TFTP_MAX_BLOCK_SIZE;
-    memcpy(lastMessage.payload+lastMessage.payloadLength, data_buffer+curPos, writeLen);
+    memcpy(payload+lastMessage.payloadLength, data_buffer+curPos, writeLen);
     lastMessage.payloadLength+=writeLen;
     curPos+=writeLen;
 
 //    PRINTF_D("tftp_sendData: after memcpy\n");
+    DLOG1(DLOG_TFTP_DATA_SENT, lastMessage.payloadLength);
+    return mainDataQueuer(udp_get_localhost_ip(NULL), lastMessage.src_port, lastMessage.dst, lastMessage.dst_port, payload, lastMessage.payloadLength);
+}
+uint8_t tftp_sendData(uint8_t* dst_ip, uint8_t blockNum)
+{
+//    PRINTF_D("tftp_sendData\n");
+    //put opcode in
+    lastMessage.opcode=TFTP_OPCODE_DATA;
+    //put source ip in
+    udp_get_localhost_ip(lastMessage.src);
+    //put destination ip in
+    memcpy(lastMessage.dst, dst_ip, 6);
+    //select destination port
+    lastMessage.dst_port=tftp_dst_port;
+    //select a random src port
+    lastMessage.src_port=tftp_src_port;
     //put the block number in
     lastMessage.blockNumber = blockNum;
     //set up retransmit timer
     timers_create_timer(tftp_getRandomRetransmissionTime(), 128);
-    PRINTF_D("sent data size = %u\n", lastMessage.payloadLength);
-    return mainDataQueuer(udp_get_localhost_ip(NULL), lastMessage.src_port, lastMessage.dst, lastMessage.dst_port, lastMessage.payload, lastMessage.payloadLength);
+    TFTP_EVENT(TFTP_EVENT_DATA, lastMessage.dst, blockNum);
+    return tftp_queueData(blockNum);
 }
 uint8_t tftp_sendError(uint8_t type, uint8_t* dst_ip, uint16_t dst_prt, uint8_t* additionalInfo, uint8_t infoLen)
 {
+    uint8_t* payload;
+
     lastMessage.payloadLength=0;
     //put opcode in
     lastMessage.opcode=TFTP_OPCODE_ERROR;
@@ -282,19 +336,24 @@ uint8_t tftp_sendError(uint8_t type, uint8_t* dst_ip, uint16_t dst_prt, uint8_t*
     //select a random src port
     lastMessage.src_port=tftp_src_port;
     //create the payload
-    lastMessage.payload[lastMessage.payloadLength++] = 0x00;
-    lastMessage.payload[lastMessage.payloadLength++] = lastMessage.opcode;
-    lastMessage.payload[lastMessage.payloadLength++] = 0x00;
-    lastMessage.payload[lastMessage.payloadLength++] = type;
+    payload = mainDataStager(lastMessage.src_port, lastMessage.dst_port, lastMessage.opcode);
+    if(payload==NULL)
+    {
+        return (-1);
+    }
+    payload[lastMessage.payloadLength++] = 0x00;
+    payload[lastMessage.payloadLength++] = lastMessage.opcode;
+    payload[lastMessage.payloadLength++] = 0x00;
+    payload[lastMessage.payloadLength++] = type;
     //copy the info
     if(additionalInfo!=NULL)
     {
-    	memcpy(lastMessage.payload+lastMessage.payloadLength, additionalInfo, infoLen);
+    	memcpy(payload+lastMessage.payloadLength, additionalInfo, infoLen);
         lastMessage.payloadLength+=infoLen;
     }
     //set up retransmit timer
     //PRINTF_D("sent error size = %d\n", lastMessage.payloadLength);
-    return mainDataQueuer(udp_get_localhost_ip(NULL), lastMessage.src_port, lastMessage.dst, lastMessage.dst_port, lastMessage.payload, lastMessage.payloadLength);
+    return mainDataQueuer(udp_get_localhost_ip(NULL), lastMessage.src_port, lastMessage.dst, lastMessage.dst_port, payload, lastMessage.payloadLength);
 }
 uint8_t tftp_sendAck(uint8_t* dst_ip, uint8_t blockNum)
 {
@@ -306,10 +365,158 @@ uint8_t tftp_sendAck(uint8_t* dst_ip, uint8_t blockNum)
     buffer[i++]= (blockNum>>8)&0xFF;
     buffer[i++]= (blockNum&0xFF);
 
-    PRINTF_D("sent ack size = %d\n", i);
+    DLOG1(DLOG_TFTP_ACK_SENT, i);
     return mainDataQueuer(udp_get_localhost_ip(NULL), tftp_src_port, dst_ip, tftp_dst_port, buffer, i);
 }
 
+#if TFTP_RECEIVE_ENABLED
+/*
+ * the sender stops at the completion message, it is never acked
+ * repeated when the last block comes in again because it got lost
+ */
+static uint8_t tftp_sendComplete(uint8_t* dst_ip)
+{
+    return tftp_sendError(TFTP_ERROR_SEE_MESSAGE, dst_ip, tftp_dst_port, "TRANSMISSION COMPLETE", strlen("TRANSMISSION COMPLETE")+1);
+}
+static void tftp_endReceive(uint8_t event)
+{
+    timers_cancel_timer();
+    if(receiveFile!=NULL)
+    {
+        fclose(receiveFile);
+        receiveFile=NULL;
+    }
+    status=TFTP_STATUS_IDLE;
+    TFTP_EVENT(event, lastMessage.dst, ackNumber);
+}
+/*
+ * opens filename from a request for writing, a name that could leave the
+ * working directory is refused
+ */
+static FILE* tftp_openReceived(uint8_t* filename, uint8_t append)
+{
+    if(filename[0]==0 || filename[0]=='.' || strchr(filename, '/')!=NULL)
+        return NULL;
+    return fopen(filename, append ? "ab" : "wb");
+}
+PACKET_HANDLER_FUNCTION(tftp_negotiate)
+{
+    uint8_t filename[TFTP_MAX_FILENAME_LENGTH+1];
+    uint16_t opcode, i=2, nameLength;
+    uint8_t* mode;
+    uint8_t append;
+    FILE* file;
+
+    if(len<4)
+        return 0;
+    opcode = payload[0] & 0xFF;
+    opcode <<= 8;
+    opcode |= payload[1] & 0xFF;
+    if(opcode!=TFTP_OPCODE_WRQ && opcode!=TFTP_OPCODE_WRQ_SINGLE)
+    {
+        //a running transfer keeps its ports, the asker times out instead
+        if(status!=TFTP_STATUS_IDLE)
+            return 0;
+        tftp_src_port=69;
+        tftp_dst_port=src_port;
+        return tftp_sendError(TFTP_ERROR_ILLEGAL_OPERATION, src, src_port, "only writes", strlen("only writes")+1);
+    }
+    //filename and mode are both zero terminated
+    nameLength = strnlen(payload+i, len-i);
+    if(nameLength>TFTP_MAX_FILENAME_LENGTH || i+nameLength>=len)
+        return 0;
+    memcpy(filename, payload+i, nameLength);
+    filename[nameLength]=0;
+    i += nameLength+1;
+    mode = payload+i;
+    i += strnlen(mode, len-i)+1;
+    if(i>len)
+        return 0;
+
+    if(opcode==TFTP_OPCODE_WRQ_SINGLE)
+    {
+        //nobody waits for an answer, the data just follows the mode
+        file = tftp_openReceived(filename, 1);
+        if(file==NULL)
+            return 0;
+        fwrite(payload+i, 1, len-i, file);
+        fclose(file);
+        PRINTF_D("single block of %u bytes appended to '%s'\n", len-i, filename);
+        return 0;
+    }
+
+    if(status==TFTP_STATUS_RECEIVING && !memcmp(src, lastMessage.dst, IPV4_SOURCE_LENGTH) && src_port==tftp_dst_port && ackNumber==0)
+    {
+        //our ack got lost, the sender asked again
+        return tftp_sendAck(src, 0);
+    }
+    if(status!=TFTP_STATUS_IDLE)
+    {
+        return 0;
+    }
+    append = (i<len && !strncmp(payload+i, "append", len-i));
+    file = tftp_openReceived(filename, append);
+    if(file==NULL)
+    {
+        tftp_src_port=69;
+        tftp_dst_port=src_port;
+        return tftp_sendError(TFTP_ERROR_ACCESS_VIOLATION, src, src_port, "can't write there", strlen("can't write there")+1);
+    }
+    receiveFile=file;
+    PRINTF_D("receiving '%s'%s\n", filename, append ? " to append" : "");
+
+    //the transfer gets a port of its own, like a request we send
+    lastMessage.opcode=TFTP_OPCODE_ACK;
+    memcpy(lastMessage.dst, src, IPV4_SOURCE_LENGTH);
+    do
+    {
+        tftp_src_port= 65535*(((float)rand())/((float)RAND_MAX));
+    }while(tftp_src_port==69 || tftp_src_port==0);
+    tftp_dst_port=src_port;
+    isRequestOwner=0;
+    ackNumber=0;
+    timeouts=0;
+    status=TFTP_STATUS_RECEIVING;
+    timers_create_timer(TFTP_READ_TIMEOUT, 0);
+    TFTP_EVENT(TFTP_EVENT_REQUEST, src, 0);
+    return tftp_sendAck(src, 0);
+}
+/* a data block of the file being received */
+static uint8_t tftp_receiveData(uint8_t* src, uint16_t src_port, uint8_t* payload, uint16_t len)
+{
+    uint16_t block;
+
+    if(memcmp(src, lastMessage.dst, IPV4_SOURCE_LENGTH) || src_port!=tftp_dst_port || len<4)
+        return 0;
+    block = payload[2] & 0xFF;
+    block <<= 8;
+    block |= payload[3] & 0xFF;
+    if(block!=(uint16_t)(ackNumber+1))
+    {
+        //a block we have already, our ack for it got lost
+        if(block==ackNumber && block!=0)
+            return tftp_sendAck(src, block);
+        return 0;
+    }
+    if(fwrite(payload+4, 1, len-4, receiveFile)!=len-4)
+    {
+        tftp_sendError(TFTP_ERROR_DISK_FULL, src, tftp_dst_port, "write failed", strlen("write failed")+1);
+        tftp_endReceive(TFTP_EVENT_ABORT);
+        return 1;
+    }
+    ackNumber=block;
+    timeouts=0;
+    DLOG1(DLOG_TFTP_DATA_RECEIVED, block);
+    TFTP_EVENT(TFTP_EVENT_DATA, src, block);
+    if(len-4<TFTP_MAX_BLOCK_SIZE)
+    {
+        tftp_endReceive(TFTP_EVENT_COMPLETE);
+        return tftp_sendComplete(src);
+    }
+    timers_create_timer(TFTP_READ_TIMEOUT, 0);
+    return tftp_sendAck(src, block);
+}
+#endif
 PACKET_HANDLER_FUNCTION(tftp_transfer)
 {
     uint8_t result=0;
@@ -320,6 +527,7 @@ PACKET_HANDLER_FUNCTION(tftp_transfer)
     opcode = payload[i++] & 0xFF;
     opcode <<= 8;
     opcode |= payload[i++] & 0xFF;
+    TRACE(TRACE_TFTP_TRANSFER, opcode);
 
     //check the opcode
     if(status==TFTP_STATUS_SENDING)
@@ -332,7 +540,8 @@ PACKET_HANDLER_FUNCTION(tftp_transfer)
             block <<= 8;
             block |= payload[i++] & 0xFF;
             ackNumber = block;
-            PRINTF_D("tftp wrq ack #%d received\n", block);
+            DLOG1(DLOG_TFTP_ACK, block);
+            TFTP_EVENT(TFTP_EVENT_ACK, src, block);
             //prepare and send next packet
 
             tftp_dst_port=src_port;
@@ -340,7 +549,7 @@ PACKET_HANDLER_FUNCTION(tftp_transfer)
             result=tftp_sendData(src, ackNumber+1);
             if(result)
             {
-                PRINTF_D("!!! couldn't send data #%d\n", ackNumber+1);
+                DLOG1(DLOG_TFTP_DATA_FAILED, ackNumber+1);
             }
             return 0;
         }
@@ -357,9 +566,12 @@ PACKET_HANDLER_FUNCTION(tftp_transfer)
                 PRINTF_D("tftp error received -> %s\n", payload+i);
                 if(!strncmp("TRANSMISSION COMPLETE", payload+i, strlen("TRANSMISSION COMPLETE")))
                 {
+                    TFTP_EVENT(TFTP_EVENT_COMPLETE, src, lastMessage.blockNumber);
                     if(isRequestOwner)
                     {
-                    	return 0;
+                        //the transfer is over, the next request may start
+                        status=TFTP_STATUS_IDLE;
+                        return 0;
                     }
                     ackNumber=lastMessage.blockNumber;
                 }
@@ -368,6 +580,8 @@ PACKET_HANDLER_FUNCTION(tftp_transfer)
             {
                 PRINTF_D("tftp error received %d\n", error);
             }
+            //anything but a completion ends the transfer unfinished, the event is ignored after one
+            TFTP_EVENT(TFTP_EVENT_ABORT, src, lastMessage.blockNumber);
             //return to pending status
             status=TFTP_STATUS_IDLE;
             if(isRequestOwner)
@@ -379,6 +593,22 @@ PACKET_HANDLER_FUNCTION(tftp_transfer)
             return 0;
         }
     }
+#if TFTP_RECEIVE_ENABLED
+    else if(status==TFTP_STATUS_RECEIVING)
+    {
+        if(opcode==TFTP_OPCODE_DATA)
+            return tftp_receiveData(src, src_port, payload, len);
+        if(opcode==TFTP_OPCODE_ERROR && !memcmp(src, lastMessage.dst, IPV4_SOURCE_LENGTH))
+            tftp_endReceive(TFTP_EVENT_ABORT);
+        return 0;
+    }
+    else if(status==TFTP_STATUS_IDLE && opcode==TFTP_OPCODE_DATA && !isRequestOwner && len>=4
+            && !memcmp(src, lastMessage.dst, IPV4_SOURCE_LENGTH) && (((payload[2]<<8) | payload[3])==ackNumber))
+    {
+        //the last block again, the completion message got lost
+        return tftp_sendComplete(src);
+    }
+#endif
     else
     {
         //silent discard
@@ -387,8 +617,31 @@ PACKET_HANDLER_FUNCTION(tftp_transfer)
 
     return result;
 }
+PACKET_HANDLER_FUNCTION(tftp_duplicate)
+{
+    uint16_t opcode, block;
+
+    if(len<4)
+        return 0;
+    opcode = payload[0] & 0xFF;
+    opcode <<= 8;
+    opcode |= payload[1] & 0xFF;
+
+    //a repeated data block means our ack got lost, ack it again without touching the file
+    if(opcode==TFTP_OPCODE_DATA)
+    {
+        block = payload[2] & 0xFF;
+        block <<= 8;
+        block |= payload[3] & 0xFF;
+        DLOG1(DLOG_TFTP_DUPLICATE, block);
+        return tftp_sendAck(src, block);
+    }
+    //repeated acks and errors were acted on the first time
+    return 0;
+}
 TIMER_HANDLER_FUNCTION(tftp_timer_handler)
 {
+	TRACE(TRACE_TFTP_TIMER, timeouts);
 	//TODO something is really weird here with the control statements
 	if(lastMessage.opcode==TFTP_OPCODE_WRQ_SINGLE)
 	{
@@ -396,17 +649,35 @@ TIMER_HANDLER_FUNCTION(tftp_timer_handler)
 		if(isRequestOwner)
 			return 0;
 	}
+#if TFTP_RECEIVE_ENABLED
+	else if(status==TFTP_STATUS_RECEIVING)
+	{
+		DLOG0(DLOG_TFTP_TIMER);
+		timeouts++;
+		LINKSTATS_COUNT(tftp, timeouts);
+		if(timeouts>=TFTP_MAX_TIMEOUTS)
+		{
+			PRINTF_D("sender went quiet, receive canceled\n");
+			tftp_endReceive(TFTP_EVENT_ABORT);
+			return 0;
+		}
+		timers_create_timer(TFTP_READ_TIMEOUT, 0);
+		//the block may have come and our ack got lost
+		return tftp_sendAck(lastMessage.dst, ackNumber);
+	}
+#endif
 	else
 	{
 		if(status==TFTP_STATUS_SENDING)
 		{
-			PRINTF_D("tftp_timer_handler\n");
+			DLOG0(DLOG_TFTP_TIMER);
 			//if the last taken block number is less than the last transmitted ack number
 			//or if we sent a write request and couldn't get an ack yet
 			if( (lastMessage.blockNumber>ackNumber) || (lastMessage.opcode==TFTP_OPCODE_WRQ))
 			{
 				timeouts++;
-				PRINTF_D("tftp ack timer timeout %d, timeouts=%d\n", ackNumber, timeouts);
+				LINKSTATS_COUNT(tftp, timeouts);
+				DLOG2(DLOG_TFTP_TIMEOUT, ackNumber, timeouts);
 
 				if(timeouts>=TFTP_MAX_TIMEOUTS)
 				{
@@ -414,6 +685,7 @@ TIMER_HANDLER_FUNCTION(tftp_timer_handler)
 					blockNumber=0;
 					ackNumber=0;
 					PRINTF_D("connection canceled\n");
+					TFTP_EVENT(TFTP_EVENT_ABORT, lastMessage.dst, lastMessage.blockNumber);
 					if(isRequestOwner)
 						return (-18);
 					return 0;
@@ -421,8 +693,15 @@ TIMER_HANDLER_FUNCTION(tftp_timer_handler)
 
 				//set up retransmit timer
 				timers_create_timer(tftp_getRandomRetransmissionTime(), 128);
-				//retransmit
-				return mainDataQueuer(udp_get_localhost_ip(NULL), lastMessage.src_port, lastMessage.dst, lastMessage.dst_port, lastMessage.payload, lastMessage.payloadLength);
+				LINKSTATS_COUNT(tftp, retransmissions);
+				TFTP_EVENT(TFTP_EVENT_RETRANSMIT, lastMessage.dst, lastMessage.blockNumber);
+				//retransmit, the frames that went out last time are usually still encoded
+				if(mainDataRequeuer!=NULL && !mainDataRequeuer(lastMessage.src_port, lastMessage.blockNumber))
+					return 0;
+				if(lastMessage.opcode==TFTP_OPCODE_DATA)
+					return tftp_queueData(lastMessage.blockNumber);
+				if(lastMessage.opcode==TFTP_OPCODE_WRQ || lastMessage.opcode==TFTP_OPCODE_RRQ)
+					return mainDataQueuer(udp_get_localhost_ip(NULL), lastMessage.src_port, lastMessage.dst, lastMessage.dst_port, lastMessage.payload, lastMessage.payloadLength);
 			}
 		}
 	}
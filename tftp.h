@@ -38,6 +38,15 @@ extern "C" {
 #define TFTP_ERROR_FILE_EXISTS          0x0006
 #define TFTP_ERROR_NO_USER              0x0007
 
+/*! the gateway side, files the nodes write are stored through stdio, nodes have nowhere to keep them */
+#ifndef TFTP_RECEIVE_ENABLED
+#if defined(__AVR__)
+#define TFTP_RECEIVE_ENABLED 0
+#else
+#define TFTP_RECEIVE_ENABLED 1
+#endif
+#endif
+
 #define TFTP_MAX_BLOCK_SIZE		512
 #define TFT_DATA_HEADER_SIZE 	4
 
@@ -49,6 +58,35 @@ extern "C" {
 #define TFTP_MAX_TIMEOUTS   		10
 
 #define TFTP_DEFAULT_FILENAME "sensors.dat"
+#define TFTP_MAX_FILENAME_LENGTH 32
+//opcode, filename, "\0netascii\0" and "append\0"
+#define TFTP_MAX_REQUEST_LENGTH (2+TFTP_MAX_FILENAME_LENGTH+10+7)
+
+    /*!
+     * requeues the frames of the message tftp last sent from src_port for block
+     * exactly as they went out, returns zero on success and non-zero if they are gone
+     */
+    typedef uint8_t (*dataRequeuerfptr_t)(uint16_t src_port, uint16_t block);
+
+    /*!
+     * hands out room for a payload of up to UDP_MAX_DATAGRAM_LENGTH bytes of a message with opcode
+     * the room is only valid until the data queuer is called next, which consumes it
+     * returns NULL if there is no room right now
+     */
+    typedef uint8_t* (*dataStagerfptr_t)(uint16_t src_port, uint16_t dst_port, uint16_t opcode);
+
+#define TFTP_EVENT_REQUEST		1	//request queued, block is 0
+#define TFTP_EVENT_DATA			2	//new data block queued
+#define TFTP_EVENT_ACK			3	//ack received for block
+#define TFTP_EVENT_RETRANSMIT	4	//last message queued again after a timeout
+#define TFTP_EVENT_COMPLETE		5	//peer reported the transmission complete
+#define TFTP_EVENT_ABORT		6	//transfer given up or ended by an error
+
+    /*!
+     * told about the progress of a transfer, peer is the remote ip
+     * called from the tftp handlers, so it must not queue anything itself
+     */
+    typedef void (*tftpEventfptr_t)(uint8_t event, uint8_t* peer, uint16_t block);
 
     typedef struct
     {
@@ -57,17 +95,32 @@ extern "C" {
         uint16_t src_port;
         uint16_t dst_port;
         uint16_t opcode;
-        uint8_t payload[UDP_MAX_PAYLOAD_LENGTH];
+        //only requests are kept here, data blocks are rebuilt from the file buffer
+        uint8_t payload[TFTP_MAX_REQUEST_LENGTH];
         uint16_t payloadLength;
         uint16_t blockNumber;
         uint8_t append;
     } message_t;
 
+#if TFTP_RECEIVE_ENABLED
+    /*!
+     * tftp_negotiate()
+     * handles requests on port 69, a write request is answered from a port of its own
+     * and its data blocks reach tftp_transfer, a single block write is stored right away
+     */
+    PACKET_HANDLER_FUNCTION_PROTO(tftp_negotiate);
+#endif
     PACKET_HANDLER_FUNCTION_PROTO(tftp_transfer);
+    PACKET_HANDLER_FUNCTION_PROTO(tftp_duplicate);
 
     TIMER_HANDLER_FUNCTION_PROTO(tftp_timer_handler);
 
-    uint8_t tftp_initialize(dataQueuerfptr_t dataQueuer);
+    /*!
+     * both the queuer and the stager are needed, returns non-zero if either is missing
+     */
+    uint8_t tftp_initialize(dataQueuerfptr_t dataQueuer, dataStagerfptr_t dataStager);
+    void tftp_set_data_requeuer(dataRequeuerfptr_t dataRequeuer);
+    void tftp_set_event_handler(tftpEventfptr_t eventHandler);
 
     uint8_t tftp_sendSingleBlockData(uint8_t* dst_ip, uint8_t* data_ptr, uint16_t data_len, uint8_t* remote_filename);
     uint8_t tftp_sendRequest(uint8_t opcode, uint8_t* dst_ip, uint8_t* local_databuffer, uint16_t local_databuffer_len, uint8_t* remote_filename, uint8_t remote_filename_len, uint8_t append);
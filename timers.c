@@ -7,23 +7,180 @@
 #include "contiki-conf.h"
 #include "contiki-net.h"
 #include "contiki-lib.h"
+#include "avr_util.h"
 
-static struct ctimer alarm_timer;
+/*
+ * Two level hashed timer wheel driven by a single ctimer.
+ * level0 holds timers expiring within the next TIMERS_WHEEL_SLOTS ticks,
+ * level1 holds the rest in buckets of TIMERS_WHEEL_SLOTS ticks and is cascaded
+ * down every time level0 wraps. Timers further away than level1 can hold are
+ * parked in the last level1 bucket and re-inserted on cascade.
+ */
+
+#define TICK_INTERVAL (CLOCK_SECOND/TIMERS_TICKS_PER_SECOND)
+
+static RADIO_LOCAL struct ctimer alarm_timer;
+static RADIO_LOCAL timers_timer_t* level0[TIMERS_WHEEL_SLOTS];
+static RADIO_LOCAL timers_timer_t* level1[TIMERS_WHEEL_SLOTS];
+static RADIO_LOCAL uint32_t now_tick = 0;
+static RADIO_LOCAL uint16_t armed = 0;
+static RADIO_LOCAL uint8_t ticking = 0;
+static RADIO_LOCAL uint8_t in_tick = 0;
+
+static RADIO_LOCAL timers_timer_t main_timer;
 void (*mainTimerHandler)(void*);
 
+static void timers_tick(void* data);
+
+static void timers_link(timers_timer_t** bucket, timers_timer_t* timer)
+{
+	timer->bucket = bucket;
+	timer->prev = NULL;
+	timer->next = *bucket;
+	if(*bucket != NULL)
+		(*bucket)->prev = timer;
+	*bucket = timer;
+}
+
+static void timers_unlink(timers_timer_t* timer)
+{
+	if(timer->next != NULL)
+		timer->next->prev = timer->prev;
+	if(timer->prev != NULL)
+		timer->prev->next = timer->next;
+	else
+		*(timer->bucket) = timer->next;
+	timer->next = NULL;
+	timer->prev = NULL;
+	timer->bucket = NULL;
+}
+
+static void timers_insert(timers_timer_t* timer)
+{
+	uint32_t delta;
+
+	if((int32_t) (timer->expires - now_tick) < 0)
+		timer->expires = now_tick;
+	delta = timer->expires - now_tick;
+
+	if(delta < TIMERS_WHEEL_SLOTS)
+	{
+		timers_link(&level0[timer->expires & TIMERS_WHEEL_MASK], timer);
+	}
+	else if((timer->expires >> TIMERS_WHEEL_BITS) - (now_tick >> TIMERS_WHEEL_BITS) < TIMERS_WHEEL_SLOTS)
+	{
+		timers_link(&level1[(timer->expires >> TIMERS_WHEEL_BITS) & TIMERS_WHEEL_MASK], timer);
+	}
+	else
+	{
+		//too far away, park it in the bucket that cascades last
+		timers_link(&level1[((now_tick >> TIMERS_WHEEL_BITS) - 1) & TIMERS_WHEEL_MASK], timer);
+	}
+}
+
+static void timers_cascade(void)
+{
+	timers_timer_t* timer;
+	timers_timer_t** bucket = &level1[(now_tick >> TIMERS_WHEEL_BITS) & TIMERS_WHEEL_MASK];
+
+	timer = *bucket;
+	*bucket = NULL;
+	while(timer != NULL)
+	{
+		timers_timer_t* next = timer->next;
+		timers_insert(timer);
+		timer = next;
+	}
+}
+
+static void timers_tick(void* data)
+{
+	timers_timer_t* timer;
+	timers_timer_t** bucket;
+
+	now_tick++;
+	if((now_tick & TIMERS_WHEEL_MASK) == 0)
+		timers_cascade();
+
+	in_tick = 1;
+	bucket = &level0[now_tick & TIMERS_WHEEL_MASK];
+	while((timer = *bucket) != NULL)
+	{
+		void (*callback)(void*) = timer->callback;
+
+		timers_unlink(timer);
+		timer->callback = NULL;
+		armed--;
+		//the callback is free to re-arm this or any other timer
+		callback(timer->context);
+	}
+	in_tick = 0;
+
+	if(armed)
+		ctimer_reset(&alarm_timer);
+	else
+		ticking = 0;
+}
+
 uint8_t timers_initialize( void(*handlerfptr)(void* ))
 {
     mainTimerHandler=handlerfptr;
     return 0;
 }
 
-uint8_t timers_create_timer( int expireS, int expireMS)
+uint8_t timers_start(timers_timer_t* timer, int expireS, int expireMS, void(*callback)(void*), void* context)
 {
-	ctimer_set(&alarm_timer, (expireS*CLOCK_SECOND)+(expireMS*CLOCK_SECOND/1000), mainTimerHandler, 0);
+	uint32_t ticks;
+
+	if(callback == NULL)
+		return 1;
+	if(timers_is_running(timer))
+		timers_stop(timer);
+
+	ticks = ((uint32_t) expireS * TIMERS_TICKS_PER_SECOND) + (((uint32_t) expireMS * TIMERS_TICKS_PER_SECOND + 999) / 1000);
+	//the current tick is partly gone already, never fire early
+	if(ticking || ticks == 0)
+		ticks++;
+
+	timer->callback = callback;
+	timer->context = context;
+	timer->expires = now_tick + ticks;
+	timers_insert(timer);
+	armed++;
+
+	if(!ticking)
+	{
+		ticking = 1;
+		ctimer_set(&alarm_timer, TICK_INTERVAL, timers_tick, NULL);
+	}
 	return 0;
 }
+
+uint8_t timers_stop(timers_timer_t* timer)
+{
+	if(!timers_is_running(timer))
+		return 0;
+	timers_unlink(timer);
+	timer->callback = NULL;
+	armed--;
+	if(!armed && ticking && !in_tick)
+	{
+		ctimer_stop(&alarm_timer);
+		ticking = 0;
+	}
+	return 0;
+}
+
+uint8_t timers_is_running(timers_timer_t* timer)
+{
+	return timer->callback != NULL;
+}
+
+uint8_t timers_create_timer( int expireS, int expireMS)
+{
+	return timers_start(&main_timer, expireS, expireMS, mainTimerHandler, 0);
+}
 uint8_t timers_cancel_timer(void)
 {
-	ctimer_stop(&alarm_timer);
-    return 0;
+	return timers_stop(&main_timer);
 }
@@ -1,4 +1,4 @@
-/* 
+/*
  * File:   timers.h
  * Author: alpsayin
  *
@@ -19,12 +19,51 @@ extern "C" {
 #define TIMER_HANDLER_FUNCTION_PROTO( timerHandler) uint8_t timerHandler()
 #define TIMER_HANDLER_FUNCTION( timerHandler) uint8_t timerHandler()
 
+/*! resolution of the timer wheel, all logical timers are rounded up to this */
+#ifndef TIMERS_TICKS_PER_SECOND
+#define TIMERS_TICKS_PER_SECOND 32
+#endif
+
+/*! number of slots per wheel level, must be a power of two */
+#define TIMERS_WHEEL_BITS 5
+#define TIMERS_WHEEL_SLOTS (1<<TIMERS_WHEEL_BITS)
+#define TIMERS_WHEEL_MASK (TIMERS_WHEEL_SLOTS-1)
+
     typedef uint8_t (*timerHandlerfptr_t)(void*);
 
+    /*!
+     * a logical timer, owned by the caller and linked into the wheel while armed
+     * must not be moved or freed while it is running
+     */
+    typedef struct timers_timer
+    {
+        struct timers_timer* next;
+        struct timers_timer* prev;
+        struct timers_timer** bucket;
+        uint32_t expires;
+        void (*callback)(void*);
+        void* context;
+    } timers_timer_t;
+
     uint8_t timers_initialize(void(*handlerfptr)(void*));
     uint8_t timers_create_timer( int expireS, int expireMS);
     uint8_t timers_cancel_timer(void);
 
+    /*!
+     * timers_start()
+     * arms (or re-arms) the timer to call callback(context) after the given time
+     * callback must not be NULL, returns non-zero if the timer couldn't be armed
+     */
+    uint8_t timers_start(timers_timer_t* timer, int expireS, int expireMS, void(*callback)(void*), void* context);
+
+    /*!
+     * timers_stop()
+     * disarms the timer, safe to call on a timer that is not running
+     */
+    uint8_t timers_stop(timers_timer_t* timer);
+
+    uint8_t timers_is_running(timers_timer_t* timer);
+
 #ifdef	__cplusplus
 }
 #endif
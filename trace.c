@@ -0,0 +1,93 @@
+/*
+ * trace.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "trace.h"
+
+#if TRACE_ENABLED
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+//called from the uart isr as well, so interrupts are only restored to what they were
+#define TRACE_LOCK() uint8_t sreg = SREG; cli()
+#define TRACE_UNLOCK() SREG = sreg
+#else
+#define TRACE_LOCK()
+#define TRACE_UNLOCK()
+#endif
+
+static trace_entry_t ring[TRACE_RING_SIZE];
+static uint8_t head = 0;
+static uint16_t recorded = 0;
+
+void trace_initialize(void)
+{
+	memset(ring, 0, sizeof(ring));
+	head = 0;
+	recorded = 0;
+}
+
+void trace_record(uint8_t id, uint16_t arg)
+{
+	trace_entry_t* entry;
+	TRACE_LOCK();
+
+	entry = &ring[head];
+	head = (head + 1) & (TRACE_RING_SIZE - 1);
+	if(recorded < TRACE_RING_SIZE)
+		recorded++;
+	entry->stamp = TRACE_TIMESTAMP();
+	entry->arg = arg;
+	entry->id = id;
+
+	TRACE_UNLOCK();
+}
+
+void trace_dump(void)
+{
+	uint16_t i;
+	uint8_t index;
+
+	printf("trace, %u entries, %u ticks/s\n", recorded, (unsigned) TRACE_TICKS_PER_SECOND);
+	index = (head - recorded) & (TRACE_RING_SIZE - 1);
+	for(i = 0; i < recorded; i++)
+	{
+		printf("%5u %2u %u\n", ring[index].stamp, ring[index].id, ring[index].arg);
+		index = (index + 1) & (TRACE_RING_SIZE - 1);
+	}
+}
+
+uint16_t trace_snapshot(uint8_t* payload_out, uint16_t max_length)
+{
+	uint16_t count, i, len = 1;
+	uint8_t index;
+
+	count = (max_length - 1) / TRACE_ENTRY_LENGTH;
+	if(count > recorded)
+		count = recorded;
+	if(count > 255)
+		count = 255;
+	index = (head - count) & (TRACE_RING_SIZE - 1);
+	payload_out[0] = count;
+	for(i = 0; i < count; i++)
+	{
+		payload_out[len++] = ring[index].id;
+		payload_out[len++] = (ring[index].stamp >> 8) & 0xFF;
+		payload_out[len++] = ring[index].stamp & 0xFF;
+		payload_out[len++] = (ring[index].arg >> 8) & 0xFF;
+		payload_out[len++] = ring[index].arg & 0xFF;
+		index = (index + 1) & (TRACE_RING_SIZE - 1);
+	}
+	return len;
+}
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ * File:   trace.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef TRACE_H
+#define	TRACE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+/*! set to 1 to record trace points, otherwise every TRACE() compiles to nothing */
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+/*! entries kept, the oldest ones are overwritten, must be a power of two */
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE 64
+#endif
+/*! 16 bit free running stamp, rtimer ticks unless overridden */
+#ifndef TRACE_TIMESTAMP
+#define TRACE_TIMESTAMP() ((uint16_t) RTIMER_NOW())
+#endif
+#ifndef TRACE_TICKS_PER_SECOND
+#define TRACE_TICKS_PER_SECOND RTIMER_ARCH_SECOND
+#endif
+/*! newest entries sent back for a stats port query, the reply is built on the stack */
+#ifndef TRACE_SNAPSHOT_ENTRIES
+#define TRACE_SNAPSHOT_ENTRIES 24
+#endif
+
+#if (TRACE_RING_SIZE & (TRACE_RING_SIZE-1)) != 0 || TRACE_RING_SIZE > 256
+#error TRACE_RING_SIZE must be a power of two no larger than 256
+#endif
+#if TRACE_SNAPSHOT_ENTRIES > 255
+#error TRACE_SNAPSHOT_ENTRIES has to fit in the count byte
+#endif
+
+/*! trace points */
+#define TRACE_SYNC				1	//arg: unused
+#define TRACE_EOF				2	//arg: encoded length
+#define TRACE_ABORT				3	//arg: encoded length
+#define TRACE_QUEUE_ENTER		4	//arg: datagram length
+#define TRACE_QUEUE_EXIT		5	//arg: result
+#define TRACE_RTS_ASSERT		6	//arg: frame length
+#define TRACE_RTS_RELEASE		7	//arg: frame length
+#define TRACE_TFTP_TRANSFER		8	//arg: opcode
+#define TRACE_TFTP_TIMER		9	//arg: timeouts so far
+#define TRACE_RX_PARSE			10	//arg: rx errors
+#define TRACE_RX_DONE			11	//arg: unused
+
+/*
+ * dump sent back when the stats port is queried with the single byte TRACE_QUERY
+ * count(1) then count entries, oldest first, of id(1) stamp(2) arg(2), big endian
+ */
+#define TRACE_QUERY 'T'
+#define TRACE_ENTRY_LENGTH 5
+#define TRACE_SNAPSHOT_LENGTH (1+TRACE_SNAPSHOT_ENTRIES*TRACE_ENTRY_LENGTH)
+
+    typedef struct
+    {
+        uint16_t stamp;
+        uint16_t arg;
+        uint8_t id;
+    } trace_entry_t;
+
+#if TRACE_ENABLED
+#define TRACE(id, arg) trace_record((id), (arg))
+#else
+#define TRACE(id, arg) do{ }while(0)
+#endif
+
+    void trace_initialize(void);
+
+    /*!
+     * trace_record()
+     * appends one entry, safe to call from interrupt context
+     */
+    void trace_record(uint8_t id, uint16_t arg);
+
+    /*!
+     * trace_dump()
+     * prints the ring to the console, oldest entry first
+     */
+    void trace_dump(void);
+
+    /*!
+     * trace_snapshot()
+     * writes the newest entries that fit in max_length bytes to payload_out as described above
+     * returns the payload length
+     */
+    uint16_t trace_snapshot(uint8_t* payload_out, uint16_t max_length);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TRACE_H */
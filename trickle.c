@@ -0,0 +1,98 @@
+/*
+ * trickle.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "trickle.h"
+#include "timers.h"
+#include "avr_util.h"
+
+#define IMAX_MS (((uint32_t) TRICKLE_IMIN_MS) << TRICKLE_IMAX_DOUBLINGS)
+#define T_STEPS 64
+
+static RADIO_LOCAL uint32_t interval_ms;
+static RADIO_LOCAL uint8_t counter;
+static RADIO_LOCAL timers_timer_t interval_timer;
+static RADIO_LOCAL timers_timer_t transmit_timer;
+static RADIO_LOCAL void (*transmitCallback)(void);
+static RADIO_LOCAL trickle_stats_t stats;
+
+static void trickle_start_timer(timers_timer_t* timer, uint32_t ms, void (*callback)(void*))
+{
+	timers_start(timer, ms / 1000, ms % 1000, callback, NULL);
+}
+
+static void trickle_transmit_expired(void* context)
+{
+	if(counter < TRICKLE_K)
+	{
+		stats.transmitted++;
+		if(transmitCallback != NULL)
+			transmitCallback();
+	}
+	else
+	{
+		stats.suppressed++;
+	}
+}
+
+static void trickle_interval_expired(void* context);
+
+/* new interval, c=0 and t picked uniformly from [I/2, I) */
+static void trickle_begin_interval(void)
+{
+	uint32_t half = interval_ms / 2;
+
+	counter = 0;
+	trickle_start_timer(&transmit_timer, half + (rand() % T_STEPS) * (half / T_STEPS), trickle_transmit_expired);
+	trickle_start_timer(&interval_timer, interval_ms, trickle_interval_expired);
+}
+
+static void trickle_interval_expired(void* context)
+{
+	if(interval_ms < IMAX_MS)
+		interval_ms <<= 1;
+	trickle_begin_interval();
+}
+
+void trickle_initialize(void (*transmit)(void))
+{
+	transmitCallback = transmit;
+	memset(&stats, 0, sizeof(stats));
+	interval_ms = TRICKLE_IMIN_MS;
+	trickle_begin_interval();
+}
+
+void trickle_consistent(void)
+{
+	if(counter < 0xFF)
+		counter++;
+}
+
+void trickle_inconsistent(void)
+{
+	if(interval_ms == TRICKLE_IMIN_MS)
+		return;
+	stats.resets++;
+	interval_ms = TRICKLE_IMIN_MS;
+	trickle_begin_interval();
+}
+
+uint32_t trickle_interval_ms(void)
+{
+	return interval_ms;
+}
+
+trickle_stats_t* trickle_get_stats(void)
+{
+	return &stats;
+}
@@ -0,0 +1,68 @@
+/*
+ * File:   trickle.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef TRICKLE_H
+#define	TRICKLE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+/*
+ * rfc 6206 trickle timer driving the hello beacon
+ * the interval starts at Imin, doubles up to Imin*2^doublings while the
+ * neighbourhood is consistent and drops back to Imin on any change
+ */
+#ifndef TRICKLE_IMIN_MS
+#define TRICKLE_IMIN_MS 4000
+#endif
+#ifndef TRICKLE_IMAX_DOUBLINGS
+#define TRICKLE_IMAX_DOUBLINGS 6
+#endif
+/*! redundancy constant, our beacon is suppressed once k consistent ones were heard */
+#ifndef TRICKLE_K
+#define TRICKLE_K 2
+#endif
+
+    typedef struct
+    {
+        uint16_t transmitted;
+        uint16_t suppressed;
+        uint16_t resets;
+    } trickle_stats_t;
+
+    /*!
+     * trickle_initialize()
+     * starts the first interval at Imin, transmit is called from timer context
+     * whenever a beacon should go out
+     */
+    void trickle_initialize(void (*transmit)(void));
+
+    /*!
+     * trickle_consistent()
+     * a beacon agreeing with what we already know was heard
+     */
+    void trickle_consistent(void);
+
+    /*!
+     * trickle_inconsistent()
+     * the neighbourhood changed, restart from Imin unless we are already there
+     */
+    void trickle_inconsistent(void);
+
+    uint32_t trickle_interval_ms(void);
+
+    trickle_stats_t* trickle_get_stats(void);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TRICKLE_H */
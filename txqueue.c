@@ -0,0 +1,324 @@
+/*
+ * txqueue.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: alpsayin
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "txqueue.h"
+#include "tftp.h"
+#include "radiotftp.h"
+#include "bufpool.h"
+#include "avr_util.h"
+
+#define SLOT_FREE		0
+#define SLOT_RESERVED	1
+#define SLOT_QUEUED		2
+#define SLOT_KEPT		3
+
+typedef struct
+{
+	uint32_t tag;
+	uint16_t length;
+	uint8_t class;
+	uint8_t state;
+	uint8_t part;
+	int8_t next;
+	//only slots holding a frame own a block, free slots hold none
+	int8_t block;
+} txqueue_slot_t;
+
+static RADIO_LOCAL txqueue_slot_t slots[TXQUEUE_NUM_SLOTS];
+static RADIO_LOCAL int8_t heads[TXQUEUE_NUM_CLASSES];
+static RADIO_LOCAL int8_t tails[TXQUEUE_NUM_CLASSES];
+static RADIO_LOCAL txqueue_stats_t stats[TXQUEUE_NUM_CLASSES];
+
+static void txqueue_unlink(int8_t slot)
+{
+	uint8_t class = slots[slot].class;
+	int8_t prev = TXQUEUE_NO_SLOT;
+	int8_t i;
+
+	for(i = heads[class]; i != TXQUEUE_NO_SLOT && i != slot; i = slots[i].next)
+		prev = i;
+	if(i == TXQUEUE_NO_SLOT)
+		return;
+
+	if(prev == TXQUEUE_NO_SLOT)
+		heads[class] = slots[slot].next;
+	else
+		slots[prev].next = slots[slot].next;
+	if(tails[class] == slot)
+		tails[class] = prev;
+
+	slots[slot].state = SLOT_FREE;
+	slots[slot].next = TXQUEUE_NO_SLOT;
+	stats[class].depth--;
+}
+
+static void txqueue_free(int8_t slot)
+{
+	slots[slot].state = SLOT_FREE;
+	slots[slot].tag = TXQUEUE_NO_TAG;
+	bufpool_free(slots[slot].block);
+	slots[slot].block = BUFPOOL_NO_BLOCK;
+}
+
+void txqueue_initialize(void)
+{
+	uint8_t i;
+	for(i = 0; i < TXQUEUE_NUM_SLOTS; i++)
+	{
+		slots[i].state = SLOT_FREE;
+		slots[i].tag = TXQUEUE_NO_TAG;
+		slots[i].next = TXQUEUE_NO_SLOT;
+		slots[i].block = BUFPOOL_NO_BLOCK;
+	}
+	for(i = 0; i < TXQUEUE_NUM_CLASSES; i++)
+	{
+		heads[i] = TXQUEUE_NO_SLOT;
+		tails[i] = TXQUEUE_NO_SLOT;
+	}
+	memset(stats, 0, sizeof(stats));
+}
+
+uint8_t txqueue_classify(uint16_t src_port, uint16_t dst_port, uint8_t* payload, uint16_t len)
+{
+	uint16_t opcode;
+
+	if(dst_port == HELLO_WORLD_PORT)
+		return TXQUEUE_CLASS_BEACON;
+
+	if((src_port == tftp_transfer_src_port() || dst_port == 69) && len >= 2)
+	{
+		opcode = payload[0];
+		opcode <<= 8;
+		opcode |= payload[1];
+		switch(opcode)
+		{
+		case TFTP_OPCODE_ACK:
+		case TFTP_OPCODE_ERROR:
+			return TXQUEUE_CLASS_CONTROL;
+		case TFTP_OPCODE_DATA:
+			return TXQUEUE_CLASS_BULK;
+		default:
+			return TXQUEUE_CLASS_INTERACTIVE;
+		}
+	}
+	return TXQUEUE_CLASS_INTERACTIVE;
+}
+
+int8_t txqueue_reserve_block(uint8_t class, int8_t block)
+{
+	int8_t i;
+	int8_t victim;
+
+	for(i = 0; i < TXQUEUE_NUM_SLOTS; i++)
+	{
+		if(slots[i].state == SLOT_FREE)
+			break;
+	}
+	if(i < TXQUEUE_NUM_SLOTS && block == BUFPOOL_NO_BLOCK)
+	{
+		//free slots come without a block, if the pool is dry only an occupied slot will do
+		block = bufpool_alloc(BUFPOOL_OWNER_TX);
+		if(block == BUFPOOL_NO_BLOCK)
+			i = TXQUEUE_NUM_SLOTS;
+	}
+	if(i == TXQUEUE_NUM_SLOTS)
+	{
+		//a frame kept for retransmission is worth less than anything still waiting
+		for(i = 0; i < TXQUEUE_NUM_SLOTS; i++)
+		{
+			if(slots[i].state == SLOT_KEPT)
+				break;
+		}
+	}
+
+	if(i == TXQUEUE_NUM_SLOTS)
+	{
+		//no room, steal the newest frame of the least important class below us
+		for(victim = TXQUEUE_NUM_CLASSES - 1; victim > (int8_t) class; victim--)
+		{
+			if(tails[victim] != TXQUEUE_NO_SLOT)
+				break;
+		}
+		if(victim <= (int8_t) class)
+		{
+			stats[class].dropped++;
+			return TXQUEUE_NO_SLOT;
+		}
+		i = tails[victim];
+		txqueue_unlink(i);
+		stats[victim].evicted++;
+	}
+
+	//a slot taken over keeps its block unless the caller brought one
+	if(block != BUFPOOL_NO_BLOCK && block != slots[i].block)
+	{
+		bufpool_free(slots[i].block);
+		bufpool_handoff(block, BUFPOOL_OWNER_TX);
+		slots[i].block = block;
+	}
+	slots[i].state = SLOT_RESERVED;
+	slots[i].class = class;
+	slots[i].length = 0;
+	slots[i].tag = TXQUEUE_NO_TAG;
+	slots[i].next = TXQUEUE_NO_SLOT;
+	return i;
+}
+
+int8_t txqueue_reserve(uint8_t class)
+{
+	return txqueue_reserve_block(class, BUFPOOL_NO_BLOCK);
+}
+
+uint8_t txqueue_room(uint8_t class)
+{
+	uint8_t i, room = 0, free = 0;
+
+	for(i = 0; i < TXQUEUE_NUM_SLOTS; i++)
+	{
+		if(slots[i].state == SLOT_FREE)
+			free++;
+		else if(slots[i].state == SLOT_KEPT)
+			room++;
+	}
+	room += (free < bufpool_available()) ? free : bufpool_available();
+	for(i = class + 1; i < TXQUEUE_NUM_CLASSES; i++)
+		room += stats[i].depth;
+	return room;
+}
+
+void txqueue_tag(int8_t slot, uint32_t tag, uint8_t part)
+{
+	uint8_t i;
+
+	for(i = 0; i < TXQUEUE_NUM_SLOTS; i++)
+	{
+		if(slots[i].tag == TXQUEUE_NO_TAG || (int8_t) i == slot)
+			continue;
+		//a kept frame of the same tag is a stale copy of the message being rebuilt
+		if(slots[i].state == SLOT_KEPT)
+			txqueue_free(i);
+		else if(slots[i].tag != tag || slots[i].part == part)
+			slots[i].tag = TXQUEUE_NO_TAG;
+	}
+	slots[slot].tag = tag;
+	slots[slot].part = part;
+}
+
+uint8_t txqueue_requeue(uint32_t tag, uint8_t parts)
+{
+	uint8_t i, found = 0;
+
+	if(tag == TXQUEUE_NO_TAG)
+		return 0;
+	for(i = 0; i < TXQUEUE_NUM_SLOTS; i++)
+	{
+		if(slots[i].state == SLOT_KEPT && slots[i].tag == tag && (parts & (1 << slots[i].part)))
+			found |= 1 << slots[i].part;
+	}
+	if(found != parts)
+		return 0;
+
+	//parts go back in order so the receiver sees them as they were first sent
+	for(found = 0; found < 8; found++)
+	{
+		if(!(parts & (1 << found)))
+			continue;
+		for(i = 0; i < TXQUEUE_NUM_SLOTS; i++)
+		{
+			if(slots[i].state == SLOT_KEPT && slots[i].tag == tag && slots[i].part == found)
+			{
+				stats[slots[i].class].requeued++;
+				txqueue_commit(i, slots[i].length);
+				break;
+			}
+		}
+	}
+	return 1;
+}
+
+void txqueue_commit(int8_t slot, uint16_t length)
+{
+	uint8_t class = slots[slot].class;
+
+	slots[slot].length = length;
+	slots[slot].state = SLOT_QUEUED;
+	slots[slot].next = TXQUEUE_NO_SLOT;
+
+	if(tails[class] == TXQUEUE_NO_SLOT)
+		heads[class] = slot;
+	else
+		slots[tails[class]].next = slot;
+	tails[class] = slot;
+
+	stats[class].enqueued++;
+	stats[class].depth++;
+	if(stats[class].depth > stats[class].max_depth)
+		stats[class].max_depth = stats[class].depth;
+}
+
+void txqueue_cancel(int8_t slot)
+{
+	txqueue_free(slot);
+}
+
+int8_t txqueue_peek(void)
+{
+	uint8_t class;
+	for(class = 0; class < TXQUEUE_NUM_CLASSES; class++)
+	{
+		if(heads[class] != TXQUEUE_NO_SLOT)
+			return heads[class];
+	}
+	return TXQUEUE_NO_SLOT;
+}
+
+void txqueue_release(int8_t slot)
+{
+	stats[slots[slot].class].sent++;
+	txqueue_unlink(slot);
+	if(slots[slot].tag != TXQUEUE_NO_TAG)
+		slots[slot].state = SLOT_KEPT;
+	else
+		txqueue_free(slot);
+}
+
+void txqueue_drop(int8_t slot)
+{
+	stats[slots[slot].class].dropped++;
+	txqueue_unlink(slot);
+	txqueue_free(slot);
+}
+
+uint8_t txqueue_pending(void)
+{
+	return txqueue_peek() != TXQUEUE_NO_SLOT;
+}
+
+uint8_t* txqueue_get_buffer(int8_t slot)
+{
+	return bufpool_data(slots[slot].block);
+}
+
+uint16_t txqueue_get_length(int8_t slot)
+{
+	return slots[slot].length;
+}
+
+uint8_t txqueue_get_class(int8_t slot)
+{
+	return slots[slot].class;
+}
+
+txqueue_stats_t* txqueue_get_stats(uint8_t class)
+{
+	return &stats[class];
+}
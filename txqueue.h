@@ -0,0 +1,139 @@
+/*
+ * File:   txqueue.h
+ * Author: alpsayin
+ *
+ * Created on October 19, 2026
+ */
+
+#ifndef TXQUEUE_H
+#define	TXQUEUE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stdint.h>
+
+/*! traffic classes, lower number means higher priority */
+#define TXQUEUE_CLASS_CONTROL		0
+#define TXQUEUE_CLASS_INTERACTIVE	1
+#define TXQUEUE_CLASS_BULK			2
+#define TXQUEUE_CLASS_BEACON		3
+#define TXQUEUE_NUM_CLASSES			4
+
+/*! number of encoded frames that can wait for the channel at the same time, each one holds a bufpool block */
+#ifndef TXQUEUE_NUM_SLOTS
+#define TXQUEUE_NUM_SLOTS 4
+#endif
+
+#define TXQUEUE_NO_SLOT (-1)
+/*! frames without a tag are forgotten once they are sent */
+#define TXQUEUE_NO_TAG 0
+
+    typedef struct
+    {
+        uint16_t enqueued;
+        uint16_t sent;
+        uint16_t dropped;
+        uint16_t evicted;
+        uint16_t requeued;
+        uint8_t depth;
+        uint8_t max_depth;
+    } txqueue_stats_t;
+
+    /*!
+     * txqueue_initialize()
+     * empties all the classes and clears the statistics
+     */
+    void txqueue_initialize(void);
+
+    /*!
+     * txqueue_classify()
+     * picks a traffic class for an outgoing udp datagram
+     * tftp acks and errors are control traffic, requests are interactive,
+     * data blocks are bulk and hello beacons go to the beacon class
+     */
+    uint8_t txqueue_classify(uint16_t src_port, uint16_t dst_port, uint8_t* payload, uint16_t len);
+
+    /*!
+     * txqueue_reserve()
+     * reserves a free slot for a frame of the given class and takes a block for it from bufpool
+     * if all slots are taken the newest frame of a lower priority class is evicted
+     * returns the slot index or TXQUEUE_NO_SLOT if the frame has to be dropped
+     */
+    int8_t txqueue_reserve(uint8_t traffic_class);
+
+    /*!
+     * txqueue_reserve_block()
+     * like txqueue_reserve but the slot takes over block, which already holds the frame
+     * or enough room to build it, block is left to the caller if no slot is found
+     */
+    int8_t txqueue_reserve_block(uint8_t traffic_class, int8_t block);
+
+    /*!
+     * txqueue_room()
+     * number of frames of the class txqueue_reserve would find slots for right now
+     */
+    uint8_t txqueue_room(uint8_t traffic_class);
+
+    /*!
+     * txqueue_tag()
+     * marks a reserved slot as part number part of the message tag, tagged frames
+     * stay encoded in their slot after they are sent so they can be requeued as they are
+     * only one message is kept, tagging a frame forgets the frames of any other tag
+     * and the earlier copies of its own tag, so a rebuilt message is never requeued twice
+     * kept slots are handed out again before anything queued is evicted
+     */
+    void txqueue_tag(int8_t slot, uint32_t tag, uint8_t part);
+
+    /*!
+     * txqueue_requeue()
+     * queues the kept frames of tag whose part bits are set in parts again
+     * nothing is queued unless all of them are still there
+     * returns non-zero on success
+     */
+    uint8_t txqueue_requeue(uint32_t tag, uint8_t parts);
+
+    /*!
+     * txqueue_commit()
+     * appends a reserved slot holding length bytes to the tail of its class
+     */
+    void txqueue_commit(int8_t slot, uint16_t length);
+
+    /*!
+     * txqueue_cancel()
+     * gives back a reserved slot that could not be filled
+     */
+    void txqueue_cancel(int8_t slot);
+
+    /*!
+     * txqueue_peek()
+     * returns the head slot of the highest priority non-empty class
+     * or TXQUEUE_NO_SLOT if nothing is waiting
+     */
+    int8_t txqueue_peek(void);
+
+    /*!
+     * txqueue_release()
+     * removes a transmitted slot from the head of its class, tagged slots are kept
+     */
+    void txqueue_release(int8_t slot);
+
+    /*!
+     * txqueue_drop()
+     * discards a queued slot that could not be sent, counts it as dropped
+     */
+    void txqueue_drop(int8_t slot);
+
+    uint8_t txqueue_pending(void);
+    uint8_t* txqueue_get_buffer(int8_t slot);
+    uint16_t txqueue_get_length(int8_t slot);
+    uint8_t txqueue_get_class(int8_t slot);
+    txqueue_stats_t* txqueue_get_stats(uint8_t traffic_class);
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* TXQUEUE_H */
@@ -5,80 +5,59 @@
 #include <string.h>
 
 #include "udp_ip.h"
+#include "checksum.h"
 #include "util.h"
+#include "avr_util.h"
 
-static dataQueuerfptr_t mainDataQueuer;
-static uint8_t local_ip_address[4]={127, 0, 0, 1};
+static RADIO_LOCAL dataQueuerfptr_t mainDataQueuer;
+static RADIO_LOCAL uint8_t local_ip_address[4]={127, 0, 0, 1};
 static const uint8_t udp_broadcast_address[4]={ 255, 255, 255, 255};
 
-static uint16_t udp_calculate_checksum(uint8_t* src_addr, uint8_t* dest_addr, uint8_t* payload, uint16_t udp_len)
+static uint16_t udp_pseudo_header_sum(uint8_t* src_addr, uint8_t* dest_addr, uint16_t udp_len, uint16_t sum)
 {
-    uint32_t i;
-    uint8_t prot_udp=17;
-    uint16_t word16;
-    uint32_t sum;
-
-    //initialize sum to zero
-    sum=0;
-
-    // make 16 bit words out of every two adjacent 8 bit words and
-    // calculate the sum of all 16 vit words
-    for (i=0; i<udp_len-8; i=i+2)
-    {
-        if(i+1<udp_len-8)
-            word16 =((payload[i]<<8)&0xFF00)+(payload[i+1]&0x00FF);
-        else
-            word16 =((payload[i]<<8)&0xFF00);
-        sum = sum + (uint32_t)word16;
-    }
-
     // add the UDP pseudo header which contains the IP source and destination addresses
-    for (i=0; i<IPV4_SOURCE_LENGTH; i+=2)
-    {
-        word16 =((src_addr[i]<<8)&0xFF00)+(src_addr[i+1]&0xFF);
-        sum=sum+word16;
-    }
-    for (i=0; i<IPV4_DESTINATION_LENGTH; i+=2)
-    {
-        word16 =((dest_addr[i]<<8)&0xFF00)+(dest_addr[i+1]&0xFF);
-        sum=sum+word16;
-    }
+    sum = checksum_add(src_addr, IPV4_SOURCE_LENGTH, sum);
+    sum = checksum_add(dest_addr, IPV4_DESTINATION_LENGTH, sum);
     // the protocol number and the length of the UDP packet
-    sum = sum + prot_udp + udp_len;
+    sum = checksum_add_word(UDP_IPV4_PROTOCOL_NUMBER, sum);
+    return checksum_add_word(udp_len, sum);
+}
 
-    // keep only the last 16 bits of the 32 bit calculated sum and add the carries
-    while (sum>>16)
-    {
-        sum = (sum & 0xFFFF)+(sum >> 16);
-    }
+static uint16_t udp_calculate_checksum(uint8_t* src_addr, uint8_t* dest_addr, uint8_t* payload, uint16_t udp_len)
+{
+    uint16_t sum;
 
-    // Take the one's complement of sum
-    sum = ~sum;
+    // the payload words, the udp header itself is not part of the sum
+    sum = checksum_add(payload, udp_len-8, 0);
+    sum = udp_pseudo_header_sum(src_addr, dest_addr, udp_len, sum);
 
-    return ((uint16_t) (sum&0xFFFF));
+    // Take the one's complement of sum
+    return ~sum;
 }
 
 static uint16_t ip_header_calculate_checksum(uint8_t* header, uint8_t length)
 {
-    uint16_t word16;
-    uint32_t sum;
-    uint16_t i;
-
-    // make 16 bit words out of every two adjacent 8 bit words in the packet
-    // and add them up
-    for (i=0;i<length;i=i+2){
-        word16 =((header[i]<<8)&0xFF00)+(header[i+1]&0xFF);
-        sum = sum + (uint32_t) word16;
-    }
+    // the checksum field has to be zero while the header is summed
+    return ~checksum_add(header, length, 0);
+}
 
-    // take only 16 bits out of the 32 bit sum and add up the carries
-    while (sum>>16)
-      sum = (sum & 0xFFFF)+(sum >> 16);
+/*
+ * replaces the 16 bit header word at offset and patches the header checksum
+ * incrementally, HC' = ~(~HC + ~m + m') from rfc 1624
+ */
+static void ip_header_replace_word(uint8_t* header, uint8_t offset, uint16_t new_word)
+{
+    uint16_t old_word, sum;
 
-    // one's complement the result
-    sum = ~sum;
+    old_word = ((header[offset]<<8)&0xFF00) | (header[offset+1]&0xFF);
+    header[offset] = (new_word >> 8) & 0xFF;
+    header[offset+1] = new_word & 0xFF;
 
-return ((uint16_t) sum);
+    sum = ((header[IPV4_HEADER_CHECKSUM_OFFSET]<<8)&0xFF00) | (header[IPV4_HEADER_CHECKSUM_OFFSET+1]&0xFF);
+    sum = checksum_add_word(~old_word, ~sum);
+    sum = ~checksum_add_word(new_word, sum);
+    header[IPV4_HEADER_CHECKSUM_OFFSET] = (sum >> 8) & 0xFF;
+    header[IPV4_HEADER_CHECKSUM_OFFSET+1] = sum & 0xFF;
 }
 
 dataQueuerfptr_t udp_get_data_queuer_fptr(void)
@@ -156,7 +135,7 @@ uint16_t udp_create_packet(uint8_t* src_in, uint16_t src_port, uint8_t* dst_in,
 
     //flags and fragment offset
     //bit 1 for flags means dont fragment
-    packet_out[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET]= (0x01<<5) | (0x00);
+    packet_out[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET]= (IPV4_FLAG_DONT_FRAGMENT<<5) | (0x00);
     packet_out[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET+1]= 0x00;
     len+=IPV4_FLAGSnFRAGMENT_OFFSET_LENGTH;
 
@@ -168,10 +147,9 @@ uint16_t udp_create_packet(uint8_t* src_in, uint16_t src_port, uint8_t* dst_in,
     packet_out[IPV4_PROTOCOL_OFFSET] = UDP_IPV4_PROTOCOL_NUMBER;
     len+=IPV4_PROTOCOL_LENGTH;
 
-    //header checksum
-    header_checksum = ip_header_calculate_checksum(packet_out, len);
-    packet_out[IPV4_HEADER_CHECKSUM_OFFSET] = (header_checksum >> 8) & 0xFF;
-    packet_out[IPV4_HEADER_CHECKSUM_OFFSET+1] = header_checksum & 0xFF;
+    //header checksum, filled in once the addresses are in place
+    packet_out[IPV4_HEADER_CHECKSUM_OFFSET] = 0;
+    packet_out[IPV4_HEADER_CHECKSUM_OFFSET+1] = 0;
     len+=IPV4_HEADER_CHECKSUM_LENGTH;
 
     //source address
@@ -184,6 +162,10 @@ uint16_t udp_create_packet(uint8_t* src_in, uint16_t src_port, uint8_t* dst_in,
         packet_out[IPV4_DESTINATION_OFFSET+i]=dst_in[i];
     len+=IPV4_DESTINATION_LENGTH;
 
+    header_checksum = ip_header_calculate_checksum(packet_out, len);
+    packet_out[IPV4_HEADER_CHECKSUM_OFFSET] = (header_checksum >> 8) & 0xFF;
+    packet_out[IPV4_HEADER_CHECKSUM_OFFSET+1] = header_checksum & 0xFF;
+
     //UDP Headers
 
     //source port
@@ -197,26 +179,139 @@ uint16_t udp_create_packet(uint8_t* src_in, uint16_t src_port, uint8_t* dst_in,
     len+=UDP_DESTINATION_PORT_LENGTH;
 
     //udp length = data+udp headers
-    //we've already added 8 to payload_length above, we don't do it again
     payload_length+=8;
     packet_out[UDP_LENGTH_OFFSET]=((payload_length>>8) & 0xFF);
     packet_out[UDP_LENGTH_OFFSET+1]=(payload_length & 0xFF);
     len+=UDP_LENGTH_LENGTH;
 
     //udp checksum
-    //we've already added 8 to payload_length above, we don't do it again
-    udp_checksum=udp_calculate_checksum(src_in, dst_in, payload_in, payload_length);
+    //the payload is summed while it is copied, the pseudo header is added afterwards
+    udp_checksum=checksum_copy_add(packet_out+UDP_PAYLOAD_OFFSET, payload_in, payload_length-8, 0);
+    udp_checksum=~udp_pseudo_header_sum(src_in, dst_in, payload_length, udp_checksum);
     packet_out[UDP_CHECKSUM_OFFSET]=((udp_checksum>>8) & 0xFF);
     packet_out[UDP_CHECKSUM_OFFSET+1]=(udp_checksum & 0xFF);
     len+=UDP_CHECKSUM_LENGTH;
 
-    memcpy(packet_out+UDP_PAYLOAD_OFFSET, payload_in, payload_length-8);
     len+=payload_length-8;
-    
 
     return len;
 }
 
+void udp_create_template(uint8_t* src_in, uint16_t src_port, uint8_t* dst_in, uint16_t dst_port, udp_template_t* template_out)
+{
+    udp_create_packet(src_in, src_port, dst_in, dst_port, NULL, 0, template_out->header);
+    template_out->pseudo_sum = udp_pseudo_header_sum(src_in, dst_in, 0, 0);
+}
+
+uint8_t udp_template_matches(udp_template_t* template_in, uint8_t* src_in, uint16_t src_port, uint8_t* dst_in, uint16_t dst_port)
+{
+    uint8_t* header = template_in->header;
+
+    //a template that was never built has a zero version field
+    if(header[IPV4_VERSIONnIHL_OFFSET]==0)
+        return 0;
+    if(memcmp(header+IPV4_SOURCE_OFFSET, src_in, IPV4_SOURCE_LENGTH) || memcmp(header+IPV4_DESTINATION_OFFSET, dst_in, IPV4_DESTINATION_LENGTH))
+        return 0;
+    return header[UDP_SOURCE_PORT_OFFSET]==((src_port>>8) & 0xFF) && header[UDP_SOURCE_PORT_OFFSET+1]==(src_port & 0xFF)
+            && header[UDP_DESTINATION_PORT_OFFSET]==((dst_port>>8) & 0xFF) && header[UDP_DESTINATION_PORT_OFFSET+1]==(dst_port & 0xFF);
+}
+
+uint16_t udp_create_packet_from_template(udp_template_t* template_in, uint8_t* payload_in, uint16_t payload_length, uint8_t* packet_out)
+{
+    uint16_t udp_length, udp_checksum;
+
+    //check for input errors
+    if(payload_length > UDP_MAX_PAYLOAD_LENGTH || packet_out==NULL)
+        return 0;
+
+    memcpy(packet_out, template_in->header, UDP_TOTAL_HEADERS_LENGTH);
+    ip_header_replace_word(packet_out, IPV4_TOTAL_LENGTH_OFFSET, payload_length+UDP_TOTAL_HEADERS_LENGTH);
+
+    udp_length = payload_length+8;
+    packet_out[UDP_LENGTH_OFFSET]=((udp_length>>8) & 0xFF);
+    packet_out[UDP_LENGTH_OFFSET+1]=(udp_length & 0xFF);
+
+    udp_checksum=checksum_copy_add(packet_out+UDP_PAYLOAD_OFFSET, payload_in, payload_length, template_in->pseudo_sum);
+    udp_checksum=~checksum_add_word(udp_length, udp_checksum);
+    packet_out[UDP_CHECKSUM_OFFSET]=((udp_checksum>>8) & 0xFF);
+    packet_out[UDP_CHECKSUM_OFFSET+1]=(udp_checksum & 0xFF);
+
+    return UDP_TOTAL_HEADERS_LENGTH+payload_length;
+}
+
+uint16_t udp_create_fragment(uint8_t* src_in, uint16_t src_port, uint8_t* dst_in, uint16_t dst_port, uint8_t* payload_in, uint16_t payload_length,
+                                    uint16_t identification, uint16_t offset, uint8_t* packet_out)
+{
+    uint16_t udp_length, fragment_length, header_checksum, udp_checksum;
+    uint8_t flags;
+    uint8_t* data;
+
+    //check for input errors
+    udp_length = payload_length+8;
+    if(payload_length > UDP_MAX_DATAGRAM_LENGTH || packet_out==NULL || identification==0
+            || offset >= udp_length || (offset % UDP_FRAGMENT_LENGTH)!=0)
+        return 0;
+
+    fragment_length = udp_length-offset;
+    flags = 0;
+    if(fragment_length > UDP_FRAGMENT_LENGTH)
+    {
+        fragment_length = UDP_FRAGMENT_LENGTH;
+        flags = IPV4_FLAG_MORE_FRAGMENTS;
+    }
+
+    //ipv4 header, same layout as udp_create_packet
+    packet_out[IPV4_VERSIONnIHL_OFFSET]= ((0x04)<<4) | (0x05);
+    packet_out[IPV4_DSCPnECN_OFFSET] = (0x03<<4) | (0x00);
+    packet_out[IPV4_TOTAL_LENGTH_OFFSET]=(((fragment_length+20)>>8) & 0xFF);
+    packet_out[IPV4_TOTAL_LENGTH_OFFSET+1]=((fragment_length+20) & 0xFF);
+    packet_out[IPV4_IDENTIFICATION_OFFSET]=(identification>>8) & 0xFF;
+    packet_out[IPV4_IDENTIFICATION_OFFSET+1]=identification & 0xFF;
+    //fragment offset counts 8 byte units
+    packet_out[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET]= (flags<<5) | (((offset>>3)>>8) & 0x1F);
+    packet_out[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET+1]= (offset>>3) & 0xFF;
+    packet_out[IPV4_TIME_TO_LIVE_OFFSET] = IPV4_TTL_LIMIT;
+    packet_out[IPV4_PROTOCOL_OFFSET] = UDP_IPV4_PROTOCOL_NUMBER;
+    memcpy(packet_out+IPV4_SOURCE_OFFSET, src_in, IPV4_SOURCE_LENGTH);
+    memcpy(packet_out+IPV4_DESTINATION_OFFSET, dst_in, IPV4_DESTINATION_LENGTH);
+    packet_out[IPV4_HEADER_CHECKSUM_OFFSET] = 0;
+    packet_out[IPV4_HEADER_CHECKSUM_OFFSET+1] = 0;
+    header_checksum = ip_header_calculate_checksum(packet_out, IPV4_PAYLOAD_OFFSET);
+    packet_out[IPV4_HEADER_CHECKSUM_OFFSET] = (header_checksum >> 8) & 0xFF;
+    packet_out[IPV4_HEADER_CHECKSUM_OFFSET+1] = header_checksum & 0xFF;
+
+    data = packet_out+IPV4_PAYLOAD_OFFSET;
+    if(offset==0)
+    {
+        //only the first fragment carries the udp header, its checksum covers the whole datagram
+        data[0]=((src_port>>8) & 0xFF);
+        data[1]=(src_port & 0xFF);
+        data[2]=((dst_port>>8) & 0xFF);
+        data[3]=(dst_port & 0xFF);
+        data[4]=((udp_length>>8) & 0xFF);
+        data[5]=(udp_length & 0xFF);
+        udp_checksum=udp_calculate_checksum(src_in, dst_in, payload_in, udp_length);
+        data[6]=((udp_checksum>>8) & 0xFF);
+        data[7]=(udp_checksum & 0xFF);
+        memcpy(data+8, payload_in, fragment_length-8);
+    }
+    else
+    {
+        memcpy(data, payload_in+offset-8, fragment_length);
+    }
+
+    return IPV4_PAYLOAD_OFFSET+fragment_length;
+}
+
+uint8_t udp_is_fragment(uint8_t* packet_in)
+{
+    //unfragmented packets always go out with a zero identification
+    if(packet_in[IPV4_IDENTIFICATION_OFFSET]==0 && packet_in[IPV4_IDENTIFICATION_OFFSET+1]==0)
+        return 0;
+    return (packet_in[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET] & ((IPV4_FLAG_MORE_FRAGMENTS<<5) | 0x1F))
+            || packet_in[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET+1];
+}
+
 uint8_t udp_check_destination(uint8_t* my_dst, uint8_t* packet_dst, uint8_t* packet_in)
 {
     uint8_t result;
@@ -235,6 +330,20 @@ uint8_t udp_check_destination(uint8_t* my_dst, uint8_t* packet_dst, uint8_t* pac
     return result;
 }
 
+uint8_t udp_decrement_ttl(uint8_t* packet_in)
+{
+    uint16_t word;
+
+    if(packet_in[IPV4_TIME_TO_LIVE_OFFSET] <= 1)
+        return 0;
+
+    //ttl shares a 16 bit word with the protocol number
+    word = ((packet_in[IPV4_TIME_TO_LIVE_OFFSET]<<8)&0xFF00) | (packet_in[IPV4_PROTOCOL_OFFSET]&0xFF);
+    ip_header_replace_word(packet_in, IPV4_TIME_TO_LIVE_OFFSET, word - 0x0100);
+
+    return packet_in[IPV4_TIME_TO_LIVE_OFFSET];
+}
+
 uint16_t udp_open_packet_extended(uint8_t* src_out, uint16_t* src_port_out,
                                     uint8_t* dst_out, uint16_t* dst_port_out,
                                     uint8_t* payload_out,
@@ -284,7 +393,7 @@ uint16_t udp_open_packet_extended(uint8_t* src_out, uint16_t* src_port_out,
     }
 
     if(flags_out!=NULL)
-        *flags_out= ( packet_in[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET] >> 5 ) * 0x07;
+        *flags_out= ( packet_in[IPV4_FLAGSnFRAGMENT_OFFSET_OFFSET] >> 5 ) & 0x07;
 
     if(fragmentoffset_out!=NULL)
     {
@@ -387,5 +496,17 @@ uint16_t udp_open_packet(uint8_t* src_out, uint16_t* src_port_out,
                             );
 }
 
-
-
+uint8_t* udp_open_packet_view(uint8_t* src_out, uint16_t* src_port_out,
+                                    uint8_t* dst_out, uint16_t* dst_port_out,
+                                    uint8_t* packet_in,
+                                    uint16_t* length_out)
+{
+    uint16_t len;
+
+    len = udp_open_packet(src_out, src_port_out, dst_out, dst_port_out, NULL, packet_in);
+    if(len==0)
+        return NULL;
+    if(length_out!=NULL)
+        *length_out = len;
+    return packet_in+UDP_PAYLOAD_OFFSET;
+}
@@ -15,7 +15,11 @@
 #include "ax25.h"
 
 #define UDP_MAX_PAYLOAD_LENGTH (256)
-#define UDP_TOTAL_HEADERS_LENGTH (18+8)
+#define UDP_TOTAL_HEADERS_LENGTH (20+8)
+/*! largest datagram payload accepted for fragmentation, one full tftp data block */
+#define UDP_MAX_DATAGRAM_LENGTH (512+4)
+/*! udp datagram bytes carried per fragment, a multiple of 8 that fills one frame */
+#define UDP_FRAGMENT_LENGTH (UDP_MAX_PAYLOAD_LENGTH+8)
 
 #define IPV4_VERSIONnIHL_LENGTH 1
 #define IPV4_DSCPnECN_LENGTH 1
@@ -51,6 +55,9 @@
 #define UDP_CHECKSUM_OFFSET (UDP_LENGTH_OFFSET+UDP_LENGTH_LENGTH)
 #define UDP_PAYLOAD_OFFSET (UDP_CHECKSUM_OFFSET+UDP_CHECKSUM_LENGTH)
 
+#define IPV4_FLAG_DONT_FRAGMENT 0x02
+#define IPV4_FLAG_MORE_FRAGMENTS 0x01
+
 #define IPV4_TTL_LIMIT 2
 #define UDP_IPV4_PROTOCOL_NUMBER 0x11
 
@@ -64,6 +71,16 @@ extern "C" {
     typedef uint8_t (*dataQueuerfptr_t)(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t dst_port, uint8_t* dataptr, uint16_t datalen);
     typedef uint8_t (*packetHandlerfptr_t)(uint8_t* src, uint16_t src_port, uint8_t* dst, uint16_t dst_port, uint8_t* payload, uint16_t len);
 
+    /*!
+     * headers of an empty datagram between two fixed endpoints, plus the pseudo header sum
+     * without the udp length, packets built from it only get their lengths and checksums patched
+     */
+    typedef struct
+    {
+        uint8_t header[UDP_TOTAL_HEADERS_LENGTH];
+        uint16_t pseudo_sum;
+    } udp_template_t;
+
     void udp_initialize_ip_network(uint8_t* myIpAddress, dataQueuerfptr_t dataQueuer);
 
     dataQueuerfptr_t udp_get_data_queuer_fptr(void);
@@ -73,13 +90,69 @@ extern "C" {
 
     uint16_t udp_create_packet(uint8_t* src_in, uint16_t src_port, uint8_t* dst_in, uint16_t dst_port, uint8_t* payload_in, uint16_t payload_length, uint8_t* packet_out);
 
+    /*!
+     * udp_create_template()
+     * prebuilds the headers udp_create_packet would write for these endpoints
+     */
+    void udp_create_template(uint8_t* src_in, uint16_t src_port, uint8_t* dst_in, uint16_t dst_port, udp_template_t* template_out);
+
+    /*!
+     * udp_template_matches()
+     * returns non-zero if template_in was built for these endpoints
+     */
+    uint8_t udp_template_matches(udp_template_t* template_in, uint8_t* src_in, uint16_t src_port, uint8_t* dst_in, uint16_t dst_port);
+
+    /*!
+     * udp_create_packet_from_template()
+     * same packet as udp_create_packet, the headers are copied from the template and
+     * the total length and header checksum are patched incrementally (rfc 1624),
+     * the udp checksum is the pseudo header sum plus the payload summed while it is copied
+     * returns the length of the packet or zero on error
+     */
+    uint16_t udp_create_packet_from_template(udp_template_t* template_in, uint8_t* payload_in, uint16_t payload_length, uint8_t* packet_out);
+
+    /*!
+     * udp_create_fragment()
+     * builds the fragment of a datagram too long for one frame that starts at byte offset
+     * of the udp datagram (header included), offset must be a multiple of UDP_FRAGMENT_LENGTH
+     * every fragment of one datagram carries the same non-zero identification
+     * returns the length of the ip packet or zero on error
+     */
+    uint16_t udp_create_fragment(uint8_t* src_in, uint16_t src_port, uint8_t* dst_in, uint16_t dst_port, uint8_t* payload_in, uint16_t payload_length,
+                                        uint16_t identification, uint16_t offset, uint8_t* packet_out);
+
+    /*!
+     * udp_is_fragment()
+     * non-zero if packet_in is one fragment of a longer datagram
+     */
+    uint8_t udp_is_fragment(uint8_t* packet_in);
+
     uint8_t udp_check_destination(uint8_t* my_dst, uint8_t* packet_dst, uint8_t* packet_in);
 
+    /*!
+     * udp_decrement_ttl()
+     * decrements the time to live of packet_in in place and patches the header checksum
+     * incrementally (rfc 1624) instead of summing the whole header again
+     * returns the new time to live, zero if the packet must not be forwarded
+     */
+    uint8_t udp_decrement_ttl(uint8_t* packet_in);
+
     uint16_t udp_open_packet(uint8_t* src_out, uint16_t* src_port_out,
                                         uint8_t* dst_out, uint16_t* dst_port_out,
                                         uint8_t* payload_out,
                                         uint8_t* packet_in);
 
+    /*!
+     * udp_open_packet_view()
+     * same checks as udp_open_packet but the payload stays where it is
+     * returns a pointer to it inside packet_in, NULL if the packet doesn't check out
+     * length_out gets the udp length like udp_open_packet returns it
+     */
+    uint8_t* udp_open_packet_view(uint8_t* src_out, uint16_t* src_port_out,
+                                        uint8_t* dst_out, uint16_t* dst_port_out,
+                                        uint8_t* packet_in,
+                                        uint16_t* length_out);
+
     uint16_t udp_open_packet_extended(uint8_t* src_out, uint16_t* src_port_out,
                                         uint8_t* dst_out, uint16_t* dst_port_out,
                                         uint8_t* payload_out,